@@ -2577,6 +2577,146 @@ class PCMReaderProgress(PCMReader):
         self.pcmreader.close()
 
 
+class PCMBroadcast(object):
+    """shares a single PCMReader among several consumers
+
+    each consumer reads the whole stream from its own branch()
+    so that the source is decoded only once,
+    but each branch must be read from its own thread
+    since a branch too far ahead of the others waits for them"""
+
+    def __init__(self, pcmreader, buffered_framelists=4):
+        """pcmreader is a PCMReader compatible object
+        buffered_framelists is the most FrameLists
+        of up to FRAMELIST_SIZE PCM frames each to hold
+        for the branches which haven't read them yet"""
+
+        import threading
+
+        self.pcmreader = pcmreader
+        self.buffered_framelists = max(buffered_framelists, 1)
+        self.__condition__ = threading.Condition()
+        # FrameLists not yet read by every open branch
+        self.__framelists__ = []
+        # the stream index of __framelists__[0]
+        self.__first__ = 0
+        # branch -> stream index of its next FrameList
+        self.__positions__ = {}
+        # whether a branch is reading from the source
+        # with the condition released
+        self.__reading__ = False
+        self.__finished__ = False
+        self.__error__ = None
+        self.__closed__ = False
+
+    def branch(self):
+        """returns a new PCMReader of the source stream
+
+        branches must be taken before any of them are read"""
+
+        branch = PCMBroadcastBranch(self)
+        with self.__condition__:
+            self.__positions__[branch] = self.__first__
+        return branch
+
+    def __read__(self, branch):
+        with self.__condition__:
+            while True:
+                position = self.__positions__[branch]
+                if position < (self.__first__ + len(self.__framelists__)):
+                    framelist = self.__framelists__[
+                        position - self.__first__]
+                    self.__positions__[branch] = position + 1
+                    self.__trim__()
+                    return framelist
+                elif self.__error__ is not None:
+                    raise self.__error__
+                elif self.__finished__:
+                    return pcm.empty_framelist(
+                        self.pcmreader.channels,
+                        self.pcmreader.bits_per_sample)
+                elif self.__reading__:
+                    # another branch is already reading the next FrameList
+                    self.__condition__.wait()
+                elif len(self.__framelists__) < self.buffered_framelists:
+                    # this branch is furthest along,
+                    # so it reads the next FrameList for everyone
+                    # without holding up branches with FrameLists to read
+                    self.__reading__ = True
+                    self.__condition__.release()
+                    try:
+                        try:
+                            framelist = self.pcmreader.read(FRAMELIST_SIZE)
+                        finally:
+                            self.__condition__.acquire()
+                            self.__reading__ = False
+                    except Exception as err:
+                        # every other branch raises the same error
+                        # rather than waiting on a FrameList never read
+                        self.__error__ = err
+                        self.__condition__.notify_all()
+                        raise
+                    if len(framelist) > 0:
+                        self.__framelists__.append(framelist)
+                    else:
+                        self.__finished__ = True
+                    self.__condition__.notify_all()
+                else:
+                    # wait for the slowest branch to catch up
+                    self.__condition__.wait()
+
+    def __trim__(self):
+        # drop FrameLists every open branch has read
+        if len(self.__positions__) > 0:
+            slowest = min(self.__positions__.values())
+        else:
+            slowest = self.__first__ + len(self.__framelists__)
+        if slowest > self.__first__:
+            del(self.__framelists__[0:slowest - self.__first__])
+            self.__first__ = slowest
+            self.__condition__.notify_all()
+
+    def __close__(self, branch):
+        with self.__condition__:
+            del(self.__positions__[branch])
+            self.__trim__()
+            if (len(self.__positions__) == 0) and (not self.__closed__):
+                # the last branch to close also closes the source
+                # once no other branch is reading from it
+                while self.__reading__:
+                    self.__condition__.wait()
+                self.__closed__ = True
+                self.pcmreader.close()
+
+
+class PCMBroadcastBranch(PCMReader):
+    """one consumer's view of a PCMBroadcast's stream"""
+
+    def __init__(self, broadcast):
+        PCMReader.__init__(self,
+                           sample_rate=broadcast.pcmreader.sample_rate,
+                           channels=broadcast.pcmreader.channels,
+                           channel_mask=broadcast.pcmreader.channel_mask,
+                           bits_per_sample=broadcast.pcmreader.bits_per_sample)
+        self.broadcast = broadcast
+        self.closed = False
+
+    def read(self, pcm_frames):
+        """returns the next FrameList from the source stream
+
+        its size is that of the source's FrameList,
+        regardless of pcm_frames"""
+
+        if self.closed:
+            raise ValueError("stream is closed")
+        return self.broadcast.__read__(self)
+
+    def close(self):
+        if not self.closed:
+            self.closed = True
+            self.broadcast.__close__(self)
+
+
 class ReorderedPCMReader(PCMReader):
     """a PCMReader wrapper which reorders its output channels"""
 
@@ -2774,106 +2914,18 @@ def pcm_frame_cmp(pcmreader1, pcmreader2):
         pcmreader2.close()
         return 0
 
-    frame_number = 0
-    reader1 = BufferedPCMReader(pcmreader1)
-    reader2 = BufferedPCMReader(pcmreader2)
     try:
-        framelist1 = reader1.read(FRAMELIST_SIZE)
-        framelist2 = reader2.read(FRAMELIST_SIZE)
-
-        # so long as both framelists contain data
-        while (len(framelist1) > 0) and (len(framelist2) > 0):
-            # compare both entire framelists
-            if framelist1 == framelist2:
-                # if they both match, continue to the next pair
-                frame_number += framelist1.frames
-                framelist1 = reader1.read(FRAMELIST_SIZE)
-                framelist2 = reader2.read(FRAMELIST_SIZE)
-            else:
-                # if there's a mismatch, determine the exact frame
-                for i in range(min(framelist1.frames, framelist2.frames)):
-                    if framelist1.frame(i) != framelist2.frame(i):
-                        return frame_number + i
-                else:
-                    return frame_number + i
-        else:
-            # at least one framelist is empty
-            if (len(framelist1) == 0) and (len(framelist2) == 0):
-                # if they're both empty, there's no mismatch
-                return None
-            else:
-                # if only one is empty, return as far as we've gotten
-                return frame_number
+        return pcm.compare_readers(pcmreader1, pcmreader2)
     finally:
-        reader1.close()
-        reader2.close()
-
-
-class PCMCat(PCMReader):
-    """a PCMReader for concatenating several PCMReaders"""
-
-    def __init__(self, pcmreaders):
-        """pcmreaders is a list of PCMReader objects
-
-        all must have the same stream attributes"""
-
-        self.index = 0
-        self.pcmreaders = list(pcmreaders)
-
-        if len(self.pcmreaders) == 0:
-            from audiotools.text import ERR_NO_PCMREADERS
-            raise ValueError(ERR_NO_PCMREADERS)
-
-        if len({r.sample_rate for r in self.pcmreaders}) != 1:
-            from audiotools.text import ERR_SAMPLE_RATE_MISMATCH
-            raise ValueError(ERR_SAMPLE_RATE_MISMATCH)
-
-        if len({r.channels for r in self.pcmreaders}) != 1:
-            from audiotools.text import ERR_CHANNEL_COUNT_MISMATCH
-            raise ValueError(ERR_CHANNEL_COUNT_MISMATCH)
-
-        if len({r.bits_per_sample for r in self.pcmreaders}) != 1:
-            from audiotools.text import ERR_BPS_MISMATCH
-            raise ValueError(ERR_BPS_MISMATCH)
-
-        first_reader = self.pcmreaders[self.index]
-        PCMReader.__init__(self,
-                           sample_rate=first_reader.sample_rate,
-                           channels=first_reader.channels,
-                           channel_mask=first_reader.channel_mask,
-                           bits_per_sample=first_reader.bits_per_sample)
-
-    def read(self, pcm_frames):
-        """try to read a pcm.FrameList with the given number of frames
-
-        raises ValueError if any of the streams is mismatched"""
-
-        if self.index < len(self.pcmreaders):
-            # read a FrameList from the current PCMReader
-            framelist = self.pcmreaders[self.index].read(pcm_frames)
-            if len(framelist) > 0:
-                # if it has data, return it
-                return framelist
-            else:
-                # otherwise, move on to next pcmreader
-                self.index += 1
-                return self.read(pcm_frames)
-        else:
-            # all PCMReaders exhausted, so return empty FrameList
-            return pcm.empty_framelist(self.channels, self.bits_per_sample)
-
-    def read_closed(self, pcm_frames):
-        raise ValueError()
-
-    def close(self):
-        """closes the stream for reading"""
-
-        self.read = self.read_closed
-        for reader in self.pcmreaders:
-            reader.close()
+        pcmreader1.close()
+        pcmreader2.close()
 
 
-from audiotools.pcmconverter import BufferedPCMReader
+from audiotools.pcmconverter import (BufferedPCMReader,
+                                     PCMCat,
+                                     LimitedPCMReader,
+                                     PCMReaderHead,
+                                     PCMReaderDeHead)
 
 
 class CounterPCMReader(PCMReader):
@@ -2924,38 +2976,6 @@ class LimitedFileReader(object):
         self.__file__.close()
 
 
-class LimitedPCMReader(PCMReader):
-    def __init__(self, buffered_pcmreader, total_pcm_frames):
-        """buffered_pcmreader should be a BufferedPCMReader
-
-        which ensures we won't pull more frames off the reader
-        than necessary upon calls to read()"""
-
-        PCMReader.__init__(
-            self,
-            sample_rate=buffered_pcmreader.sample_rate,
-            channels=buffered_pcmreader.channels,
-            channel_mask=buffered_pcmreader.channel_mask,
-            bits_per_sample=buffered_pcmreader.bits_per_sample)
-
-        self.pcmreader = buffered_pcmreader
-        self.total_pcm_frames = total_pcm_frames
-
-    def read(self, pcm_frames):
-        if self.total_pcm_frames > 0:
-            frame = self.pcmreader.read(min(pcm_frames, self.total_pcm_frames))
-            self.total_pcm_frames -= frame.frames
-            return frame
-        else:
-            return pcm.empty_framelist(self.channels, self.bits_per_sample)
-
-    def read_closed(self, pcm_frames):
-        raise ValueError()
-
-    def close(self):
-        self.read = self.read_closed
-
-
 def PCMConverter(pcmreader,
                  sample_rate,
                  channels,
@@ -3042,12 +3062,42 @@ class ReplayGainCalculator:
     def sample_rate(self):
         return self.__replaygain__.sample_rate
 
-    def __iter__(self):
+    def album_gain(self):
+        """returns the album gain of every closed track
+        and every added album state"""
+
         try:
-            album_gain = self.__replaygain__.album_gain()
+            return self.__replaygain__.album_gain()
         except ValueError:
-            album_gain = 0.0
-        album_peak = self.__replaygain__.album_peak()
+            return 0.0
+
+    def album_peak(self):
+        """returns the album peak of every closed track
+        and every added album state"""
+
+        return self.__replaygain__.album_peak()
+
+    def album_state(self):
+        """returns the album analysis of every closed track as bytes
+
+        this allows tracks analyzed by separate calculators,
+        such as those in different processes,
+        to be combined into a single album with add_album_state()"""
+
+        return self.__replaygain__.album_state()
+
+    def add_album_state(self, state):
+        """adds the tracks of another calculator's album_state()
+        to this calculator's album gain and album peak
+
+        raises ValueError if the state is invalid
+        or from a calculator with a different sample rate"""
+
+        self.__replaygain__.add_album_state(state)
+
+    def __iter__(self):
+        album_gain = self.album_gain()
+        album_peak = self.album_peak()
 
         for t in self.__tracks__:
             title_gain = t.title_gain()
@@ -3126,6 +3176,21 @@ def resampled_frame_count(initial_frame_count,
                                             rounding=ROUND_DOWN))
 
 
+def replay_gain_sample_rate(sample_rates):
+    """given a non-empty list of sample rate integers, one per track,
+    returns the sample rate all of those tracks are analyzed at
+    when calculating their ReplayGain as an album"""
+
+    from bisect import bisect
+
+    SUPPORTED_RATES = [8000, 11025, 12000, 16000, 18900, 22050, 24000,
+                       32000, 37800, 44100, 48000, 56000, 64000, 88200,
+                       96000, 112000, 128000, 144000, 176400, 192000]
+
+    return ([SUPPORTED_RATES[0]] + SUPPORTED_RATES)[
+        bisect(SUPPORTED_RATES, most_numerous(sample_rates))]
+
+
 def calculate_replay_gain(tracks, progress=None):
     """yields (track, track_gain, track_peak, album_gain, album_peak)
     for each AudioFile in the list of tracks
@@ -3135,15 +3200,8 @@ def calculate_replay_gain(tracks, progress=None):
     if len(tracks) == 0:
         return
 
-    from bisect import bisect
-
-    SUPPORTED_RATES = [8000, 11025, 12000, 16000, 18900, 22050, 24000,
-                       32000, 37800, 44100, 48000, 56000, 64000, 88200,
-                       96000, 112000, 128000, 144000, 176400, 192000]
-
-    target_rate = ([SUPPORTED_RATES[0]] + SUPPORTED_RATES)[
-        bisect(SUPPORTED_RATES, most_numerous([track.sample_rate()
-                                               for track in tracks]))]
+    target_rate = replay_gain_sample_rate([track.sample_rate()
+                                           for track in tracks])
 
     track_frames = [resampled_frame_count(track.total_frames(),
                                           track.sample_rate(),
@@ -3194,6 +3252,92 @@ def add_replay_gain(tracks, progress=None):
                                          album_peak=album_peak))
 
 
+def __stats_modules__():
+    """returns a list of the low-level modules which record stats"""
+
+    from audiotools import decoders
+    from audiotools import encoders
+    from audiotools import pcmconverter
+
+    return [decoders, encoders, pcmconverter]
+
+
+def stats():
+    """returns a dict of stage name unicode strings,
+    such as u"flac.decode.frame", to dicts of
+    {"calls":int, "samples":int, "seconds":float}
+    for every stage which has run since stats were last reset
+
+    the dict is empty unless the modules were built with
+    "stats" enabled in setup.cfg and stats have been enabled
+    by enable_stats() or the AUDIOTOOLS_STATS environment variable
+
+    stats are per-process, so work done by
+    ExecProgressQueue's worker processes isn't included"""
+
+    totals = {}
+    for module in __stats_modules__():
+        for (stage, (calls, samples, seconds)) in module.stats().items():
+            if isinstance(stage, bytes):
+                stage = stage.decode("ascii")
+            total = totals.setdefault(stage, {"calls": 0,
+                                              "samples": 0,
+                                              "seconds": 0.0})
+            total["calls"] += calls
+            total["samples"] += samples
+            total["seconds"] += seconds
+    return totals
+
+
+def stats_prometheus():
+    """returns stats() as a unicode string
+    in the Prometheus text exposition format"""
+
+    counters = [(u"audiotools_stage_calls_total",
+                 u"number of times a codec stage has run",
+                 "calls"),
+                (u"audiotools_stage_samples_total",
+                 u"number of PCM samples a codec stage has handled",
+                 "samples"),
+                (u"audiotools_stage_seconds_total",
+                 u"time spent in a codec stage",
+                 "seconds")]
+
+    totals = stats()
+    lines = []
+    for (name, description, key) in counters:
+        lines.append(u"# HELP {} {}".format(name, description))
+        lines.append(u"# TYPE {} counter".format(name))
+        for stage in sorted(totals.keys()):
+            (component, stage_name) = stage.split(u".", 1)
+            value = totals[stage][key]
+            lines.append(
+                u"{}{{component=\"{}\",stage=\"{}\"}} {}".format(
+                    name,
+                    component,
+                    stage_name,
+                    repr(value) if isinstance(value, float) else value))
+    return u"\n".join(lines) + u"\n"
+
+
+def enable_stats(enabled=True):
+    """turns stats recording on or off
+
+    returns True if stats are now being recorded,
+    which is never the case if the modules were built
+    without "stats" enabled in setup.cfg"""
+
+    return any([module.enable_stats(1 if enabled else 0)
+                for module in __stats_modules__()])
+
+
+def reset_stats():
+    """sets all stats counters to 0"""
+
+    for module in __stats_modules__():
+        module.reset_stats()
+
+
 def ignore_sigint():
     """sets the SIGINT signal to SIG_IGN
 
@@ -4159,6 +4303,64 @@ class AudioFile(object):
             total_pcm_frames=(self.total_frames() if self.lossless()
                               else None))
 
+    def convert_many(self, targets, progress=None):
+        """encodes several new AudioFiles from existing AudioFile
+
+        takes a list of (filename string, target class, compression string)
+        tuples, where compression may be None,
+        and encodes each target in its own thread from a single
+        decoding pass over this file
+        returns a list of the resulting objects in the same order
+
+        may raise EncodingError if some problem occurs during encoding
+        but only once every other target has finished"""
+
+        import threading
+
+        if len(targets) == 0:
+            # nothing to encode, so don't open the source at all
+            return []
+        elif len(targets) == 1:
+            (target_path, target_class, compression) = targets[0]
+            return [self.convert(target_path,
+                                 target_class,
+                                 compression,
+                                 progress)]
+
+        total_pcm_frames = self.total_frames() if self.lossless() else None
+        broadcast = PCMBroadcast(to_pcm_progress(self, progress))
+        branches = [broadcast.branch() for target in targets]
+        results = [None] * len(targets)
+        errors = [None] * len(targets)
+
+        def encode(index, pcmreader, target_path, target_class, compression):
+            try:
+                results[index] = target_class.from_pcm(
+                    target_path,
+                    pcmreader,
+                    compression,
+                    total_pcm_frames=total_pcm_frames)
+            except Exception as err:
+                errors[index] = err
+            finally:
+                # a finished branch no longer holds back the others
+                pcmreader.close()
+
+        threads = [threading.Thread(target=encode,
+                                    args=(index, branch) + tuple(target))
+                   for (index, (branch, target)) in
+                   enumerate(zip(branches, targets))]
+        for thread in threads:
+            thread.daemon = True
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        for error in errors:
+            if error is not None:
+                raise error
+        return results
+
     def seekable(self):
         """returns True if the file is seekable
 
@@ -4168,6 +4370,16 @@ class AudioFile(object):
 
         return False
 
+    def can_seek(self):
+        """returns True if the file's PCMReader can .seek()
+        to a given PCM frame without decoding everything before it
+
+        this is True for every seekable() file
+        but also for files whose decoder can locate frames
+        without an index, if less quickly"""
+
+        return self.seekable()
+
     @classmethod
     def __unlink__(cls, filename):
         try:
@@ -4487,6 +4699,28 @@ class WaveContainer(AudioFile):
                 total_pcm_frames=(self.total_frames() if self.lossless()
                                   else None))
 
+    def convert_many(self, targets, progress=None):
+        """encodes several new AudioFiles from existing AudioFile
+
+        takes a list of (filename string, target class, compression string)
+        tuples, where compression may be None,
+        and returns a list of the resulting objects in the same order
+
+        may raise EncodingError if some problem occurs during encoding"""
+
+        if self.has_foreign_wave_chunks():
+            # header and footer are transferred one target at a time
+            return [self.convert(target_path,
+                                 target_class,
+                                 compression,
+                                 progress)
+                    for (target_path,
+                         target_class,
+                         compression) in targets]
+        else:
+            return super(WaveContainer, self).convert_many(targets,
+                                                           progress)
+
 
 class AiffContainer(AudioFile):
     def has_foreign_aiff_chunks(self):
@@ -4560,6 +4794,28 @@ class AiffContainer(AudioFile):
                 total_pcm_frames=(self.total_frames() if self.lossless()
                                   else None))
 
+    def convert_many(self, targets, progress=None):
+        """encodes several new AudioFiles from existing AudioFile
+
+        takes a list of (filename string, target class, compression string)
+        tuples, where compression may be None,
+        and returns a list of the resulting objects in the same order
+
+        may raise EncodingError if some problem occurs during encoding"""
+
+        if self.has_foreign_aiff_chunks():
+            # header and footer are transferred one target at a time
+            return [self.convert(target_path,
+                                 target_class,
+                                 compression,
+                                 progress)
+                    for (target_path,
+                         target_class,
+                         compression) in targets]
+        else:
+            return super(AiffContainer, self).convert_many(targets,
+                                                           progress)
+
 
 class SheetException(ValueError):
     """a parent exception for CueException and TOCException"""
@@ -5062,155 +5318,6 @@ def PCMReaderWindow(pcmreader, initial_offset, pcm_frames, forward_close=True):
             forward_close=forward_close)
 
 
-class PCMReaderHead(PCMReader):
-    """a wrapper around PCMReader for truncating a stream's ending"""
-
-    def __init__(self, pcmreader, pcm_frames, forward_close=True):
-        """pcmreader is a PCMReader object
-        pcm_frames is the total number of PCM frames in the stream
-
-        if pcm_frames is shorter than the pcmreader's stream,
-        the stream will be truncated
-
-        if pcm_frames is longer than the pcmreader's stream,
-        the stream will be extended with additional empty frames
-
-        if forward_close is True, calls to .close() are forwarded
-        to the parent stream, otherwise the parent is left as-is
-        """
-
-        if pcm_frames < 0:
-            raise ValueError("invalid pcm_frames value")
-
-        PCMReader.__init__(self,
-                           sample_rate=pcmreader.sample_rate,
-                           channels=pcmreader.channels,
-                           channel_mask=pcmreader.channel_mask,
-                           bits_per_sample=pcmreader.bits_per_sample)
-
-        self.pcmreader = pcmreader
-        self.pcm_frames = pcm_frames
-        self.forward_close = forward_close
-
-    def __repr__(self):
-        return "PCMReaderHead({!r}, {!r})".format(self.pcmreader,
-                                                  self.pcm_frames)
-
-    def read(self, pcm_frames):
-        if self.pcm_frames > 0:
-            # data left in window
-            # so try to read an additional frame from PCMReader
-            frame = self.pcmreader.read(pcm_frames)
-            if frame.frames == 0:
-                # no additional data in PCMReader,
-                # so return empty frames leftover in window
-                # and close window
-                frame = pcm.from_list([0] * (self.pcm_frames * self.channels),
-                                      self.channels,
-                                      self.bits_per_sample,
-                                      True)
-                self.pcm_frames -= frame.frames
-                return frame
-            elif frame.frames <= self.pcm_frames:
-                # frame is shorter than remaining window,
-                # so shrink window and return frame unaltered
-                self.pcm_frames -= frame.frames
-                return frame
-            else:
-                # frame is larger than remaining window,
-                # so cut off end of frame
-                # close window and return shrunk frame
-                frame = frame.split(self.pcm_frames)[0]
-                self.pcm_frames -= frame.frames
-                return frame
-        else:
-            # window exhausted, so return empty framelist
-            return pcm.empty_framelist(self.channels, self.bits_per_sample)
-
-    def read_closed(self, pcm_frames):
-        raise ValueError()
-
-    def close(self):
-        if self.forward_close:
-            self.pcmreader.close()
-        self.read = self.read_closed
-
-
-class PCMReaderDeHead(PCMReader):
-    """a wrapper around PCMReader for truncating a stream's beginning"""
-
-    def __init__(self, pcmreader, pcm_frames, forward_close=True):
-        """pcmreader is a PCMReader object
-        pcm_frames is the total number of PCM frames to remove
-
-        if pcm_frames is positive, that amount of frames will be
-        removed from the beginning of the stream
-
-        if pcm_frames is negative, the stream will be padded
-        with that many PCM frames
-
-        if forward_close is True, calls to .close() are forwarded
-        to the parent stream, otherwise the parent is left as-is
-        """
-
-        PCMReader.__init__(self,
-                           sample_rate=pcmreader.sample_rate,
-                           channels=pcmreader.channels,
-                           channel_mask=pcmreader.channel_mask,
-                           bits_per_sample=pcmreader.bits_per_sample)
-
-        self.pcmreader = pcmreader
-        self.pcm_frames = pcm_frames
-        self.forward_close = forward_close
-
-    def __repr__(self):
-        return "PCMReaderDeHead({!r}, {!r})".format(self.pcmreader,
-                                                    self.pcm_frames)
-
-    def read(self, pcm_frames):
-        if self.pcm_frames == 0:
-            # no truncation or padding, so return framelists as-is
-            return self.pcmreader.read(pcm_frames)
-        elif self.pcm_frames > 0:
-            # remove PCM frames from beginning of stream
-            # until all truncation is accounted for
-            while self.pcm_frames > 0:
-                frame = self.pcmreader.read(pcm_frames)
-                if frame.frames == 0:
-                    # truncation longer than entire stream
-                    # so don't try to truncate it any further
-                    self.pcm_frames = 0
-                    return frame
-                elif frame.frames <= self.pcm_frames:
-                    self.pcm_frames -= frame.frames
-                else:
-                    (head, tail) = frame.split(self.pcm_frames)
-                    self.pcm_frames -= head.frames
-                    assert (self.pcm_frames == 0)
-                    assert (tail.frames > 0)
-                    return tail
-            else:
-                return self.pcmreader.read(pcm_frames)
-        else:
-            # pad beginning of stream with empty PCM frames
-            frame = pcm.from_list([0] *
-                                  (-self.pcm_frames) * self.channels,
-                                  self.channels,
-                                  self.bits_per_sample,
-                                  True)
-            assert (frame.frames == -self.pcm_frames)
-            self.pcm_frames = 0
-            return frame
-
-    def read_closed(self, pcm_frames):
-        raise ValueError()
-
-    def close(self):
-        if self.forward_close:
-            self.pcmreader.close()
-        self.read = self.read_closed
-
-
 # returns the value in item_list which occurs most often
 def most_numerous(item_list, empty_list=None, all_differ=None):
     """returns the value in the item list which occurs most often
@@ -5595,39 +5702,22 @@ class ExecProgressQueue(object):
         """runs all the queued jobs in parallel"""
 
         from select import select
+        from multiprocessing import Array
 
-        def execute_next_job(progress_display):
-            """pulls the next job from the queue and returns a
-            (Process, Array, Connection, progress_text, completed_text) tuple
-            where Process is the subprocess
-            Array is shared memory of the current progress
-            Connection is the listening end of a pipe
-            progress_text is unicode to display during progress
-            and completed_text is unicode to display when finished"""
-
-            # pull parameters from job queue
-            (job_index,
-             progress_text,
-             completion_output,
-             function,
-             args,
-             kwargs) = self.__queued_jobs__.popleft()
-
-            # spawn new __ProgressQueueJob__ object
-            job = __ProgressQueueJob__.spawn(
-                job_index=job_index,
-                function=function,
-                args=args,
-                kwargs=kwargs,
-                progress_text=progress_text,
-                completion_output=completion_output)
+        # every job is queued by now, so workers forked from here
+        # inherit the whole queue and need only be told
+        # which job to run next
+        jobs = list(self.__queued_jobs__)
+        self.__queued_jobs__.clear()
+        total_jobs = len(jobs)
+        next_job = 0
 
-            # add job to progress display, if any text to display
-            if progress_text is not None:
-                self.__displayed_rows__[job.job_fd()] = \
-                    progress_display.add_row(progress_text)
+        # return values from the executed functions
+        results = [None] * total_jobs
 
-            return job
+        if total_jobs == 0:
+            # nothing to do
+            return results
 
         progress_display = ProgressDisplay(self.messenger)
 
@@ -5635,45 +5725,67 @@ class ExecProgressQueue(object):
         # Note that the order a job is inserted into the queue
         # (as captured by its job_index value)
         # may differ from the order in which it is completed.
-        total_jobs = len(self.__queued_jobs__)
         completed_job_number = 1
 
-        # a dict of job file descriptors -> __ProgressQueueJob__ objects
-        job_pool = {}
+        # [current, total] progress pairs, one per worker,
+        # in a single block of shared memory
+        worker_count = min(max_processes, total_jobs)
+        progress = Array("L", [0, 1] * worker_count)
 
-        # return values from the executed functions
-        results = [None] * total_jobs
+        # a dict of worker file descriptors -> __ProgressQueueWorker__ objects
+        worker_pool = {}
 
-        if total_jobs == 0:
-            # nothing to do
-            return results
+        def execute_next_job(worker):
+            """hands the next queued job to the given idle worker"""
 
-        # populate job pool up to "max_processes" number of jobs
-        for i in range(min(max_processes, len(self.__queued_jobs__))):
-            job = execute_next_job(progress_display)
-            job_pool[job.job_fd()] = job
+            (job_index,
+             progress_text,
+             completion_output,
+             function,
+             args,
+             kwargs) = jobs[next_job]
+
+            worker.execute(job_index, completion_output)
+
+            # add job to progress display, if any text to display
+            if progress_text is not None:
+                self.__displayed_rows__[worker.worker_fd()] = \
+                    progress_display.add_row(progress_text)
 
-        # while the pool still contains running jobs
         try:
-            while len(job_pool) > 0:
+            # start up to "max_processes" number of workers
+            for slot in range(worker_count):
+                worker = __ProgressQueueWorker__.spawn(
+                    jobs,
+                    progress,
+                    slot,
+                    [w.pipe for w in worker_pool.values()])
+                worker_pool[worker.worker_fd()] = worker
+                execute_next_job(worker)
+                next_job += 1
+
+            # while any workers are still running jobs
+            while len(worker_pool) > 0:
                 # wait for zero or more jobs to finish (may timeout)
                 (rlist,
                  wlist,
-                 elist) = select(job_pool.keys(), [], [], 0.25)
+                 elist) = select(worker_pool.keys(), [], [], 0.25)
 
                 # clear out old display
                 progress_display.clear_rows()
 
-                for finished_job in [job_pool[fd] for fd in rlist]:
-                    job_fd = finished_job.job_fd()
+                for finished_worker in [worker_pool[fd] for fd in rlist]:
+                    worker_fd = finished_worker.worker_fd()
 
-                    (exception, result) = finished_job.result()
+                    (job_index,
+                     completion_output,
+                     exception,
+                     result) = finished_worker.result()
 
                     if not exception:
                         # job completed successfully
 
                         # display any output message attached to job
-                        completion_output = finished_job.completion_output
                         if callable(completion_output):
                             output = completion_output(result)
                         else:
@@ -5686,7 +5798,7 @@ class ExecProgressQueue(object):
                                                 total_jobs))
 
                         # attach result to output in the order it was received
-                        results[finished_job.job_index] = result
+                        results[job_index] = result
                     else:
                         # job raised an exception
 
@@ -5694,37 +5806,41 @@ class ExecProgressQueue(object):
                         # then raise exception to caller
                         # once working jobs are finished
                         self.__raised_exception__ = result
-                        while len(self.__queued_jobs__) > 0:
-                            self.__queued_jobs__.popleft()
-
-                    # remove job from pool
-                    del (job_pool[job_fd])
+                        next_job = total_jobs
 
                     # remove job from progress display, if present
-                    if job_fd in self.__displayed_rows__:
-                        self.__displayed_rows__[job_fd].finish()
-
-                    # add new jobs from the job queue, if any
-                    if len(self.__queued_jobs__) > 0:
-                        job = execute_next_job(progress_display)
-                        job_pool[job.job_fd()] = job
+                    if worker_fd in self.__displayed_rows__:
+                        self.__displayed_rows__[worker_fd].finish()
+                        del(self.__displayed_rows__[worker_fd])
+
+                    if next_job < total_jobs:
+                        # give the worker the next job from the queue
+                        execute_next_job(finished_worker)
+                        next_job += 1
+                    else:
+                        # or retire it if there are none left
+                        del(worker_pool[worker_fd])
+                        finished_worker.stop()
 
                     # updated completed job number for X/Y display
                     completed_job_number += 1
 
                 # update progress rows with progress taken from shared memory
-                for job in job_pool.values():
-                    if job.job_fd() in self.__displayed_rows__:
-                        self.__displayed_rows__[job.job_fd()].update(
-                            job.progress())
+                for worker in worker_pool.values():
+                    if worker.worker_fd() in self.__displayed_rows__:
+                        self.__displayed_rows__[worker.worker_fd()].update(
+                            worker.progress())
 
                 # display new set of progress rows
                 progress_display.display_rows()
         except:
             # an exception occurred (perhaps KeyboardInterrupt)
-            # so kill any running child jobs
-            # clear any progress rows
+            # so clear any progress rows
             progress_display.clear_rows()
+            self.__displayed_rows__.clear()
+            # and let workers exit once their current jobs are done
+            for worker in worker_pool.values():
+                worker.close()
             # and pass exception to caller
             raise
 
@@ -5737,141 +5853,156 @@ class ExecProgressQueue(object):
             return results
 
 
-class __ProgressQueueJob__(object):
-    """this class is a the parent process end of a running child job"""
-
-    def __init__(self,
-                 job_index,
-                 process,
-                 progress,
-                 lock,
-                 result_pipe,
-                 progress_text,
-                 completion_output):
-        """job_index is the order this job was inserted into the queue
-
-        process is the Process object of the running child
-
-        progress is an Array object of [current, total] progress status
+class __ProgressQueueWorker__(object):
+    """this class is the parent process end of a running child worker
+    which executes queued jobs one at a time until told to stop"""
 
-        lock is a Lock object to synchronize access to "progress"
+    def __init__(self, process, progress, slot, pipe):
+        """process is the Process object of the running child
 
-        result_pipe is a Connection object which will be read for data
+        progress is an Array object of [current, total] progress pairs
 
-        progress_text is unicode to display while the job is in progress
+        slot is the index of this worker's pair in "progress"
 
-        completion_output is either unicode or a callable function
-        to be displayed when the job finishes
+        pipe is a Connection object which sends job indexes to the child
+        and will be read for data
         """
 
-        self.job_index = job_index
         self.process = process
         self.__progress__ = progress
-        self.__lock__ = lock
-        self.result_pipe = result_pipe
-        self.progress_text = progress_text
-        self.completion_output = completion_output
+        self.__slot__ = slot
+        self.pipe = pipe
+        self.job_index = None
+        self.completion_output = None
 
-    def job_fd(self):
-        """returns file descriptor of parent-side result pipe"""
+    def worker_fd(self):
+        """returns file descriptor of parent-side pipe"""
 
-        return self.result_pipe.fileno()
+        return self.pipe.fileno()
 
     def progress(self):
-        self.__lock__.acquire()
-        (current, total) = self.__progress__
-        self.__lock__.release()
+        with self.__progress__.get_lock():
+            current = self.__progress__[self.__slot__ * 2]
+            total = self.__progress__[self.__slot__ * 2 + 1]
         if total > 0:
             return Fraction(current, total)
         else:
             return Fraction(0, 1)
 
     @classmethod
-    def spawn(cls,
-              job_index,
-              function,
-              args,
-              kwargs,
-              progress_text,
-              completion_output):
+    def spawn(cls, jobs, progress, slot, other_pipes):
         """spawns a subprocess and returns the parent-side
-        __ProgressQueueJob__ object
-
-        job_index is the order this job was inserted into the queue
-
-        function is the function to execute
+        __ProgressQueueWorker__ object
 
-        args is a tuple of positional arguments
+        jobs is a list of
+        (job_index, progress_text, completion_output, function, args, kwargs)
+        tuples which the child inherits when forked
 
-        kwargs is a dict of keyword arguments
+        progress is an Array object of [current, total] progress pairs
 
-        progress_text is unicode to display while the job is in progress
+        slot is the index of the worker's pair in "progress"
 
-        completion_output is either unicode or a callable function
-        to be displayed when the job finishes
+        other_pipes is a list of parent-side Connection objects
+        of previously spawned workers
         """
 
         class __progress__(object):
-            def __init__(self, memory, lock):
+            def __init__(self, memory, slot):
                 self.memory = memory
-                self.lock = lock
+                self.slot = slot
 
             def update(self, progress):
-                self.lock.acquire()
-                self.memory[0] = progress.numerator
-                self.memory[1] = progress.denominator
-                self.lock.release()
+                with self.memory.get_lock():
+                    self.memory[self.slot * 2] = progress.numerator
+                    self.memory[self.slot * 2 + 1] = progress.denominator
 
-        def execute_job(function, args, kwargs, progress, result_pipe):
-            try:
-                result_pipe.send((False, function(*args,
-                                                  progress=progress,
-                                                  **kwargs)))
-            except Exception as exception:
-                result_pipe.send((True, exception))
-
-            result_pipe.close()
+        def execute_jobs(jobs, progress, pipe, parent_pipes):
+            # close the parent-side pipes inherited by forking
+            # so that the worker sees the end of its own pipe
+            # if the parent goes away
+            for parent_pipe in parent_pipes:
+                parent_pipe.close()
 
-        from multiprocessing import Process, Array, Pipe, Lock
+            try:
+                job_index = pipe.recv()
+                while job_index is not None:
+                    (job_index,
+                     progress_text,
+                     completion_output,
+                     function,
+                     args,
+                     kwargs) = jobs[job_index]
+                    try:
+                        pipe.send((False, function(*args,
+                                                   progress=progress,
+                                                   **kwargs)))
+                    except Exception as exception:
+                        pipe.send((True, exception))
+                    job_index = pipe.recv()
+            except (KeyboardInterrupt, EOFError, IOError, OSError):
+                # parent has been interrupted
+                pass
 
-        # construct shared memory array to store progress
-        progress = Array("L", [0, 1])
+            pipe.close()
 
-        # construct lock to keep array access process-safe
-        lock = Lock()
+        from multiprocessing import Process, Pipe
 
-        # construct one-way pipe to collect result
-        (parent_conn, child_conn) = Pipe(False)
+        # construct two-way pipe for job indexes and results
+        (parent_conn, child_conn) = Pipe(True)
 
-        # build child job to execute function
-        process = Process(target=execute_job,
-                          args=(function,
-                                args,
-                                kwargs,
-                                __progress__(progress, lock).update,
-                                child_conn))
+        # build child worker to execute jobs
+        process = Process(target=execute_jobs,
+                          args=(jobs,
+                                __progress__(progress, slot).update,
+                                child_conn,
+                                other_pipes + [parent_conn]))
 
-        # start child job
+        # start child worker
         process.start()
+        child_conn.close()
 
-        # return populated __ProgressQueueJob__ object
-        return cls(job_index=job_index,
-                   process=process,
+        # return populated __ProgressQueueWorker__ object
+        return cls(process=process,
                    progress=progress,
-                   lock=lock,
-                   result_pipe=parent_conn,
-                   progress_text=progress_text,
-                   completion_output=completion_output)
+                   slot=slot,
+                   pipe=parent_conn)
+
+    def execute(self, job_index, completion_output):
+        """has the child execute the given queued job"""
+
+        self.job_index = job_index
+        self.completion_output = completion_output
+        with self.__progress__.get_lock():
+            self.__progress__[self.__slot__ * 2] = 0
+            self.__progress__[self.__slot__ * 2 + 1] = 1
+        self.pipe.send(job_index)
 
     def result(self):
-        """returns (exception, result) from parent-side pipe
+        """returns (job_index, completion_output, exception, result)
+        from parent-side pipe for the child's current job
         where exception is True if result is an exception
         or False if it's the result of the called child function"""
 
-        (exception, result) = self.result_pipe.recv()
-        self.result_pipe.close()
+        (exception, result) = self.pipe.recv()
+        return (self.job_index, self.completion_output, exception, result)
+
+    def stop(self):
+        """tells the idle child to exit and waits for it to do so"""
+
+        self.pipe.send(None)
+        self.pipe.close()
         self.process.join()
-        return (exception, result)
+
+    def close(self):
+        """tells the child to exit once its current job is finished
+        without waiting for it to do so"""
+
+        try:
+            self.pipe.send(None)
+        except (IOError, OSError):
+            # child has already exited
+            pass
+        self.pipe.close()
 
 
 class TemporaryFile(object):
@@ -2100,6 +2100,15 @@ class FlacAudio(WaveContainer, AiffContainer):
 
         return self.get_metadata().has_block(Flac_SEEKTABLE.BLOCK_ID)
 
+    def can_seek(self):
+        """returns True if the file's PCMReader can .seek()
+        to a given PCM frame without decoding everything before it
+
+        without a SEEKTABLE, FlacDecoder finds the frame
+        by scanning frame headers instead"""
+
+        return True
+
     def seektable(self, offsets=None, seekpoint_interval=None):
         """returns a new Flac_SEEKTABLE object
         created from parsing the FLAC file itself"""
@@ -2107,13 +2116,11 @@ class FlacAudio(WaveContainer, AiffContainer):
         from bisect import bisect_right
 
         if offsets is None:
-            sizes = []
             with self.to_pcm() as pcmreader:
-                pair = pcmreader.frame_size()
-                while pair is not None:
-                    sizes.append(pair)
-                    pair = pcmreader.frame_size()
-            offsets = sizes_to_offsets(sizes)
+                offsets = [(byte_offset, pcm_frames) for
+                           (byte_offset,
+                            sample_number,
+                            pcm_frames) in pcmreader.index()]
 
         if seekpoint_interval is None:
             seekpoint_interval = self.sample_rate() * 10
@@ -2831,17 +2838,17 @@ class FlacAudio(WaveContainer, AiffContainer):
 
             # fix empty MD5SUM
             if self.__md5__ == b"\x00" * 16:
-                from hashlib import md5
-                from audiotools import transfer_framelist_data
-
-                md5sum = md5()
-                transfer_framelist_data(
-                    self.to_pcm(),
-                    md5sum.update,
-                    signed=True,
-                    big_endian=False)
+                from audiotools.pcm import md5sums
+
+                pcmreader = self.to_pcm()
+                try:
+                    [md5sum] = md5sums([pcmreader],
+                                       signed=True,
+                                       big_endian=False)
+                finally:
+                    pcmreader.close()
                 metadata.get_block(
-                    Flac_STREAMINFO.BLOCK_ID).md5sum = md5sum.digest()
+                    Flac_STREAMINFO.BLOCK_ID).md5sum = md5sum
                 from audiotools.text import CLEAN_FLAC_POPULATE_MD5
                 fixes_performed.append(CLEAN_FLAC_POPULATE_MD5)
 
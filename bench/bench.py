@@ -0,0 +1,565 @@
+#!/usr/bin/python
+
+# Audio Tools, a module and set of tools for manipulating audio data
+# Copyright (C) 2007-2016  Brian Langenberger
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+"""throughput benchmarks for the standalone codecs and bitstream module
+
+every codec is run as a standalone executable built by "make bench"
+over synthetic signals from the Sine_Mono, Sine_Stereo, Sine_Simple
+and SameSample generators, so results are reproducible between runs
+and between machines
+
+results are written as JSON where "samples_per_second" counts PCM frames
+(one sample per channel), "mb_per_second" counts raw PCM bytes
+(in units of 1,000,000 bytes) and "peak_rss_kb" is the codec's
+maximum resident set size, or the benchmark's own for bitstream operations
+
+"bitstream_primitives" holds the nanoseconds per operation
+of each BitstreamReader/BitstreamWriter primitive in C
+as measured by the standalone bitstream-bench executable"""
+
+import sys
+import os
+import os.path
+import time
+import json
+import platform
+import tempfile
+import resource
+from hashlib import md5
+from subprocess import (Popen, PIPE)
+
+from audiotools.decoders import (Sine_Mono,
+                                 Sine_Stereo,
+                                 Sine_Simple,
+                                 SameSample)
+from audiotools.bitstream import (BitstreamReader,
+                                  BitstreamRecorder,
+                                  HuffmanTree)
+
+
+BENCHMARK_VERSION = 1
+
+# signal name -> (channels, bits_per_sample, generator)
+# where generator is a function taking a PCM frame count
+# and returning a PCMReader-compatible object
+#
+# the parameters are the same ones the format tests use
+SIGNALS = [
+    ("sine16_mono",
+     1, 16,
+     lambda frames: Sine_Mono(16, frames, 44100,
+                              441.0, 0.50, 661.5, 0.49)),
+    ("sine16_stereo",
+     2, 16,
+     lambda frames: Sine_Stereo(16, frames, 44100,
+                                8820.0, 0.70, 4410.0, 0.29, 1.0)),
+    ("sine24_stereo",
+     2, 24,
+     lambda frames: Sine_Stereo(24, frames, 44100,
+                                441.0, 0.50, 4410.0, 0.49, 1.0)),
+    ("simple16_mono",
+     1, 16,
+     lambda frames: Sine_Simple(frames, 16, 44100, 5000, 40)),
+    ("silence16_stereo",
+     2, 16,
+     lambda frames: SameSample(sample=0,
+                               total_pcm_frames=frames,
+                               sample_rate=44100,
+                               channels=2,
+                               channel_mask=0x3,
+                               bits_per_sample=16))]
+
+# FLAC compression levels, matching FlacAudio.from_pcm()
+FLAC_LEVELS = {
+    "0": ["-B", "1152", "-l", "0", "-P", "0", "-R", "3"],
+    "1": ["-B", "1152", "-l", "0", "-M", "-P", "0", "-R", "3"],
+    "2": ["-B", "1152", "-l", "0", "-e", "-P", "0", "-R", "3"],
+    "3": ["-B", "4096", "-l", "6", "-P", "0", "-R", "4"],
+    "4": ["-B", "4096", "-l", "8", "-M", "-P", "0", "-R", "4"],
+    "5": ["-B", "4096", "-l", "8", "-m", "-P", "0", "-R", "5"],
+    "6": ["-B", "4096", "-l", "8", "-m", "-P", "0", "-R", "6"],
+    "7": ["-B", "4096", "-l", "8", "-m", "-e", "-P", "0", "-R", "6"],
+    "8": ["-B", "4096", "-l", "12", "-m", "-e", "-P", "0", "-R", "6"]}
+
+# codec name -> (encoder, decoder, suffix, compression levels)
+# where compression levels maps level names to extra encoder arguments
+CODECS = [
+    ("flac", "flacenc", "flacdec", "flac", FLAC_LEVELS),
+    ("alac", "alacenc", "alacdec", "m4a", {"": []}),
+    ("tta", "ttaenc", "ttadec", "tta", {"": []})]
+
+
+def write_signal(generator, frames, path):
+    """writes the generator's PCM frames to path
+    as signed, little-endian raw PCM
+    and returns the MD5 sum of that data"""
+
+    reader = generator(frames)
+    md5sum = md5()
+    with open(path, "wb") as f:
+        framelist = reader.read(4096)
+        while len(framelist) > 0:
+            data = framelist.to_bytes(False, True)
+            md5sum.update(data)
+            f.write(data)
+            framelist = reader.read(4096)
+    reader.close()
+    return md5sum.hexdigest()
+
+
+def file_md5(path):
+    md5sum = md5()
+    with open(path, "rb") as f:
+        data = f.read(1 << 20)
+        while len(data) > 0:
+            md5sum.update(data)
+            data = f.read(1 << 20)
+    return md5sum.hexdigest()
+
+
+def peak_rss(pid):
+    """returns the peak resident set size in KB of the running process
+    or None if it is unavailable"""
+
+    try:
+        with open("/proc/{:d}/status".format(pid), "r") as f:
+            for line in f:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1])
+    except (IOError, ValueError):
+        pass
+    return None
+
+
+def run(args, stdin_path=None, stdout_path=None, sample_rss=False):
+    """runs the given argument list with optional input/output files
+
+    returns (wall seconds, CPU seconds, peak RSS in KB)
+    or raises ValueError if the program exits with an error
+
+    the rusage of a child started from Python includes
+    the peak of the Python process it was forked from,
+    so if sample_rss is True the child's own peak is sampled
+    from /proc while it runs, which is more accurate
+    but perturbs the timings"""
+
+    devnull = open(os.devnull, "r+b")
+    stdin = open(stdin_path, "rb") if stdin_path else devnull
+    stdout = open(stdout_path, "wb") if stdout_path else devnull
+    rss = None
+    try:
+        start = time.time()
+        sub = Popen(args, stdin=stdin, stdout=stdout, stderr=devnull)
+        if sample_rss:
+            (pid, status, usage) = os.wait4(sub.pid, os.WNOHANG)
+            while pid == 0:
+                sample = peak_rss(sub.pid)
+                if (sample is not None) and ((rss is None) or (sample > rss)):
+                    rss = sample
+                time.sleep(0.001)
+                (pid, status, usage) = os.wait4(sub.pid, os.WNOHANG)
+        else:
+            (pid, status, usage) = os.wait4(sub.pid, 0)
+        wall = time.time() - start
+        sub.returncode = status
+    finally:
+        if stdin_path:
+            stdin.close()
+        if stdout_path:
+            stdout.close()
+        devnull.close()
+
+    if status != 0:
+        raise ValueError("{} exited with status {}".format(args[0], status))
+
+    if rss is None:
+        rss = usage.ru_maxrss
+        if sys.platform == "darwin":
+            # macOS reports bytes rather than kilobytes
+            rss //= 1024
+    return (wall, usage.ru_utime + usage.ru_stime, rss)
+
+
+def measure(args, repeat, frames, pcm_bytes,
+            stdin_path=None, stdout_path=None):
+    """runs args repeat times, plus once more to sample its memory use,
+    and returns a dict of throughput figures from the fastest run"""
+
+    timings = [run(args, stdin_path, stdout_path) for i in range(repeat)]
+    (wall, cpu, rss) = run(args, stdin_path, stdout_path, sample_rss=True)
+
+    walls = sorted(t[0] for t in timings)
+    best = min(timings, key=lambda t: t[0])
+    return {"runs": len(timings),
+            "best_seconds": round(best[0], 6),
+            "median_seconds": round(walls[len(walls) // 2], 6),
+            "cpu_seconds": round(best[1], 6),
+            "samples_per_second": round(frames / best[0], 1),
+            "mb_per_second": round(pcm_bytes / best[0] / 1e6, 3),
+            "peak_rss_kb": rss}
+
+
+def bench_codecs(bin_dir, work_dir, frames, repeat, codecs, signals):
+    results = []
+    for (signal, channels, bits_per_sample, generator) in SIGNALS:
+        if signals and (signal not in signals):
+            continue
+
+        pcm_path = os.path.join(work_dir, signal + ".pcm")
+        pcm_md5 = write_signal(generator, frames, pcm_path)
+        pcm_bytes = os.path.getsize(pcm_path)
+        decoded_path = os.path.join(work_dir, signal + ".decoded")
+
+        for (codec, encoder, decoder, suffix, levels) in CODECS:
+            if codecs and (codec not in codecs):
+                continue
+
+            for level in sorted(levels.keys()):
+                encoded_path = os.path.join(
+                    work_dir, "{}.{}".format(signal, suffix))
+                encode_args = ([os.path.join(bin_dir, encoder),
+                                "-c", str(channels),
+                                "-r", "44100",
+                                "-b", str(bits_per_sample),
+                                "-T", str(frames)] +
+                               levels[level] + [encoded_path])
+                decode_args = [os.path.join(bin_dir, decoder), encoded_path]
+
+                encode = measure(encode_args, repeat, frames, pcm_bytes,
+                                 stdin_path=pcm_path)
+                encoded_bytes = os.path.getsize(encoded_path)
+
+                decode = measure(decode_args, repeat, frames, pcm_bytes,
+                                 stdout_path=decoded_path)
+
+                results.append(
+                    {"codec": codec,
+                     "level": level,
+                     "signal": signal,
+                     "channels": channels,
+                     "bits_per_sample": bits_per_sample,
+                     "pcm_frames": frames,
+                     "pcm_bytes": pcm_bytes,
+                     "encoded_bytes": encoded_bytes,
+                     "verified": file_md5(decoded_path) == pcm_md5,
+                     "encode": encode,
+                     "decode": decode})
+
+                os.unlink(encoded_path)
+                sys.stderr.write("{} {} {}\n".format(codec, level, signal))
+
+        os.unlink(pcm_path)
+        if os.path.isfile(decoded_path):
+            os.unlink(decoded_path)
+
+    return results
+
+
+def time_operation(function, repeat):
+    """calls function() repeat times
+    and returns (best wall seconds, peak RSS in KB) of those calls"""
+
+    best = None
+    for i in range(repeat):
+        start = time.time()
+        function()
+        elapsed = time.time() - start
+        if (best is None) or (elapsed < best):
+            best = elapsed
+    return (best, resource.getrusage(resource.RUSAGE_SELF).ru_maxrss)
+
+
+def bench_bitstream(count, repeat):
+    """benchmarks the bitstream module's reader and writer
+
+    fixed-width fields go through parse() and build()
+    so that each call handles many fields in C,
+    unary and Huffman codes are one Python call per value
+    so their figures include interpreter overhead"""
+
+    results = []
+
+    for little_endian in [False, True]:
+        endianness = "little" if little_endian else "big"
+        tree = HuffmanTree([[1, 1], 0,
+                            [1, 0], 1,
+                            [0, 1], 2,
+                            [0, 0, 1], 3,
+                            [0, 0, 0], 4], little_endian)
+
+        for bits in [1, 4, 16, 24]:
+            format_string = "{:d}u".format(bits) * 1024
+            values = [i % (1 << bits) for i in range(1024)]
+            writes = count // 1024
+
+            def write():
+                w = BitstreamRecorder(little_endian)
+                for i in range(writes):
+                    w.build(format_string, values)
+                w.flush()
+                return w
+
+            data = write().data()
+
+            def read():
+                r = BitstreamReader(data, little_endian)
+                for i in range(writes):
+                    r.parse(format_string)
+
+            for (operation, function) in [("write", write), ("read", read)]:
+                (seconds, rss) = time_operation(function, repeat)
+                results.append(
+                    {"operation": operation,
+                     "endianness": endianness,
+                     "bits": bits,
+                     "operations": writes * 1024,
+                     "bytes": len(data),
+                     "ns_per_operation": round(
+                         seconds * 1e9 / (writes * 1024), 2),
+                     "mb_per_second": round(len(data) / seconds / 1e6, 3),
+                     "peak_rss_kb": rss})
+
+        values = [i % 16 for i in range(count // 16)]
+
+        def write_unary():
+            w = BitstreamRecorder(little_endian)
+            unary = w.unary
+            for v in values:
+                unary(1, v)
+            w.flush()
+            return w
+
+        def write_huffman():
+            w = BitstreamRecorder(little_endian)
+            write_huffman_code = w.write_huffman_code
+            for v in values:
+                write_huffman_code(tree, v % 5)
+            w.flush()
+            return w
+
+        unary_data = write_unary().data()
+        huffman_data = write_huffman().data()
+
+        def read_unary():
+            unary = BitstreamReader(unary_data, little_endian).unary
+            for v in values:
+                unary(1)
+
+        def read_huffman():
+            read_huffman_code = BitstreamReader(huffman_data,
+                                                little_endian).read_huffman_code
+            for v in values:
+                read_huffman_code(tree)
+
+        for (operation, function, data) in [
+                ("write_unary", write_unary, unary_data),
+                ("read_unary", read_unary, unary_data),
+                ("write_huffman_code", write_huffman, huffman_data),
+                ("read_huffman_code", read_huffman, huffman_data)]:
+            (seconds, rss) = time_operation(function, repeat)
+            results.append(
+                {"operation": operation,
+                 "endianness": endianness,
+                 "operations": len(values),
+                 "bytes": len(data),
+                 "ns_per_operation": round(seconds * 1e9 / len(values), 2),
+                 "mb_per_second": round(len(data) / seconds / 1e6, 3),
+                 "peak_rss_kb": rss})
+
+    return results
+
+
+def train(work_dir, frames):
+    """runs every signal through the extension modules
+    rather than the standalone executables
+    so a profile-generating build records a representative profile
+
+    each lossless format is encoded at its fastest, default
+    and slowest compression modes and decoded again,
+    and each signal is resampled, dithered down, downmixed
+    and has its ReplayGain calculated
+
+    raises ValueError if any decoded signal differs from its input"""
+
+    import audiotools
+
+    formats = [audiotools.FlacAudio,
+               audiotools.ALACAudio,
+               audiotools.TrueAudio,
+               audiotools.WavPackAudio,
+               audiotools.WaveAudio]
+
+    for audio_class in formats:
+        if not (audio_class.supports_from_pcm() and
+                audio_class.supports_to_pcm()):
+            continue
+        modes = audio_class.COMPRESSION_MODES
+        for compression in sorted(set([modes[0],
+                                       audio_class.DEFAULT_COMPRESSION,
+                                       modes[-1]])):
+            path = os.path.join(work_dir, "train." + audio_class.SUFFIX)
+            for (name, channels, bits_per_sample, generator) in SIGNALS:
+                sys.stderr.write("{} {} {}\n".format(audio_class.NAME,
+                                                      compression,
+                                                      name))
+                track = audio_class.from_pcm(path,
+                                             generator(frames),
+                                             compression,
+                                             total_pcm_frames=frames)
+                if audiotools.pcm_frame_cmp(track.to_pcm(),
+                                            generator(frames)) is not None:
+                    raise ValueError("{} {} {} mismatch".format(
+                        audio_class.NAME, compression, name))
+            os.unlink(path)
+
+    for (name, channels, bits_per_sample, generator) in SIGNALS:
+        sys.stderr.write("PCMConverter {}\n".format(name))
+        for (sample_rate, channels, bits_per_sample) in [(48000, 2, 16),
+                                                         (44100, 1, 8),
+                                                         (22050, 1, 24)]:
+            pcmreader = generator(frames)
+            audiotools.transfer_framelist_data(
+                audiotools.PCMConverter(pcmreader,
+                                        sample_rate=sample_rate,
+                                        channels=channels,
+                                        channel_mask=0,
+                                        bits_per_sample=bits_per_sample),
+                lambda f: None)
+
+        sys.stderr.write("ReplayGain {}\n".format(name))
+        with audiotools.ReplayGainCalculator(44100).to_pcm(
+                generator(frames)) as pcmreader:
+            audiotools.transfer_data(pcmreader.read, lambda f: None)
+
+    bench_bitstream(1 << 16, 1)
+
+
+def bench_bitstream_primitives(bin_dir, count, repeat):
+    """runs the bitstream-bench executable in bin_dir
+    and returns its list of results, or None if it isn't built"""
+
+    executable = os.path.join(bin_dir, "bitstream-bench")
+    if not os.path.isfile(executable):
+        return None
+
+    sub = Popen([executable,
+                 "--json",
+                 "--ops", str(count),
+                 "--repeat", str(repeat)],
+                stdout=PIPE)
+    (output, errors) = sub.communicate()
+    if sub.returncode != 0:
+        raise ValueError("bitstream-bench exited with %d" % (sub.returncode))
+    return json.loads(output.decode("ascii"))
+
+
+if (__name__ == "__main__"):
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description="run codec and bitstream throughput benchmarks")
+
+    parser.add_argument("--bin-dir",
+                        dest="bin_dir",
+                        default=os.path.join(os.path.dirname(
+                            os.path.abspath(__file__)), os.pardir, "src"),
+                        help="directory containing standalone codecs")
+
+    parser.add_argument("--seconds",
+                        dest="seconds",
+                        type=int,
+                        default=10,
+                        help="length of each synthetic signal at 44100Hz")
+
+    parser.add_argument("--repeat",
+                        dest="repeat",
+                        type=int,
+                        default=3,
+                        help="number of times to run each benchmark")
+
+    parser.add_argument("--codec",
+                        dest="codecs",
+                        action="append",
+                        choices=[c[0] for c in CODECS],
+                        help="only benchmark the given codec")
+
+    parser.add_argument("--signal",
+                        dest="signals",
+                        action="append",
+                        choices=[s[0] for s in SIGNALS],
+                        help="only benchmark the given signal")
+
+    parser.add_argument("--no-bitstream",
+                        dest="bitstream",
+                        action="store_false",
+                        default=True,
+                        help="skip the bitstream module benchmarks")
+
+    parser.add_argument("--train",
+                        dest="train",
+                        action="store_true",
+                        default=False,
+                        help="exercise the extension modules " +
+                        "for a profile-guided build and exit")
+
+    parser.add_argument("-o", "--output",
+                        dest="output",
+                        help="JSON output file, defaults to stdout")
+
+    options = parser.parse_args()
+
+    work_dir = tempfile.mkdtemp(prefix="audiotools-bench-")
+
+    if options.train:
+        try:
+            train(work_dir, options.seconds * 44100)
+        finally:
+            os.rmdir(work_dir)
+        sys.exit(0)
+    try:
+        report = {"version": BENCHMARK_VERSION,
+                  "system": {"machine": platform.machine(),
+                             "platform": platform.platform(),
+                             "python": platform.python_version(),
+                             "cflags": os.environ.get("BENCH_FLAGS", "")},
+                  "codecs": bench_codecs(os.path.abspath(options.bin_dir),
+                                         work_dir,
+                                         options.seconds * 44100,
+                                         options.repeat,
+                                         options.codecs,
+                                         options.signals)}
+        if options.bitstream:
+            report["bitstream"] = bench_bitstream(1 << 20, options.repeat)
+            primitives = bench_bitstream_primitives(
+                os.path.abspath(options.bin_dir), 1 << 20, options.repeat)
+            if primitives is not None:
+                report["bitstream_primitives"] = primitives
+    finally:
+        for name in os.listdir(work_dir):
+            os.unlink(os.path.join(work_dir, name))
+        os.rmdir(work_dir)
+
+    if options.output:
+        with open(options.output, "w") as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+    else:
+        json.dump(report, sys.stdout, indent=2, sort_keys=True)
+        sys.stdout.write("\n")
+
+    sys.exit(0 if all(r["verified"] for r in report["codecs"]) else 1)
@@ -35,6 +35,7 @@ import re
 import subprocess
 from distutils.core import setup, Extension
 from distutils.command.build_ext import build_ext as _build_ext
+from distutils.errors import DistutilsOptionError
 try:
     from configparser import (RawConfigParser, NoSectionError, NoOptionError)
 except ImportError:
@@ -45,6 +46,26 @@ configfile = RawConfigParser()
 configfile.read(["setup.cfg"])
 
 
+def build_option(option):
+    """returns True if the given option in setup.cfg's
+    Build section is enabled, False if not
+
+    default is False"""
+
+    try:
+        return configfile.getboolean("Build", option)
+    except (NoSectionError, NoOptionError, ValueError):
+        return False
+
+
+# codec stage counters add a check to every timed stage
+# so they're only compiled in on request
+if build_option("stats"):
+    STATS_DEFINES = [("AUDIOTOOLS_STATS", None)]
+else:
+    STATS_DEFINES = []
+
+
 VERSION = re.search(r'VERSION\s*=\s"(.+?)"',
                     open(os.path.join(
                         os.path.dirname(sys.argv[0]),
@@ -353,7 +374,71 @@ class output_table_blank(object):
 
 
 class build_ext(_build_ext):
+    user_options = _build_ext.user_options + [
+        ("lto", None,
+         "compile with -O3 and link-time optimization"),
+        ("profile=", None,
+         "\"generate\" to build modules which record a profile when run, "
+         "\"use\" to optimize modules with that recorded profile"),
+        ("profile-dir=", None,
+         "directory for profile data [default: build/profile]")]
+
+    boolean_options = _build_ext.boolean_options + ["lto"]
+
+    def initialize_options(self):
+        _build_ext.initialize_options(self)
+        self.lto = 0
+        self.profile = None
+        self.profile_dir = None
+
+    def finalize_options(self):
+        _build_ext.finalize_options(self)
+
+        if self.profile not in (None, "generate", "use"):
+            raise DistutilsOptionError(
+                "profile must be \"generate\" or \"use\"")
+
+        if self.profile_dir is None:
+            self.profile_dir = os.path.join("build", "profile")
+        # GCC names profile data after each object's absolute path
+        # so the directory must be the same for both builds
+        self.profile_dir = os.path.abspath(self.profile_dir)
+
+        # the sources don't change between a profile-generating build
+        # and a profile-using one, so every module must be rebuilt
+        if self.profile is not None:
+            self.force = 1
+
+    def optimization_args(self):
+        """returns a list of arguments for both the compiler and linker
+        for the requested optimization options"""
+
+        args = []
+        if self.lto:
+            args.extend(["-O3", "-flto"])
+        if self.profile == "generate":
+            args.append("-fprofile-generate={}".format(self.profile_dir))
+        elif self.profile == "use":
+            if not os.path.isdir(self.profile_dir):
+                raise DistutilsOptionError(
+                    "no profile data in \"{}\"".format(self.profile_dir))
+            # -fprofile-correction tolerates the inexact counts
+            # recorded by the codecs' worker threads
+            # and modules the training run never loads have no profile
+            args.extend(["-fprofile-use={}".format(self.profile_dir),
+                         "-fprofile-correction",
+                         "-Wno-missing-profile"])
+        return args
+
     def build_extensions(self):
+        args = self.optimization_args()
+        if args:
+            for extension in self.extensions:
+                extension.extra_compile_args = (extension.extra_compile_args +
+                                                args)
+                extension.extra_link_args = (extension.extra_link_args +
+                                             args)
+
         _build_ext.build_extensions(self)
 
         # lib_name -> ([used for, ...], is present)
@@ -517,7 +602,8 @@ class audiotools_cdio(Extension):
 
             sources.extend(["src/cdiomodule.c",
                             "src/framelist.c",
-                            "src/pcm_conv.c"])
+                            "src/pcm_conv.c",
+                            "src/common/cpu.c"])
 
             self.__library_manifest__.append(("libcdio",
                                               "CDDA data extraction",
@@ -568,7 +654,8 @@ class audiotools_dvdaudio(Extension):
 
             sources.extend(["src/dvdamodule.c",
                             "src/framelist.c",
-                            "src/pcm_conv.c"])
+                            "src/pcm_conv.c",
+                            "src/common/cpu.c"])
 
             self.__library_manifest__.append(("libdvd-audio",
                                               "DVD-Audio data extraction",
@@ -603,7 +690,10 @@ class audiotools_pcm(Extension):
         Extension.__init__(self,
                            "audiotools.pcm",
                            sources=["src/pcm.c",
-                                    "src/pcm_conv.c"],
+                                    "src/pcmreader.c",
+                                    "src/pcm_conv.c",
+                                    "src/common/md5.c",
+                                    "src/common/cpu.c"],
                            define_macros=[("PCM_MODULE", None)])
 
 
@@ -622,8 +712,12 @@ class audiotools_pcmconverter(Extension):
                                     "src/samplerate/samplerate.c",
                                     "src/samplerate/src_sinc.c",
                                     "src/samplerate/src_zoh.c",
-                                    "src/samplerate/src_linear.c"],
-                           define_macros=[("HAS_PYTHON", None)])
+                                    "src/samplerate/src_linear.c",
+                                    "src/common/stats.c",
+                                    "src/common/cpu.c"],
+                           define_macros=[("HAS_PYTHON", None)] +
+                           STATS_DEFINES,
+                           libraries=["pthread"] if STATS_DEFINES else [])
 
 
 class audiotools_replaygain(Extension):
@@ -644,7 +738,8 @@ class audiotools_decoders(Extension):
     def __init__(self, system_libraries):
         self.__library_manifest__ = []
 
-        defines = [("VERSION", VERSION), ("HAS_PYTHON", None)]
+        defines = ([("VERSION", VERSION), ("HAS_PYTHON", None)] +
+                   STATS_DEFINES)
         sources = ["src/pcm_conv.c",
                    "src/framelist.c",
                    "src/bitstream.c",
@@ -672,8 +767,10 @@ class audiotools_decoders(Extension):
                    "src/decoders/tta.c",
                    "src/decoders/mpc.c",
                    "src/decoders/sine.c",
+                   "src/common/stats.c",
+                   "src/common/cpu.c",
                    "src/decoders.c"]
-        libraries = set()
+        libraries = set(["pthread"])
         extra_link_args = []
         extra_compile_args = []
 
@@ -765,7 +862,8 @@ class audiotools_decoders(Extension):
 class audiotools_encoders(Extension):
     def __init__(self, system_libraries):
         self.__library_manifest__ = []
-        defines = [("VERSION", VERSION), ("HAS_PYTHON", None)]
+        defines = ([("VERSION", VERSION), ("HAS_PYTHON", None)] +
+                   STATS_DEFINES)
         sources = ["src/pcmreader.c",
                    "src/framelist.c",
                    "src/pcm_conv.c",
@@ -794,8 +892,10 @@ class audiotools_encoders(Extension):
                    "src/encoders/alac.c",
                    "src/common/m4a_atoms.c",
                    "src/encoders/tta.c",
+                   "src/common/stats.c",
+                   "src/common/cpu.c",
                    "src/encoders.c"]
-        libraries = set()
+        libraries = set(["pthread"])
         extra_link_args = []
         extra_compile_args = []
 
@@ -0,0 +1,656 @@
+/********************************************************
+ Bitstream Library, a module for reading bits of data
+
+ Copyright (C) 2007-2014  Brian Langenberger
+
+ The Bitstream Library is free software; you can redistribute it and/or modify
+ it under the terms of either:
+
+   * the GNU Lesser General Public License as published by the Free
+     Software Foundation; either version 3 of the License, or (at your
+     option) any later version.
+
+ or
+
+   * the GNU General Public License as published by the Free Software
+     Foundation; either version 2 of the License, or (at your option) any
+     later version.
+
+ or both in parallel, as here.
+
+ The Bitstream Library is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ for more details.
+
+ You should have received copies of the GNU General Public License and the
+ GNU Lesser General Public License along with the GNU MP Library.  If not,
+ see https://www.gnu.org/licenses/.
+ *******************************************************/
+
+/*measures the time per operation of the BitstreamReader
+  and BitstreamWriter primitives for every combination of
+  backend, endianness and with or without a callback attached*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include "bitstream.h"
+#include "huffman.h"
+
+#define HELP_FORMAT "  %-20s %s\n"
+
+/*the Huffman codes read and written by the *_huffman_code benchmarks*/
+#define HUFFMAN_CODES 5
+
+/*the amount of bytes handed to external streams at a time*/
+#define EXTERNAL_BUFFER_SIZE 4096
+
+/*stores each result so the compiler can't discard the reads*/
+static volatile unsigned sink;
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+static void
+count_byte(uint8_t byte, unsigned *total)
+{
+    *total += byte;
+}
+
+/*a simple linear congruential generator
+  so every run benchmarks the same data*/
+static unsigned
+next_random(unsigned *state)
+{
+    *state = (*state * 1103515245) + 12345;
+    return (*state >> 16) & 0x7FFF;
+}
+
+/****************
+ reader backends
+****************/
+
+struct memory_input {
+    const uint8_t *data;
+    unsigned size;
+    unsigned position;
+};
+
+static unsigned
+memory_read(struct memory_input *input, uint8_t *buffer, unsigned size)
+{
+    const unsigned to_read = (input->size - input->position) < size ?
+        (input->size - input->position) : size;
+    memcpy(buffer, input->data + input->position, to_read);
+    input->position += to_read;
+    return to_read;
+}
+
+static int
+memory_close(struct memory_input *input)
+{
+    return 0;
+}
+
+static void
+memory_free(struct memory_input *input)
+{
+    free(input);
+}
+
+static BitstreamReader*
+open_file_reader(const uint8_t *data, unsigned size, bs_endianness endianness)
+{
+    FILE *file = tmpfile();
+    if (file == NULL) {
+        return NULL;
+    }
+    fwrite(data, 1, size, file);
+    rewind(file);
+    return br_open(file, endianness);
+}
+
+static BitstreamReader*
+open_buffer_reader(const uint8_t *data,
+                   unsigned size,
+                   bs_endianness endianness)
+{
+    return br_open_buffer(data, size, endianness);
+}
+
+static BitstreamReader*
+open_queue_reader(const uint8_t *data,
+                  unsigned size,
+                  bs_endianness endianness)
+{
+    BitstreamQueue *queue = br_open_queue(endianness);
+    queue->push(queue, size, data);
+    return (BitstreamReader*)queue;
+}
+
+static BitstreamReader*
+open_external_reader(const uint8_t *data,
+                     unsigned size,
+                     bs_endianness endianness)
+{
+    struct memory_input *input = malloc(sizeof(struct memory_input));
+    input->data = data;
+    input->size = size;
+    input->position = 0;
+    return br_open_external(input,
+                            endianness,
+                            EXTERNAL_BUFFER_SIZE,
+                            (ext_read_f)memory_read,
+                            NULL,
+                            NULL,
+                            NULL,
+                            NULL,
+                            (ext_close_f)memory_close,
+                            (ext_free_f)memory_free);
+}
+
+static const struct {
+    const char *name;
+    BitstreamReader* (*open)(const uint8_t *data,
+                             unsigned size,
+                             bs_endianness endianness);
+} READERS[] = {
+    {"file", open_file_reader},
+    {"buffer", open_buffer_reader},
+    {"queue", open_queue_reader},
+    {"external", open_external_reader}
+};
+
+/****************
+ reader primitives
+****************/
+
+static void
+bench_read_4(BitstreamReader *reader, br_huffman_table_t table[], unsigned ops)
+{
+    unsigned total = 0;
+    for (; ops; ops--) {
+        total += reader->read(reader, 4);
+    }
+    sink = total;
+}
+
+static void
+bench_read_16(BitstreamReader *reader, br_huffman_table_t table[], unsigned ops)
+{
+    unsigned total = 0;
+    for (; ops; ops--) {
+        total += reader->read(reader, 16);
+    }
+    sink = total;
+}
+
+static void
+bench_read_unary(BitstreamReader *reader,
+                 br_huffman_table_t table[],
+                 unsigned ops)
+{
+    unsigned total = 0;
+    for (; ops; ops--) {
+        total += reader->read_unary(reader, 1);
+    }
+    sink = total;
+}
+
+static void
+bench_read_huffman_code(BitstreamReader *reader,
+                        br_huffman_table_t table[],
+                        unsigned ops)
+{
+    unsigned total = 0;
+    for (; ops; ops--) {
+        total += reader->read_huffman_code(reader, table);
+    }
+    sink = total;
+}
+
+static const struct {
+    const char *name;
+    void (*run)(BitstreamReader *reader,
+                br_huffman_table_t table[],
+                unsigned ops);
+} READ_PRIMITIVES[] = {
+    {"read(4)", bench_read_4},
+    {"read(16)", bench_read_16},
+    {"read_unary", bench_read_unary},
+    {"read_huffman_code", bench_read_huffman_code}
+};
+
+/****************
+ writer backends
+****************/
+
+static int
+discard_write(void *user_data, const uint8_t *buffer, unsigned size)
+{
+    if (size) {
+        sink = buffer[size - 1];
+    }
+    return 0;
+}
+
+static int
+discard_flush(void *user_data)
+{
+    return 0;
+}
+
+static int
+discard_close(void *user_data)
+{
+    return 0;
+}
+
+static void
+discard_free(void *user_data)
+{
+    return;
+}
+
+static BitstreamWriter*
+open_file_writer(bs_endianness endianness)
+{
+    FILE *file = fopen("/dev/null", "wb");
+    return file ? bw_open(file, endianness) : NULL;
+}
+
+static void
+close_writer(BitstreamWriter *writer)
+{
+    writer->close(writer);
+}
+
+static BitstreamWriter*
+open_external_writer(bs_endianness endianness)
+{
+    return bw_open_external(NULL,
+                            endianness,
+                            EXTERNAL_BUFFER_SIZE,
+                            discard_write,
+                            NULL,
+                            NULL,
+                            NULL,
+                            NULL,
+                            discard_flush,
+                            discard_close,
+                            discard_free);
+}
+
+static BitstreamWriter*
+open_recorder(bs_endianness endianness)
+{
+    return (BitstreamWriter*)bw_open_recorder(endianness);
+}
+
+static BitstreamWriter*
+open_bytes_recorder(bs_endianness endianness)
+{
+    return (BitstreamWriter*)bw_open_bytes_recorder(endianness);
+}
+
+static void
+close_recorder(BitstreamWriter *writer)
+{
+    BitstreamRecorder *recorder = (BitstreamRecorder*)writer;
+    recorder->close(recorder);
+}
+
+static BitstreamWriter*
+open_accumulator(bs_endianness endianness)
+{
+    return (BitstreamWriter*)bw_open_accumulator(endianness);
+}
+
+static void
+close_accumulator(BitstreamWriter *writer)
+{
+    BitstreamAccumulator *accumulator = (BitstreamAccumulator*)writer;
+    accumulator->close(accumulator);
+}
+
+static const struct {
+    const char *name;
+    BitstreamWriter* (*open)(bs_endianness endianness);
+    void (*close)(BitstreamWriter *writer);
+} WRITERS[] = {
+    {"file", open_file_writer, close_writer},
+    {"external", open_external_writer, close_writer},
+    {"recorder", open_recorder, close_recorder},
+    {"bytes_recorder", open_bytes_recorder, close_recorder},
+    {"accumulator", open_accumulator, close_accumulator}
+};
+
+/****************
+ writer primitives
+****************/
+
+static void
+bench_write_4(BitstreamWriter *writer,
+              bw_huffman_table_t table[],
+              const unsigned values[],
+              unsigned ops)
+{
+    for (; ops; ops--) {
+        writer->write(writer, 4, *values++ & 0xF);
+    }
+}
+
+static void
+bench_write_16(BitstreamWriter *writer,
+               bw_huffman_table_t table[],
+               const unsigned values[],
+               unsigned ops)
+{
+    for (; ops; ops--) {
+        writer->write(writer, 16, *values++ & 0xFFFF);
+    }
+}
+
+static void
+bench_write_unary(BitstreamWriter *writer,
+                  bw_huffman_table_t table[],
+                  const unsigned values[],
+                  unsigned ops)
+{
+    for (; ops; ops--) {
+        writer->write_unary(writer, 1, *values++ & 0x3);
+    }
+}
+
+static void
+bench_write_huffman_code(BitstreamWriter *writer,
+                         bw_huffman_table_t table[],
+                         const unsigned values[],
+                         unsigned ops)
+{
+    for (; ops; ops--) {
+        writer->write_huffman_code(writer, table,
+                                   *values++ % HUFFMAN_CODES);
+    }
+}
+
+static const struct {
+    const char *name;
+    void (*run)(BitstreamWriter *writer,
+                bw_huffman_table_t table[],
+                const unsigned values[],
+                unsigned ops);
+} WRITE_PRIMITIVES[] = {
+    {"write(4)", bench_write_4},
+    {"write(16)", bench_write_16},
+    {"write_unary", bench_write_unary},
+    {"write_huffman_code", bench_write_huffman_code}
+};
+
+#define LENGTH(a) (sizeof(a) / sizeof(a[0]))
+
+/****************
+ output
+****************/
+
+static void
+display_result(int json,
+               int *first,
+               const char *stream,
+               const char *backend,
+               bs_endianness endianness,
+               int callback,
+               const char *primitive,
+               double ns_per_op)
+{
+    const char *endian = endianness == BS_BIG_ENDIAN ? "big" : "little";
+
+    if (json) {
+        printf("%s\n  {\"stream\": \"%s\", \"backend\": \"%s\", "
+               "\"endianness\": \"%s\", \"callback\": %s, "
+               "\"primitive\": \"%s\", \"ns_per_op\": %.3f}",
+               *first ? "" : ",",
+               stream,
+               backend,
+               endian,
+               callback ? "true" : "false",
+               primitive,
+               ns_per_op);
+    } else {
+        printf("%-6s %-14s %-6s %-8s %-18s %8.2f\n",
+               stream,
+               backend,
+               endian,
+               callback ? "yes" : "no",
+               primitive,
+               ns_per_op);
+    }
+    *first = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static int json = 0;
+    unsigned ops = 1 << 20;
+    unsigned repeat = 5;
+
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {"ops", required_argument, 0, 'n'},
+        {"repeat", required_argument, 0, 'r'},
+        {"json", no_argument, &json, 1},
+        {0, 0, 0, 0}
+    };
+
+    const bs_endianness endiannesses[] = {BS_BIG_ENDIAN, BS_LITTLE_ENDIAN};
+    struct huffman_frequency frequencies[HUFFMAN_CODES];
+    int option_index = 0;
+    int c;
+    uint8_t *data;
+    unsigned data_size;
+    unsigned *values;
+    unsigned random_state = 1;
+    unsigned i;
+    unsigned e;
+    int first = 1;
+
+    do {
+        c = getopt_long(argc, argv, "hn:r:", long_options, &option_index);
+        switch (c) {
+        case 'h':
+            printf("Options:\n");
+            printf(HELP_FORMAT, "-h, --help",
+                   "show this help message and exit");
+            printf(HELP_FORMAT, "-n, --ops=#",
+                   "operations per measurement");
+            printf(HELP_FORMAT, "-r, --repeat=#",
+                   "measurements per result, of which the best is kept");
+            printf(HELP_FORMAT, "--json",
+                   "display results as a JSON list");
+            return 0;
+        case 'n':
+            if ((ops = (unsigned)strtoul(optarg, NULL, 10)) == 0) {
+                fprintf(stderr, "*** Error: invalid operation count\n");
+                return 1;
+            }
+            break;
+        case 'r':
+            if ((repeat = (unsigned)strtoul(optarg, NULL, 10)) == 0) {
+                fprintf(stderr, "*** Error: invalid repeat count\n");
+                return 1;
+            }
+            break;
+        case '?':
+            return 1;
+        case 0:
+        case -1:
+        default:
+            break;
+        }
+    } while (c != -1);
+
+    /*no read primitive consumes more than 16 bits
+      and setting bits 0 and 4 of every byte keeps
+      runs of 0 bits short enough for read_unary
+      in either endianness*/
+    data_size = ops * 2;
+    data = malloc(data_size);
+    for (i = 0; i < data_size; i++) {
+        data[i] = (uint8_t)(next_random(&random_state) | 0x11);
+    }
+
+    values = malloc(ops * sizeof(unsigned));
+    for (i = 0; i < ops; i++) {
+        values[i] = next_random(&random_state);
+    }
+
+    /*a complete Huffman tree, so any input decodes*/
+    frequencies[0] = bw_str_to_frequency("11", 0);
+    frequencies[1] = bw_str_to_frequency("10", 1);
+    frequencies[2] = bw_str_to_frequency("01", 2);
+    frequencies[3] = bw_str_to_frequency("001", 3);
+    frequencies[4] = bw_str_to_frequency("000", 4);
+
+    if (json) {
+        printf("[");
+    } else {
+        printf("%-6s %-14s %-6s %-8s %-18s %8s\n",
+               "stream", "backend", "endian", "callback", "primitive",
+               "ns/op");
+    }
+
+    for (e = 0; e < LENGTH(endiannesses); e++) {
+        br_huffman_table_t *read_table;
+        bw_huffman_table_t *write_table;
+        unsigned b;
+
+        compile_br_huffman_table(&read_table,
+                                 frequencies,
+                                 HUFFMAN_CODES,
+                                 endiannesses[e]);
+        compile_bw_huffman_table(&write_table,
+                                 frequencies,
+                                 HUFFMAN_CODES,
+                                 endiannesses[e]);
+
+        for (b = 0; b < LENGTH(READERS); b++) {
+            unsigned p;
+            for (p = 0; p < LENGTH(READ_PRIMITIVES); p++) {
+                int callback;
+                for (callback = 0; callback < 2; callback++) {
+                    uint64_t best = UINT64_MAX;
+                    unsigned r;
+                    for (r = 0; r < repeat; r++) {
+                        BitstreamReader *reader =
+                            READERS[b].open(data, data_size, endiannesses[e]);
+                        unsigned total = 0;
+                        uint64_t start;
+                        uint64_t elapsed;
+
+                        if (reader == NULL) {
+                            fprintf(stderr, "*** Error: unable to open %s\n",
+                                    READERS[b].name);
+                            return 1;
+                        }
+                        if (callback) {
+                            reader->add_callback(reader,
+                                                 (bs_callback_f)count_byte,
+                                                 &total);
+                        }
+
+                        start = now_ns();
+                        READ_PRIMITIVES[p].run(reader, read_table, ops);
+                        elapsed = now_ns() - start;
+
+                        reader->close(reader);
+                        if (elapsed < best) {
+                            best = elapsed;
+                        }
+                    }
+                    display_result(json,
+                                   &first,
+                                   "reader",
+                                   READERS[b].name,
+                                   endiannesses[e],
+                                   callback,
+                                   READ_PRIMITIVES[p].name,
+                                   (double)best / ops);
+                }
+            }
+        }
+
+        for (b = 0; b < LENGTH(WRITERS); b++) {
+            unsigned p;
+            for (p = 0; p < LENGTH(WRITE_PRIMITIVES); p++) {
+                int callback;
+                for (callback = 0; callback < 2; callback++) {
+                    uint64_t best = UINT64_MAX;
+                    unsigned r;
+                    for (r = 0; r < repeat; r++) {
+                        BitstreamWriter *writer =
+                            WRITERS[b].open(endiannesses[e]);
+                        unsigned total = 0;
+                        uint64_t start;
+                        uint64_t elapsed;
+
+                        if (writer == NULL) {
+                            fprintf(stderr, "*** Error: unable to open %s\n",
+                                    WRITERS[b].name);
+                            return 1;
+                        }
+                        if (callback) {
+                            writer->add_callback(writer,
+                                                 (bs_callback_f)count_byte,
+                                                 &total);
+                        }
+
+                        /*flushing is included so file and external
+                          writers account for their output*/
+                        start = now_ns();
+                        WRITE_PRIMITIVES[p].run(writer,
+                                                write_table,
+                                                values,
+                                                ops);
+                        writer->byte_align(writer);
+                        writer->flush(writer);
+                        elapsed = now_ns() - start;
+
+                        WRITERS[b].close(writer);
+                        if (elapsed < best) {
+                            best = elapsed;
+                        }
+                    }
+                    display_result(json,
+                                   &first,
+                                   "writer",
+                                   WRITERS[b].name,
+                                   endiannesses[e],
+                                   callback,
+                                   WRITE_PRIMITIVES[p].name,
+                                   (double)best / ops);
+                }
+            }
+        }
+
+        free(read_table);
+        free(write_table);
+    }
+
+    if (json) {
+        printf("\n]\n");
+    }
+
+    free(data);
+    free(values);
+
+    return 0;
+}
@@ -4768,6 +4768,11 @@ bw_free_r(BitstreamRecorder *self)
     while (self->callbacks) {
         self->pop_callback((BitstreamWriter*)self, NULL);
     }
+    while (self->callbacks_used) {
+        struct bs_callback* next = self->callbacks_used->next;
+        free(self->callbacks_used);
+        self->callbacks_used = next;
+    }
 
     /*deallocate exceptions*/
     if (self->exceptions) {
@@ -4848,6 +4853,11 @@ bw_free_a(BitstreamAccumulator *self)
     while (self->callbacks != NULL) {
         self->pop_callback((BitstreamWriter*)self, NULL);
     }
+    while (self->callbacks_used) {
+        struct bs_callback* next = self->callbacks_used->next;
+        free(self->callbacks_used);
+        self->callbacks_used = next;
+    }
 
     /*deallocate exceptions*/
     if (self->exceptions) {
@@ -4941,6 +4951,19 @@ recorder_swap(BitstreamRecorder **a, BitstreamRecorder **b)
     *b = c;
 }
 
+int
+bw_seekable(BitstreamWriter *bs)
+{
+    if (!setjmp(*bw_try(bs))) {
+        bs->seek(bs, 0, BS_SEEK_CUR);
+        bw_etry(bs);
+        return 1;
+    } else {
+        bw_etry(bs);
+        return 0;
+    }
+}
+
 const char*
 bs_parse_format(const char *format,
                 unsigned *times, unsigned *size, bs_instruction_t *inst)
@@ -5400,6 +5423,8 @@ bs_fseek_python(void* stream, long position, int whence)
         Py_DECREF(result);
         return 0;
     } else {
+        /*some error occurred calling seek()*/
+        PyErr_Clear();
         return 1;
     }
 }
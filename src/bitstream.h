@@ -1109,6 +1109,14 @@ __bw_etry(BitstreamWriter *bs, const char *file, int lineno);
 void
 recorder_swap(BitstreamRecorder **a, BitstreamRecorder **b);
 
+/*returns 1 if the writer's output can be seeked
+  such that getpos/setpos may be used to go back and rewrite data,
+  or 0 if not, such as for a pipe
+
+  the writer must be byte-aligned*/
+int
+bw_seekable(BitstreamWriter *bs);
+
 
 /*******************************************************************
  *                          format handlers                        *
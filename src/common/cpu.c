@@ -0,0 +1,151 @@
+#include "cpu.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(CPU_X86)
+#include <cpuid.h>
+#elif defined(__linux__) && (defined(__aarch64__) || defined(__arm__))
+#include <sys/auxv.h>
+#endif
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*-1 until the features have been detected*/
+static volatile int detected_features = -1;
+
+static unsigned
+detect_features(void);
+
+unsigned
+cpu_features(void)
+{
+    if (detected_features < 0) {
+        const char *scalar = getenv("AUDIOTOOLS_SCALAR");
+        if (scalar && strcmp(scalar, "") && strcmp(scalar, "0")) {
+            detected_features = 0;
+        } else {
+            detected_features = (int)detect_features();
+        }
+    }
+    return (unsigned)detected_features;
+}
+
+const char*
+cpu_feature_name(cpu_feature_t feature)
+{
+    switch (feature) {
+    case CPU_SSE2:
+        return "sse2";
+    case CPU_SSSE3:
+        return "ssse3";
+    case CPU_SSE4_1:
+        return "sse4.1";
+    case CPU_AVX:
+        return "avx";
+    case CPU_AVX2:
+        return "avx2";
+    case CPU_NEON:
+        return "neon";
+    default:
+        return "unknown";
+    }
+}
+
+#if defined(CPU_X86)
+
+/*returns the low 32 bits of the given extended control register*/
+static unsigned
+xgetbv(unsigned index)
+{
+    unsigned eax;
+    unsigned edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return eax;
+}
+
+static unsigned
+detect_features(void)
+{
+    unsigned eax, ebx, ecx, edx;
+    unsigned features = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    if (edx & bit_SSE2) {
+        features |= CPU_SSE2;
+    }
+    if (ecx & bit_SSSE3) {
+        features |= CPU_SSSE3;
+    }
+    if (ecx & bit_SSE4_1) {
+        features |= CPU_SSE4_1;
+    }
+
+    /*the 256-bit registers are only usable
+      if the operating system saves them on context switches*/
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX) && ((xgetbv(0) & 6) == 6)) {
+        features |= CPU_AVX;
+
+        if (__get_cpuid_max(0, NULL) >= 7) {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            if (ebx & bit_AVX2) {
+                features |= CPU_AVX2;
+            }
+        }
+    }
+
+    return features;
+}
+
+#elif defined(CPU_ARM_NEON)
+
+#if defined(__linux__) && defined(__aarch64__)
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD (1 << 1)
+#endif
+#define HWCAP_SIMD HWCAP_ASIMD
+#elif defined(__linux__) && defined(__arm__)
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#define HWCAP_SIMD HWCAP_NEON
+#endif
+
+static unsigned
+detect_features(void)
+{
+#ifdef HWCAP_SIMD
+    return (getauxval(AT_HWCAP) & HWCAP_SIMD) ? CPU_NEON : 0;
+#else
+    /*the compiler's been told NEON is present
+      and there's no portable way to ask otherwise*/
+    return CPU_NEON;
+#endif
+}
+
+#else
+
+static unsigned
+detect_features(void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef CPU_H
+#define CPU_H
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*runtime CPU feature detection for picking SIMD kernels
+
+  every kernel is compiled into the same binary,
+  the x86 ones with per-function target attributes
+  so the module itself needs no special -m flags
+
+  each group of kernels keeps a table of function pointers
+  which starts out pointing at the portable scalar versions
+  and is upgraded by the group's init function
+  according to what cpu_features() reports
+
+  if the AUDIOTOOLS_SCALAR environment variable is set
+  to anything other than "" or "0",
+  cpu_features() reports no features at all
+  and every table keeps its scalar kernels*/
+
+typedef enum {
+    CPU_SSE2 =   1 << 0,
+    CPU_SSSE3 =  1 << 1,
+    CPU_SSE4_1 = 1 << 2,
+    CPU_AVX =    1 << 3,
+    CPU_AVX2 =   1 << 4,
+    CPU_NEON =   1 << 5
+} cpu_feature_t;
+
+#define CPU_FEATURES 6
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_X86
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+/*NEON kernels are only built when the compiler targets NEON already,
+  which is always the case on AArch64*/
+#define CPU_ARM_NEON
+#endif
+
+/*returns a bitmask of the cpu_feature_t values
+  the running processor and operating system support,
+  detected once and cached afterward*/
+unsigned
+cpu_features(void);
+
+/*returns a feature's name, such as "sse4.1"*/
+const char*
+cpu_feature_name(cpu_feature_t feature);
+
+#endif
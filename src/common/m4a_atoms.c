@@ -594,7 +594,7 @@ qt_stsc_add_chunk_size(struct qt_atom *atom,
                        unsigned description_index)
 {
     unsigned count;
-    assert(atom->type = QT_STSC);
+    assert(atom->type == QT_STSC);
     count = atom->_.stsc.entries_count;
     atom->_.stsc.entries = realloc(atom->_.stsc.entries,
                                    (count + 1) * sizeof(struct stsc_entry));
@@ -616,6 +616,7 @@ qt_stsz_new(unsigned version,
     atom->_.stsz.flags = flags;
     atom->_.stsz.frame_byte_size = frame_byte_size;
     atom->_.stsz.frames_count = 0;
+    atom->_.stsz.frames_allocated = 0;
     atom->_.stsz.frame_size = NULL;
     atom->display = display_stsz;
     atom->build = build_stsz;
@@ -630,11 +631,18 @@ qt_stsz_add_size(struct qt_atom *atom, unsigned byte_size)
 {
     unsigned count;
 
-    assert(atom->type = QT_STSZ);
+    assert(atom->type == QT_STSZ);
 
     count = atom->_.stsz.frames_count;
-    atom->_.stsz.frame_size = realloc(atom->_.stsz.frame_size,
-                                      (count + 1) * sizeof(unsigned));
+    /*there's one size per ALAC frame,
+      so grow the table geometrically rather than one entry at a time*/
+    if (count == atom->_.stsz.frames_allocated) {
+        atom->_.stsz.frames_allocated =
+            count ? (count * 2) : 256;
+        atom->_.stsz.frame_size =
+            realloc(atom->_.stsz.frame_size,
+                    atom->_.stsz.frames_allocated * sizeof(unsigned));
+    }
     atom->_.stsz.frame_size[count] = byte_size;
     atom->_.stsz.frames_count += 1;
 }
@@ -649,6 +657,7 @@ qt_stco_new(unsigned version,
     atom->_.stco.version = version;
     atom->_.stco.flags = flags;
     atom->_.stco.offsets_count = 0;
+    atom->_.stco.offsets_allocated = 0;
     atom->_.stco.chunk_offset = NULL;
     atom->display = display_stco;
     atom->build = build_stco;
@@ -662,10 +671,15 @@ void
 qt_stco_add_offset(struct qt_atom *atom, unsigned offset)
 {
     unsigned count;
-    assert(atom->type = QT_STCO);
+    assert(atom->type == QT_STCO);
     count = atom->_.stco.offsets_count;
-    atom->_.stco.chunk_offset = realloc(atom->_.stco.chunk_offset,
-                                        (count + 1) * sizeof(unsigned));
+    if (count == atom->_.stco.offsets_allocated) {
+        atom->_.stco.offsets_allocated =
+            count ? (count * 2) : 64;
+        atom->_.stco.chunk_offset =
+            realloc(atom->_.stco.chunk_offset,
+                    atom->_.stco.offsets_allocated * sizeof(unsigned));
+    }
     atom->_.stco.chunk_offset[count] = offset;
     atom->_.stco.offsets_count += 1;
 }
@@ -1645,7 +1659,7 @@ display_dref(const struct qt_atom *self,
 static struct qt_atom*
 parse_dref(BitstreamReader *stream,
            unsigned atom_size,
-           const char *atom_name)
+           const char atom_name[4])
 {
     unsigned version = stream->read(stream, 8);
     unsigned flags = stream->read(stream, 24);
@@ -1752,7 +1766,7 @@ display_stsd(const struct qt_atom *self,
 static struct qt_atom*
 parse_stsd(BitstreamReader *stream,
            unsigned atom_size,
-           const char *atom_name)
+           const char atom_name[4])
 {
     unsigned version = stream->read(stream, 8);
     unsigned flags = stream->read(stream, 24);
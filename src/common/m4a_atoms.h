@@ -188,6 +188,7 @@ struct qt_atom {
             unsigned flags;
             unsigned frame_byte_size;
             unsigned frames_count;
+            unsigned frames_allocated;
             unsigned *frame_size;
         } stsz;
 
@@ -195,6 +196,7 @@ struct qt_atom {
             unsigned version;
             unsigned flags;
             unsigned offsets_count;
+            unsigned offsets_allocated;
             unsigned *chunk_offset;
         } stco;
 
@@ -390,7 +392,7 @@ qt_stsc_add_chunk_size(struct qt_atom *atom,
 static inline struct stsc_entry*
 qt_stsc_latest_entry(struct qt_atom *atom)
 {
-    assert(atom->type = QT_STSC);
+    assert(atom->type == QT_STSC);
     if (atom->_.stsc.entries_count) {
         return &(atom->_.stsc.entries[atom->_.stsc.entries_count - 1]);
     } else {
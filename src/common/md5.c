@@ -2,6 +2,12 @@
 #include <string.h>     /* for memcpy() */
 
 #include "md5.h"
+#include "cpu.h"
+#if defined(CPU_X86)
+#include <immintrin.h>
+#elif defined(CPU_ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 /*
  * This code implements the MD5 message-digest algorithm.
@@ -29,6 +35,10 @@
  * Still in the public domain, with no warranty
  */
 
+#ifndef MIN
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#endif
+
 /* The four core functions - F1 is optimized somewhat */
 
 /* #define F1(x, y, z) (x & y | ~x & z) */
@@ -212,6 +222,663 @@ audiotools__MD5Update(audiotools__MD5Context *ctx,
     memcpy(ctx->in, buf, len);
 }
 
+/*adds "len" to the context's 64-bit byte count*/
+static void
+add_byte_count(audiotools__MD5Context *ctx, uint64_t len)
+{
+    const uint32_t t = ctx->bytes[0];
+
+    if ((ctx->bytes[0] = t + (uint32_t)len) < t)
+        ctx->bytes[1]++;    /* Carry from low to high */
+    ctx->bytes[1] += (uint32_t)(len >> 32);
+}
+
+/*reads a little-endian 32-bit word regardless of host byte order*/
+static uint32_t
+load_le32(const unsigned char *p)
+{
+    return ((uint32_t)p[0] |
+            ((uint32_t)p[1] << 8) |
+            ((uint32_t)p[2] << 16) |
+            ((uint32_t)p[3] << 24));
+}
+
+/*the most independent streams any transform kernel handles at once*/
+#define MD5_MAX_LANES 8
+
+/*transforms one 64-byte block from each of "lanes" streams,
+  where each stream has its own "states" entry and "blocks" entry*/
+typedef void (*transform_lanes_f)(uint32_t *states[],
+                                  const unsigned char *blocks[]);
+
+static void
+transform_lanes_scalar(uint32_t *states[], const unsigned char *blocks[])
+{
+    uint32_t in[16];
+    unsigned i;
+
+    for (i = 0; i < 16; i++) {
+        in[i] = load_le32(blocks[0] + (i * 4));
+    }
+    audiotools__MD5Transform(states[0], in);
+}
+
+/*the 64 MD5 steps on vectors of independent lanes,
+  given V_ADD, V_AND, V_OR, V_XOR, V_SET1 and V_ROTL operations
+  on "a", "b", "c", "d" state vectors and an "in" array of 16 word vectors
+  whose lane N holds word N of that stream's block*/
+#define V_F1(x, y, z) V_XOR(z, V_AND(x, V_XOR(y, z)))
+#define V_F2(x, y, z) V_F1(z, x, y)
+#define V_F3(x, y, z) V_XOR(x, V_XOR(y, z))
+#define V_F4(x, y, z) V_XOR(y, V_OR(x, V_XOR(z, V_SET1(0xffffffff))))
+
+#define V_STEP(f, w, x, y, z, word, k, s)                              \
+    (w = V_ADD(w, V_ADD(f(x, y, z), V_ADD(in[word], V_SET1(k)))),      \
+     w = V_ADD(V_ROTL(w, s), x))
+
+#define V_MD5_ROUNDS                                          \
+    V_STEP(V_F1, a, b, c, d, 0, 0xd76aa478, 7);               \
+    V_STEP(V_F1, d, a, b, c, 1, 0xe8c7b756, 12);              \
+    V_STEP(V_F1, c, d, a, b, 2, 0x242070db, 17);              \
+    V_STEP(V_F1, b, c, d, a, 3, 0xc1bdceee, 22);              \
+    V_STEP(V_F1, a, b, c, d, 4, 0xf57c0faf, 7);               \
+    V_STEP(V_F1, d, a, b, c, 5, 0x4787c62a, 12);              \
+    V_STEP(V_F1, c, d, a, b, 6, 0xa8304613, 17);              \
+    V_STEP(V_F1, b, c, d, a, 7, 0xfd469501, 22);              \
+    V_STEP(V_F1, a, b, c, d, 8, 0x698098d8, 7);               \
+    V_STEP(V_F1, d, a, b, c, 9, 0x8b44f7af, 12);              \
+    V_STEP(V_F1, c, d, a, b, 10, 0xffff5bb1, 17);             \
+    V_STEP(V_F1, b, c, d, a, 11, 0x895cd7be, 22);             \
+    V_STEP(V_F1, a, b, c, d, 12, 0x6b901122, 7);              \
+    V_STEP(V_F1, d, a, b, c, 13, 0xfd987193, 12);             \
+    V_STEP(V_F1, c, d, a, b, 14, 0xa679438e, 17);             \
+    V_STEP(V_F1, b, c, d, a, 15, 0x49b40821, 22);             \
+                                                              \
+    V_STEP(V_F2, a, b, c, d, 1, 0xf61e2562, 5);               \
+    V_STEP(V_F2, d, a, b, c, 6, 0xc040b340, 9);               \
+    V_STEP(V_F2, c, d, a, b, 11, 0x265e5a51, 14);             \
+    V_STEP(V_F2, b, c, d, a, 0, 0xe9b6c7aa, 20);              \
+    V_STEP(V_F2, a, b, c, d, 5, 0xd62f105d, 5);               \
+    V_STEP(V_F2, d, a, b, c, 10, 0x02441453, 9);              \
+    V_STEP(V_F2, c, d, a, b, 15, 0xd8a1e681, 14);             \
+    V_STEP(V_F2, b, c, d, a, 4, 0xe7d3fbc8, 20);              \
+    V_STEP(V_F2, a, b, c, d, 9, 0x21e1cde6, 5);               \
+    V_STEP(V_F2, d, a, b, c, 14, 0xc33707d6, 9);              \
+    V_STEP(V_F2, c, d, a, b, 3, 0xf4d50d87, 14);              \
+    V_STEP(V_F2, b, c, d, a, 8, 0x455a14ed, 20);              \
+    V_STEP(V_F2, a, b, c, d, 13, 0xa9e3e905, 5);              \
+    V_STEP(V_F2, d, a, b, c, 2, 0xfcefa3f8, 9);               \
+    V_STEP(V_F2, c, d, a, b, 7, 0x676f02d9, 14);              \
+    V_STEP(V_F2, b, c, d, a, 12, 0x8d2a4c8a, 20);             \
+                                                              \
+    V_STEP(V_F3, a, b, c, d, 5, 0xfffa3942, 4);               \
+    V_STEP(V_F3, d, a, b, c, 8, 0x8771f681, 11);              \
+    V_STEP(V_F3, c, d, a, b, 11, 0x6d9d6122, 16);             \
+    V_STEP(V_F3, b, c, d, a, 14, 0xfde5380c, 23);             \
+    V_STEP(V_F3, a, b, c, d, 1, 0xa4beea44, 4);               \
+    V_STEP(V_F3, d, a, b, c, 4, 0x4bdecfa9, 11);              \
+    V_STEP(V_F3, c, d, a, b, 7, 0xf6bb4b60, 16);              \
+    V_STEP(V_F3, b, c, d, a, 10, 0xbebfbc70, 23);             \
+    V_STEP(V_F3, a, b, c, d, 13, 0x289b7ec6, 4);              \
+    V_STEP(V_F3, d, a, b, c, 0, 0xeaa127fa, 11);              \
+    V_STEP(V_F3, c, d, a, b, 3, 0xd4ef3085, 16);              \
+    V_STEP(V_F3, b, c, d, a, 6, 0x04881d05, 23);              \
+    V_STEP(V_F3, a, b, c, d, 9, 0xd9d4d039, 4);               \
+    V_STEP(V_F3, d, a, b, c, 12, 0xe6db99e5, 11);             \
+    V_STEP(V_F3, c, d, a, b, 15, 0x1fa27cf8, 16);             \
+    V_STEP(V_F3, b, c, d, a, 2, 0xc4ac5665, 23);              \
+                                                              \
+    V_STEP(V_F4, a, b, c, d, 0, 0xf4292244, 6);               \
+    V_STEP(V_F4, d, a, b, c, 7, 0x432aff97, 10);              \
+    V_STEP(V_F4, c, d, a, b, 14, 0xab9423a7, 15);             \
+    V_STEP(V_F4, b, c, d, a, 5, 0xfc93a039, 21);              \
+    V_STEP(V_F4, a, b, c, d, 12, 0x655b59c3, 6);              \
+    V_STEP(V_F4, d, a, b, c, 3, 0x8f0ccc92, 10);              \
+    V_STEP(V_F4, c, d, a, b, 10, 0xffeff47d, 15);             \
+    V_STEP(V_F4, b, c, d, a, 1, 0x85845dd1, 21);              \
+    V_STEP(V_F4, a, b, c, d, 8, 0x6fa87e4f, 6);               \
+    V_STEP(V_F4, d, a, b, c, 15, 0xfe2ce6e0, 10);             \
+    V_STEP(V_F4, c, d, a, b, 6, 0xa3014314, 15);              \
+    V_STEP(V_F4, b, c, d, a, 13, 0x4e0811a1, 21);             \
+    V_STEP(V_F4, a, b, c, d, 4, 0xf7537e82, 6);               \
+    V_STEP(V_F4, d, a, b, c, 11, 0xbd3af235, 10);             \
+    V_STEP(V_F4, c, d, a, b, 2, 0x2ad7d2bb, 15);              \
+    V_STEP(V_F4, b, c, d, a, 9, 0xeb86d391, 21)
+
+#if defined(CPU_X86)
+#define V_ADD _mm_add_epi32
+#define V_AND _mm_and_si128
+#define V_OR _mm_or_si128
+#define V_XOR _mm_xor_si128
+#define V_SET1(k) _mm_set1_epi32((int)(k))
+#define V_ROTL(x, s) _mm_or_si128(_mm_slli_epi32(x, s), \
+                                  _mm_srli_epi32(x, 32 - (s)))
+
+CPU_TARGET("sse2") static void
+transform_lanes_sse2(uint32_t *states[], const unsigned char *blocks[])
+{
+    __m128i in[16];
+    __m128i a;
+    __m128i b;
+    __m128i c;
+    __m128i d;
+    uint32_t out[4][4];
+    unsigned i;
+
+    for (i = 0; i < 16; i++) {
+        in[i] = _mm_setr_epi32((int)load_le32(blocks[0] + (i * 4)),
+                               (int)load_le32(blocks[1] + (i * 4)),
+                               (int)load_le32(blocks[2] + (i * 4)),
+                               (int)load_le32(blocks[3] + (i * 4)));
+    }
+
+    a = _mm_setr_epi32((int)states[0][0], (int)states[1][0],
+                       (int)states[2][0], (int)states[3][0]);
+    b = _mm_setr_epi32((int)states[0][1], (int)states[1][1],
+                       (int)states[2][1], (int)states[3][1]);
+    c = _mm_setr_epi32((int)states[0][2], (int)states[1][2],
+                       (int)states[2][2], (int)states[3][2]);
+    d = _mm_setr_epi32((int)states[0][3], (int)states[1][3],
+                       (int)states[2][3], (int)states[3][3]);
+
+    V_MD5_ROUNDS;
+
+    _mm_storeu_si128((__m128i*)out[0], a);
+    _mm_storeu_si128((__m128i*)out[1], b);
+    _mm_storeu_si128((__m128i*)out[2], c);
+    _mm_storeu_si128((__m128i*)out[3], d);
+    for (i = 0; i < 4; i++) {
+        states[i][0] += out[0][i];
+        states[i][1] += out[1][i];
+        states[i][2] += out[2][i];
+        states[i][3] += out[3][i];
+    }
+}
+
+#undef V_ADD
+#undef V_AND
+#undef V_OR
+#undef V_XOR
+#undef V_SET1
+#undef V_ROTL
+
+#define V_ADD _mm256_add_epi32
+#define V_AND _mm256_and_si256
+#define V_OR _mm256_or_si256
+#define V_XOR _mm256_xor_si256
+#define V_SET1(k) _mm256_set1_epi32((int)(k))
+#define V_ROTL(x, s) _mm256_or_si256(_mm256_slli_epi32(x, s), \
+                                     _mm256_srli_epi32(x, 32 - (s)))
+
+/*transposes word "i" of all 8 lanes' states or blocks into one vector*/
+#define GATHER_8(get) _mm256_setr_epi32((int)get(0), (int)get(1), \
+                                        (int)get(2), (int)get(3), \
+                                        (int)get(4), (int)get(5), \
+                                        (int)get(6), (int)get(7))
+
+CPU_TARGET("avx2") static void
+transform_lanes_avx2(uint32_t *states[], const unsigned char *blocks[])
+{
+    __m256i in[16];
+    __m256i a;
+    __m256i b;
+    __m256i c;
+    __m256i d;
+    uint32_t out[4][8];
+    unsigned i;
+
+    for (i = 0; i < 16; i++) {
+#define BLOCK_WORD(lane) load_le32(blocks[lane] + (i * 4))
+        in[i] = GATHER_8(BLOCK_WORD);
+#undef BLOCK_WORD
+    }
+
+#define STATE_A(lane) states[lane][0]
+#define STATE_B(lane) states[lane][1]
+#define STATE_C(lane) states[lane][2]
+#define STATE_D(lane) states[lane][3]
+    a = GATHER_8(STATE_A);
+    b = GATHER_8(STATE_B);
+    c = GATHER_8(STATE_C);
+    d = GATHER_8(STATE_D);
+#undef STATE_A
+#undef STATE_B
+#undef STATE_C
+#undef STATE_D
+
+    V_MD5_ROUNDS;
+
+    _mm256_storeu_si256((__m256i*)out[0], a);
+    _mm256_storeu_si256((__m256i*)out[1], b);
+    _mm256_storeu_si256((__m256i*)out[2], c);
+    _mm256_storeu_si256((__m256i*)out[3], d);
+    for (i = 0; i < 8; i++) {
+        states[i][0] += out[0][i];
+        states[i][1] += out[1][i];
+        states[i][2] += out[2][i];
+        states[i][3] += out[3][i];
+    }
+}
+
+#undef GATHER_8
+#undef V_ADD
+#undef V_AND
+#undef V_OR
+#undef V_XOR
+#undef V_SET1
+#undef V_ROTL
+#elif defined(CPU_ARM_NEON)
+#define V_ADD vaddq_u32
+#define V_AND vandq_u32
+#define V_OR vorrq_u32
+#define V_XOR veorq_u32
+#define V_SET1(k) vdupq_n_u32(k)
+#define V_ROTL(x, s) vorrq_u32(vshlq_n_u32(x, s), vshrq_n_u32(x, 32 - (s)))
+
+static void
+transform_lanes_neon(uint32_t *states[], const unsigned char *blocks[])
+{
+    uint32x4_t in[16];
+    uint32x4_t a;
+    uint32x4_t b;
+    uint32x4_t c;
+    uint32x4_t d;
+    uint32_t lanes[4];
+    uint32_t out[4][4];
+    unsigned i;
+    unsigned j;
+
+    for (i = 0; i < 16; i++) {
+        for (j = 0; j < 4; j++) {
+            lanes[j] = load_le32(blocks[j] + (i * 4));
+        }
+        in[i] = vld1q_u32(lanes);
+    }
+
+    for (j = 0; j < 4; j++) {
+        out[0][j] = states[j][0];
+        out[1][j] = states[j][1];
+        out[2][j] = states[j][2];
+        out[3][j] = states[j][3];
+    }
+    a = vld1q_u32(out[0]);
+    b = vld1q_u32(out[1]);
+    c = vld1q_u32(out[2]);
+    d = vld1q_u32(out[3]);
+
+    V_MD5_ROUNDS;
+
+    vst1q_u32(out[0], a);
+    vst1q_u32(out[1], b);
+    vst1q_u32(out[2], c);
+    vst1q_u32(out[3], d);
+    for (j = 0; j < 4; j++) {
+        states[j][0] += out[0][j];
+        states[j][1] += out[1][j];
+        states[j][2] += out[2][j];
+        states[j][3] += out[3][j];
+    }
+}
+
+#undef V_ADD
+#undef V_AND
+#undef V_OR
+#undef V_XOR
+#undef V_SET1
+#undef V_ROTL
+#endif
+
+/*multi-stream transform kernel and how many lanes it takes,
+  set by audiotools__MD5InitDispatch()*/
+static transform_lanes_f transform_lanes = transform_lanes_scalar;
+static unsigned transform_lane_count = 1;
+
+void
+audiotools__MD5UpdateMany(audiotools__MD5Context *ctxs[],
+                          const void *bufs[],
+                          const unsigned long lens[],
+                          unsigned count)
+{
+    /*every stream's state, next whole block, and whole blocks left*/
+    uint32_t *states[MD5_MAX_LANES];
+    const unsigned char *blocks[MD5_MAX_LANES];
+    unsigned lane_stream[MD5_MAX_LANES];
+    const unsigned char **next;
+    unsigned long *remaining;
+    /*unused lanes transform this block into this state*/
+    static const unsigned char idle_block[64] = {0};
+    uint32_t idle_state[4] = {0, 0, 0, 0};
+    unsigned i;
+
+    if ((next = malloc(sizeof(const unsigned char*) * count)) == NULL ||
+        (remaining = malloc(sizeof(unsigned long) * count)) == NULL) {
+        /*fall back to hashing each stream separately*/
+        free(next);
+        for (i = 0; i < count; i++) {
+            audiotools__MD5Update(ctxs[i], bufs[i], lens[i]);
+        }
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        const unsigned used = ctxs[i]->bytes[0] & 0x3f;
+        unsigned long len = lens[i];
+
+        next[i] = bufs[i];
+
+        /*top up a partially filled block the ordinary way,
+          leaving either an empty block or nothing left to hash*/
+        if (used) {
+            const unsigned long head = MIN(len, 64 - used);
+            audiotools__MD5Update(ctxs[i], next[i], head);
+            next[i] += head;
+            len -= head;
+        }
+
+        add_byte_count(ctxs[i], len);
+        remaining[i] = len / 64;
+    }
+
+    for (;;) {
+        unsigned lanes = 0;
+
+        for (i = 0; (i < count) && (lanes < transform_lane_count); i++) {
+            if (remaining[i]) {
+                states[lanes] = ctxs[i]->buf;
+                blocks[lanes] = next[i];
+                lane_stream[lanes++] = i;
+            }
+        }
+
+        if (lanes == 0) {
+            break;
+        } else if (lanes == 1) {
+            /*a lone stream gains nothing from the wide kernel*/
+            transform_lanes_scalar(states, blocks);
+        } else {
+            for (i = lanes; i < transform_lane_count; i++) {
+                states[i] = idle_state;
+                blocks[i] = idle_block;
+            }
+            transform_lanes(states, blocks);
+        }
+
+        for (i = 0; i < lanes; i++) {
+            next[lane_stream[i]] += 64;
+            remaining[lane_stream[i]]--;
+        }
+    }
+
+    /*whatever is left is less than a block and starts a fresh one*/
+    for (i = 0; i < count; i++) {
+        memcpy(ctxs[i]->in,
+               next[i],
+               ((const unsigned char*)bufs[i] + lens[i]) - next[i]);
+    }
+
+    free(next);
+    free(remaining);
+}
+
+typedef void (*pack_samples_f)(unsigned char *block,
+                               const int samples[],
+                               unsigned count,
+                               int adjustment);
+
+static void
+pack_16_scalar(unsigned char *block,
+               const int samples[],
+               unsigned count,
+               int adjustment)
+{
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        const int value = samples[i] + adjustment;
+        block[0] = (unsigned char)value;
+        block[1] = (unsigned char)(value >> 8);
+        block += 2;
+    }
+}
+
+static void
+pack_24_scalar(unsigned char *block,
+               const int samples[],
+               unsigned count,
+               int adjustment)
+{
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        const int value = samples[i] + adjustment;
+        block[0] = (unsigned char)value;
+        block[1] = (unsigned char)(value >> 8);
+        block[2] = (unsigned char)(value >> 16);
+        block += 3;
+    }
+}
+
+#if defined(CPU_X86)
+/*keeps the low 2 or 3 bytes of each 32-bit lane, packed together*/
+#define LOW_16_BITS _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, \
+                                  -1, -1, -1, -1, -1, -1, -1, -1)
+#define LOW_24_BITS _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, \
+                                  -1, -1, -1, -1)
+
+CPU_TARGET("ssse3") static void
+pack_16_ssse3(unsigned char *block,
+              const int samples[],
+              unsigned count,
+              int adjustment)
+{
+    const __m128i shuffle = LOW_16_BITS;
+    const __m128i adjust = _mm_set1_epi32(adjustment);
+
+    for (; count >= 8; count -= 8) {
+        const __m128i a = _mm_shuffle_epi8(
+            _mm_add_epi32(_mm_loadu_si128((const __m128i*)samples), adjust),
+            shuffle);
+        const __m128i b = _mm_shuffle_epi8(
+            _mm_add_epi32(_mm_loadu_si128((const __m128i*)(samples + 4)),
+                          adjust),
+            shuffle);
+        _mm_storeu_si128((__m128i*)block, _mm_unpacklo_epi64(a, b));
+        samples += 8;
+        block += 16;
+    }
+
+    pack_16_scalar(block, samples, count, adjustment);
+}
+
+CPU_TARGET("ssse3") static void
+pack_24_ssse3(unsigned char *block,
+              const int samples[],
+              unsigned count,
+              int adjustment)
+{
+    const __m128i shuffle = LOW_24_BITS;
+    const __m128i adjust = _mm_set1_epi32(adjustment);
+
+    for (; count >= 8; count -= 8) {
+        /*12 bytes each*/
+        const __m128i a = _mm_shuffle_epi8(
+            _mm_add_epi32(_mm_loadu_si128((const __m128i*)samples), adjust),
+            shuffle);
+        const __m128i b = _mm_shuffle_epi8(
+            _mm_add_epi32(_mm_loadu_si128((const __m128i*)(samples + 4)),
+                          adjust),
+            shuffle);
+        _mm_storeu_si128((__m128i*)block,
+                         _mm_or_si128(a, _mm_slli_si128(b, 12)));
+        _mm_storel_epi64((__m128i*)(block + 16), _mm_srli_si128(b, 4));
+        samples += 8;
+        block += 24;
+    }
+
+    pack_24_scalar(block, samples, count, adjustment);
+}
+#elif defined(CPU_ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+static void
+pack_16_neon(unsigned char *block,
+             const int samples[],
+             unsigned count,
+             int adjustment)
+{
+    const int32x4_t adjust = vdupq_n_s32(adjustment);
+
+    for (; count >= 8; count -= 8) {
+        /*narrowing keeps the low 16 bits of each lane*/
+        const int16x4_t a = vmovn_s32(vaddq_s32(vld1q_s32(samples), adjust));
+        const int16x4_t b =
+            vmovn_s32(vaddq_s32(vld1q_s32(samples + 4), adjust));
+        vst1q_u8(block, vreinterpretq_u8_s16(vcombine_s16(a, b)));
+        samples += 8;
+        block += 16;
+    }
+
+    pack_16_scalar(block, samples, count, adjustment);
+}
+#endif
+
+/*2 and 3 byte little-endian packing kernels,
+  set by audiotools__MD5InitDispatch()*/
+static pack_samples_f pack_16 = pack_16_scalar;
+static pack_samples_f pack_24 = pack_24_scalar;
+
+void
+audiotools__MD5InitDispatch(void)
+{
+    pack_16 = pack_16_scalar;
+    pack_24 = pack_24_scalar;
+    transform_lanes = transform_lanes_scalar;
+    transform_lane_count = 1;
+#if defined(CPU_X86)
+    if (cpu_features() & CPU_SSSE3) {
+        pack_16 = pack_16_ssse3;
+        pack_24 = pack_24_ssse3;
+    }
+    if (cpu_features() & CPU_AVX2) {
+        transform_lanes = transform_lanes_avx2;
+        transform_lane_count = 8;
+    } else if (cpu_features() & CPU_SSE2) {
+        transform_lanes = transform_lanes_sse2;
+        transform_lane_count = 4;
+    }
+#elif defined(CPU_ARM_NEON)
+    if (cpu_features() & CPU_NEON) {
+#if !defined(__ARM_BIG_ENDIAN)
+        pack_16 = pack_16_neon;
+#endif
+        transform_lanes = transform_lanes_neon;
+        transform_lane_count = 4;
+    }
+#endif
+}
+
+/*packs "count" samples to "block" as little-endian
+  or big-endian bytes, offset by "adjustment"
+  to make them unsigned if necessary*/
+static void
+pack_samples(unsigned char *block,
+             const int samples[],
+             unsigned count,
+             unsigned bytes_per_sample,
+             int big_endian,
+             int adjustment)
+{
+    unsigned i;
+
+    if (big_endian && (bytes_per_sample > 1)) {
+        for (i = 0; i < count; i++) {
+            const int value = samples[i] + adjustment;
+            unsigned j;
+            for (j = bytes_per_sample; j > 0; j--) {
+                *block++ = (unsigned char)(value >> ((j - 1) * 8));
+            }
+        }
+        return;
+    }
+
+    switch (bytes_per_sample) {
+    case 1:
+        for (i = 0; i < count; i++) {
+            block[i] = (unsigned char)(samples[i] + adjustment);
+        }
+        break;
+    case 2:
+        pack_16(block, samples, count, adjustment);
+        break;
+    case 3:
+        pack_24(block, samples, count, adjustment);
+        break;
+    default:
+        for (i = 0; i < count; i++) {
+            const int value = samples[i] + adjustment;
+            unsigned j;
+            for (j = 0; j < bytes_per_sample; j++) {
+                *block++ = (unsigned char)(value >> (j * 8));
+            }
+        }
+        break;
+    }
+}
+
+void
+audiotools__MD5UpdateSamples(audiotools__MD5Context *ctx,
+                             const int samples[],
+                             unsigned total_samples,
+                             unsigned bits_per_sample,
+                             int is_big_endian,
+                             int is_signed)
+{
+    const unsigned bytes_per_sample = bits_per_sample / 8;
+    const int adjustment = is_signed ? 0 : (1 << (bits_per_sample - 1));
+    unsigned char *block = (unsigned char *)ctx->in;
+    unsigned used = ctx->bytes[0] & 0x3f;
+
+    add_byte_count(ctx, (uint64_t)total_samples * bytes_per_sample);
+
+    while (total_samples) {
+        /*as many whole samples as fit in the rest of the block*/
+        const unsigned to_pack = MIN((64 - used) / bytes_per_sample,
+                                     total_samples);
+
+        if (to_pack) {
+            pack_samples(block + used,
+                         samples,
+                         to_pack,
+                         bytes_per_sample,
+                         is_big_endian,
+                         adjustment);
+            used += to_pack * bytes_per_sample;
+            samples += to_pack;
+            total_samples -= to_pack;
+        } else {
+            /*a sample straddles the end of the block*/
+            const int value = *samples++ + adjustment;
+            unsigned i;
+
+            total_samples--;
+            for (i = 0; i < bytes_per_sample; i++) {
+                const unsigned shift = is_big_endian ?
+                    (bytes_per_sample - 1 - i) * 8 : i * 8;
+                block[used++] = (unsigned char)(value >> shift);
+                if (used == 64) {
+                    byteSwapX16(ctx->in);
+                    audiotools__MD5Transform(ctx->buf, ctx->in);
+                    used = 0;
+                }
+            }
+        }
+
+        if (used == 64) {
+            byteSwapX16(ctx->in);
+            audiotools__MD5Transform(ctx->buf, ctx->in);
+            used = 0;
+        }
+    }
+}
+
 /*
  * Start MD5 accumulation.  Set bit count to 0 and buffer to mysterious
  * initialization constants.
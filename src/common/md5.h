@@ -40,6 +40,11 @@ typedef struct {
 void
 audiotools__MD5Init(audiotools__MD5Context *context);
 
+/*picks the fastest sample packing and multi-stream transform kernels
+  the CPU supports, to be called once at startup*/
+void
+audiotools__MD5InitDispatch(void);
+
 void
 audiotools__MD5Final(unsigned char *digest,
                      audiotools__MD5Context *ctx);
@@ -49,4 +54,30 @@ audiotools__MD5Update(audiotools__MD5Context *ctx,
                       const void *buf,
                       unsigned long len);
 
+/*updates each of "count" contexts with its own buffer and length,
+  just as calling audiotools__MD5Update on each in turn would,
+  but hashes blocks from several streams at once
+  when the CPU has wide enough vectors*/
+void
+audiotools__MD5UpdateMany(audiotools__MD5Context *ctxs[],
+                          const void *bufs[],
+                          const unsigned long lens[],
+                          unsigned count);
+
+/*updates the context with "total_samples" PCM samples
+  as "bits_per_sample" bytes each,
+  big-endian if "is_big_endian" or little-endian if not,
+  signed if "is_signed" or unsigned if not
+
+  the bytes are packed straight into the MD5 block
+  so it hashes the same as converting them to a buffer
+  and passing that to audiotools__MD5Update*/
+void
+audiotools__MD5UpdateSamples(audiotools__MD5Context *ctx,
+                             const int samples[],
+                             unsigned total_samples,
+                             unsigned bits_per_sample,
+                             int is_big_endian,
+                             int is_signed);
+
 #endif
@@ -0,0 +1,301 @@
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef AUDIOTOOLS_STATS
+#include <time.h>
+#include <pthread.h>
+#endif
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+const char*
+stats_stage_name(stats_stage_t stage)
+{
+    switch (stage) {
+    case STATS_FLAC_DECODE_FRAME:         return "flac.decode.frame";
+    case STATS_FLAC_DECODE_FRAME_HEADER:  return "flac.decode.frame_header";
+    case STATS_FLAC_DECODE_RESIDUALS:     return "flac.decode.residuals";
+    case STATS_FLAC_DECODE_FIXED:         return "flac.decode.fixed";
+    case STATS_FLAC_DECODE_LPC:           return "flac.decode.lpc";
+    case STATS_FLAC_DECODE_MD5:           return "flac.decode.md5";
+    case STATS_FLAC_DECODE_FRAMELIST:     return "flac.decode.framelist";
+    case STATS_FLAC_ENCODE_READ:          return "flac.encode.read";
+    case STATS_FLAC_ENCODE_MD5:           return "flac.encode.md5";
+    case STATS_FLAC_ENCODE_FRAME:         return "flac.encode.frame";
+    case STATS_FLAC_ENCODE_FIXED:         return "flac.encode.fixed";
+    case STATS_FLAC_ENCODE_LPC:           return "flac.encode.lpc";
+    case STATS_FLAC_ENCODE_SUBFRAME:      return "flac.encode.subframe";
+    case STATS_ALAC_DECODE_FRAME:         return "alac.decode.frame";
+    case STATS_ALAC_DECODE_RESIDUALS:     return "alac.decode.residuals";
+    case STATS_ALAC_DECODE_PREDICTION:    return "alac.decode.prediction";
+    case STATS_ALAC_DECODE_FRAMELIST:     return "alac.decode.framelist";
+    case STATS_ALAC_ENCODE_READ:          return "alac.encode.read";
+    case STATS_ALAC_ENCODE_FRAME:         return "alac.encode.frame";
+    case STATS_ALAC_ENCODE_LPC:           return "alac.encode.lpc";
+    case STATS_ALAC_ENCODE_RESIDUALS:     return "alac.encode.residuals";
+    case STATS_TTA_DECODE_FRAME:          return "tta.decode.frame";
+    case STATS_TTA_DECODE_FRAMELIST:      return "tta.decode.framelist";
+    case STATS_TTA_ENCODE_READ:           return "tta.encode.read";
+    case STATS_TTA_ENCODE_FRAME:          return "tta.encode.frame";
+    case STATS_PCMCONVERTER_AVERAGER:     return "pcmconverter.averager";
+    case STATS_PCMCONVERTER_DOWNMIXER:    return "pcmconverter.downmixer";
+    case STATS_PCMCONVERTER_RESAMPLER:    return "pcmconverter.resampler";
+    case STATS_PCMCONVERTER_BPSCONVERTER: return "pcmconverter.bpsconverter";
+    default:                              return "unknown";
+    }
+}
+
+#ifdef AUDIOTOOLS_STATS
+
+volatile int stats_enabled = 0;
+
+/*one thread's counters, linked into a list of all live threads*/
+struct stats_thread {
+    struct stats_counter counters[STATS_STAGES];
+    struct stats_thread *next;
+};
+
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+
+/*the list of live threads and the totals of exited threads
+  are both protected by this mutex*/
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct stats_thread *stats_threads = NULL;
+static struct stats_counter stats_exited[STATS_STAGES];
+
+static void
+add_counters(struct stats_counter total[STATS_STAGES],
+             const struct stats_counter counters[STATS_STAGES])
+{
+    unsigned i;
+    for (i = 0; i < STATS_STAGES; i++) {
+        total[i].calls += counters[i].calls;
+        total[i].samples += counters[i].samples;
+        total[i].nanoseconds += counters[i].nanoseconds;
+    }
+}
+
+/*called as a thread exits to fold its counters into the exited totals*/
+static void
+thread_exited(void *data)
+{
+    struct stats_thread *thread = data;
+    struct stats_thread **link;
+
+    pthread_mutex_lock(&stats_mutex);
+    add_counters(stats_exited, thread->counters);
+    for (link = &stats_threads; *link; link = &((*link)->next)) {
+        if (*link == thread) {
+            *link = thread->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&stats_mutex);
+    free(thread);
+}
+
+static void
+create_key(void)
+{
+    pthread_key_create(&stats_key, thread_exited);
+}
+
+/*returns the calling thread's counters, allocating them on first use,
+  or NULL if they can't be allocated*/
+static struct stats_thread*
+current_thread(void)
+{
+    struct stats_thread *thread;
+
+    pthread_once(&stats_once, create_key);
+    if ((thread = pthread_getspecific(stats_key)) == NULL) {
+        if ((thread = calloc(1, sizeof(struct stats_thread))) == NULL) {
+            return NULL;
+        }
+        pthread_mutex_lock(&stats_mutex);
+        thread->next = stats_threads;
+        stats_threads = thread;
+        pthread_mutex_unlock(&stats_mutex);
+        pthread_setspecific(stats_key, thread);
+    }
+    return thread;
+}
+
+uint64_t
+stats_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    /*never 0, since that marks a timer as disabled*/
+    return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec + 1;
+}
+
+void
+stats_record(stats_stage_t stage, uint64_t start, unsigned samples)
+{
+    struct stats_thread *thread = current_thread();
+    struct stats_counter *counter;
+
+    if (thread == NULL) {
+        /*out of memory, so this thread goes uncounted*/
+        return;
+    }
+
+    counter = &(thread->counters[stage]);
+    counter->calls += 1;
+    counter->samples += samples;
+    counter->nanoseconds += stats_now() - start;
+}
+
+void
+stats_init(void)
+{
+    const char *enabled = getenv("AUDIOTOOLS_STATS");
+    if (enabled && strcmp(enabled, "") && strcmp(enabled, "0")) {
+        stats_enabled = 1;
+    }
+}
+
+int
+stats_enable(int enabled)
+{
+    stats_enabled = enabled;
+    return enabled;
+}
+
+void
+stats_read(struct stats_counter totals[STATS_STAGES])
+{
+    struct stats_thread *thread;
+
+    /*other threads may be updating their counters as they're summed
+      which is fine for reporting since each is only ever incremented*/
+    pthread_mutex_lock(&stats_mutex);
+    memcpy(totals, stats_exited, sizeof(stats_exited));
+    for (thread = stats_threads; thread; thread = thread->next) {
+        add_counters(totals, thread->counters);
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void
+stats_reset(void)
+{
+    struct stats_thread *thread;
+
+    pthread_mutex_lock(&stats_mutex);
+    memset(stats_exited, 0, sizeof(stats_exited));
+    for (thread = stats_threads; thread; thread = thread->next) {
+        memset(thread->counters, 0, sizeof(thread->counters));
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+#else
+
+void
+stats_init(void)
+{
+    return;
+}
+
+int
+stats_enable(int enabled)
+{
+    return 0;
+}
+
+void
+stats_read(struct stats_counter totals[STATS_STAGES])
+{
+    memset(totals, 0, sizeof(struct stats_counter) * STATS_STAGES);
+}
+
+void
+stats_reset(void)
+{
+    return;
+}
+
+#endif
+
+#ifdef HAS_PYTHON
+
+PyObject*
+stats_py_stats(PyObject *dummy, PyObject *args)
+{
+    struct stats_counter totals[STATS_STAGES];
+    PyObject *stats;
+    unsigned i;
+
+    if ((stats = PyDict_New()) == NULL) {
+        return NULL;
+    }
+
+    stats_read(totals);
+
+    /*only stages which have run are returned*/
+    for (i = 0; i < STATS_STAGES; i++) {
+        if (totals[i].calls) {
+            PyObject *value = Py_BuildValue(
+                "(KKd)",
+                (unsigned PY_LONG_LONG)totals[i].calls,
+                (unsigned PY_LONG_LONG)totals[i].samples,
+                (double)totals[i].nanoseconds / 1e9);
+            if (value == NULL) {
+                Py_DECREF(stats);
+                return NULL;
+            } else if (PyDict_SetItemString(stats,
+                                            stats_stage_name(i),
+                                            value)) {
+                Py_DECREF(value);
+                Py_DECREF(stats);
+                return NULL;
+            } else {
+                Py_DECREF(value);
+            }
+        }
+    }
+
+    return stats;
+}
+
+PyObject*
+stats_py_reset_stats(PyObject *dummy, PyObject *args)
+{
+    stats_reset();
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject*
+stats_py_enable_stats(PyObject *dummy, PyObject *args)
+{
+    int enabled;
+
+    if (!PyArg_ParseTuple(args, "i", &enabled)) {
+        return NULL;
+    } else {
+        return PyBool_FromLong(stats_enable(enabled));
+    }
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef STATS_H
+#define STATS_H
+
+#ifdef HAS_PYTHON
+#include <Python.h>
+#endif
+#include <stdint.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*opt-in timing and event counters for the codecs' internal stages
+
+  the STATS_START and STATS_STOP macros only expand to anything
+  if AUDIOTOOLS_STATS is defined at compile-time,
+  and only record anything while stats are enabled at runtime,
+  either by stats_enable() or by the AUDIOTOOLS_STATS
+  environment variable being set when the module is loaded
+
+  each thread accumulates into its own counters,
+  so recording needs no locking,
+  and stats_read() sums the counters of every thread*/
+
+typedef enum {
+    STATS_FLAC_DECODE_FRAME,
+    STATS_FLAC_DECODE_FRAME_HEADER,
+    STATS_FLAC_DECODE_RESIDUALS,
+    STATS_FLAC_DECODE_FIXED,
+    STATS_FLAC_DECODE_LPC,
+    STATS_FLAC_DECODE_MD5,
+    STATS_FLAC_DECODE_FRAMELIST,
+    STATS_FLAC_ENCODE_READ,
+    STATS_FLAC_ENCODE_MD5,
+    STATS_FLAC_ENCODE_FRAME,
+    STATS_FLAC_ENCODE_FIXED,
+    STATS_FLAC_ENCODE_LPC,
+    STATS_FLAC_ENCODE_SUBFRAME,
+    STATS_ALAC_DECODE_FRAME,
+    STATS_ALAC_DECODE_RESIDUALS,
+    STATS_ALAC_DECODE_PREDICTION,
+    STATS_ALAC_DECODE_FRAMELIST,
+    STATS_ALAC_ENCODE_READ,
+    STATS_ALAC_ENCODE_FRAME,
+    STATS_ALAC_ENCODE_LPC,
+    STATS_ALAC_ENCODE_RESIDUALS,
+    STATS_TTA_DECODE_FRAME,
+    STATS_TTA_DECODE_FRAMELIST,
+    STATS_TTA_ENCODE_READ,
+    STATS_TTA_ENCODE_FRAME,
+    STATS_PCMCONVERTER_AVERAGER,
+    STATS_PCMCONVERTER_DOWNMIXER,
+    STATS_PCMCONVERTER_RESAMPLER,
+    STATS_PCMCONVERTER_BPSCONVERTER,
+    STATS_STAGES
+} stats_stage_t;
+
+struct stats_counter {
+    uint64_t calls;       /*number of times the stage has run*/
+    uint64_t samples;     /*number of PCM samples the stage has handled*/
+    uint64_t nanoseconds; /*total time spent in the stage*/
+};
+
+/*returns a stage's name, such as "flac.decode.frame"*/
+const char*
+stats_stage_name(stats_stage_t stage);
+
+/*enables stats if the AUDIOTOOLS_STATS environment variable is set
+  and this module was built with AUDIOTOOLS_STATS defined*/
+void
+stats_init(void);
+
+/*turns recording on or off and returns whether it is now on
+
+  does nothing and returns 0 if AUDIOTOOLS_STATS wasn't defined*/
+int
+stats_enable(int enabled);
+
+/*places the sum of all threads' counters in "totals"*/
+void
+stats_read(struct stats_counter totals[STATS_STAGES]);
+
+/*sets all threads' counters to 0*/
+void
+stats_reset(void);
+
+#ifdef AUDIOTOOLS_STATS
+extern volatile int stats_enabled;
+
+/*returns the current time in nanoseconds from a monotonic clock*/
+uint64_t
+stats_now(void);
+
+/*adds one call of "stage" lasting from "start" until now
+  and handling "samples" PCM samples to the current thread's counters*/
+void
+stats_record(stats_stage_t stage, uint64_t start, unsigned samples);
+
+/*declares a timer which is 0 if stats are disabled*/
+#define STATS_START(timer) \
+    const uint64_t timer = stats_enabled ? stats_now() : 0
+
+#define STATS_STOP(timer, stage, samples) \
+    do {                                                \
+        if (timer) {                                    \
+            stats_record((stage), (timer), (samples));  \
+        }                                               \
+    } while (0)
+#else
+#define STATS_START(timer)
+#define STATS_STOP(timer, stage, samples) do {} while (0)
+#endif
+
+#ifdef HAS_PYTHON
+PyObject*
+stats_py_stats(PyObject *dummy, PyObject *args);
+
+PyObject*
+stats_py_reset_stats(PyObject *dummy, PyObject *args);
+
+PyObject*
+stats_py_enable_stats(PyObject *dummy, PyObject *args);
+
+/*entries for a module's method table*/
+#define STATS_METHODS \
+    {"stats", (PyCFunction)stats_py_stats, \
+     METH_NOARGS, "stats() -> {stage:(calls, samples, seconds)}"}, \
+    {"reset_stats", (PyCFunction)stats_py_reset_stats, \
+     METH_NOARGS, "reset_stats() sets all stage counters to 0"}, \
+    {"enable_stats", (PyCFunction)stats_py_enable_stats, \
+     METH_VARARGS, "enable_stats(enabled) -> True if now recording"}
+#endif
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef TTA_FILTER_H
+#define TTA_FILTER_H
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*the 8-tap adaptive hybrid filter shared by the TTA encoder and decoder
+
+  the encoder and decoder differ only in whether the filter's output
+  is subtracted from or added to the input sample,
+  so both use these routines for the per-sample vector work
+
+  all arithmetic wraps modulo 2 ^ 32, as in the scalar reference,
+  so the SSE2 and NEON kernels are bit-exact with it*/
+
+static inline int
+tta_sign(int x)
+{
+    if (x > 0) {
+        return 1;
+    } else if (x < 0) {
+        return -1;
+    } else {
+        return 0;
+    }
+}
+
+#if defined(__SSE2__) && !defined(__SSE4_1__)
+/*SSE2 has no 32-bit low multiply, so build one from
+  two unsigned 32x32->64 multiplies of the even and odd lanes
+  whose low halves are the same as a signed multiply*/
+static inline __m128i
+tta_mullo_epi32(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32),
+                                      _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#elif defined(__SSE4_1__)
+#define tta_mullo_epi32 _mm_mullo_epi32
+#endif
+
+/*adjusts each coefficient in qm by dx in the direction of previous_sign
+  and returns the dot product of the adjusted qm and dl*/
+static inline int32_t
+tta_filter_predict(int qm[8],
+                   const int dx[8],
+                   const int dl[8],
+                   int previous_sign)
+{
+#if defined(__SSE2__)
+    __m128i qm_lo = _mm_loadu_si128((const __m128i*)qm);
+    __m128i qm_hi = _mm_loadu_si128((const __m128i*)(qm + 4));
+    __m128i product;
+
+    if (previous_sign > 0) {
+        qm_lo = _mm_add_epi32(qm_lo, _mm_loadu_si128((const __m128i*)dx));
+        qm_hi = _mm_add_epi32(qm_hi,
+                              _mm_loadu_si128((const __m128i*)(dx + 4)));
+        _mm_storeu_si128((__m128i*)qm, qm_lo);
+        _mm_storeu_si128((__m128i*)(qm + 4), qm_hi);
+    } else if (previous_sign < 0) {
+        qm_lo = _mm_sub_epi32(qm_lo, _mm_loadu_si128((const __m128i*)dx));
+        qm_hi = _mm_sub_epi32(qm_hi,
+                              _mm_loadu_si128((const __m128i*)(dx + 4)));
+        _mm_storeu_si128((__m128i*)qm, qm_lo);
+        _mm_storeu_si128((__m128i*)(qm + 4), qm_hi);
+    }
+
+    product = _mm_add_epi32(
+        tta_mullo_epi32(qm_lo, _mm_loadu_si128((const __m128i*)dl)),
+        tta_mullo_epi32(qm_hi, _mm_loadu_si128((const __m128i*)(dl + 4))));
+    product = _mm_add_epi32(product,
+                            _mm_shuffle_epi32(product,
+                                              _MM_SHUFFLE(1, 0, 3, 2)));
+    product = _mm_add_epi32(product,
+                            _mm_shuffle_epi32(product,
+                                              _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(product);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int32x4_t qm_lo = vld1q_s32(qm);
+    int32x4_t qm_hi = vld1q_s32(qm + 4);
+    int32x4_t product;
+    int32x2_t sum;
+
+    if (previous_sign > 0) {
+        qm_lo = vaddq_s32(qm_lo, vld1q_s32(dx));
+        qm_hi = vaddq_s32(qm_hi, vld1q_s32(dx + 4));
+        vst1q_s32(qm, qm_lo);
+        vst1q_s32(qm + 4, qm_hi);
+    } else if (previous_sign < 0) {
+        qm_lo = vsubq_s32(qm_lo, vld1q_s32(dx));
+        qm_hi = vsubq_s32(qm_hi, vld1q_s32(dx + 4));
+        vst1q_s32(qm, qm_lo);
+        vst1q_s32(qm + 4, qm_hi);
+    }
+
+    product = vmulq_s32(qm_lo, vld1q_s32(dl));
+    product = vmlaq_s32(product, qm_hi, vld1q_s32(dl + 4));
+    sum = vadd_s32(vget_low_s32(product), vget_high_s32(product));
+    return vget_lane_s32(vpadd_s32(sum, sum), 0);
+#else
+    uint32_t sum = 0;
+    unsigned i;
+
+    for (i = 0; i < 8; i++) {
+        qm[i] += previous_sign * dx[i];
+        sum += (uint32_t)dl[i] * (uint32_t)qm[i];
+    }
+    return (int32_t)sum;
+#endif
+}
+
+/*shifts the filter's history along by one sample
+  with "value" being the newest unfiltered sample*/
+static inline void
+tta_filter_update(int dx[8], int dl[8], int value)
+{
+#if defined(__SSE2__)
+    /*the high half of dx becomes 1, 2, 2, 4
+      with the sign of the corresponding dl value*/
+    const __m128i dl_hi = _mm_loadu_si128((const __m128i*)(dl + 4));
+    const __m128i dl_sign = _mm_srai_epi32(dl_hi, 31);
+    const __m128i magnitude = _mm_setr_epi32(1, 2, 2, 4);
+
+    _mm_storeu_si128((__m128i*)dx, _mm_loadu_si128((const __m128i*)(dx + 1)));
+    _mm_storeu_si128((__m128i*)(dx + 4),
+                     _mm_sub_epi32(_mm_xor_si128(magnitude, dl_sign),
+                                   dl_sign));
+    _mm_storeu_si128((__m128i*)dl, _mm_loadu_si128((const __m128i*)(dl + 1)));
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    static const int32_t magnitudes[4] = {1, 2, 2, 4};
+    const int32x4_t dl_sign = vshrq_n_s32(vld1q_s32(dl + 4), 31);
+    const int32x4_t magnitude = vld1q_s32(magnitudes);
+
+    vst1q_s32(dx, vld1q_s32(dx + 1));
+    vst1q_s32(dx + 4, vsubq_s32(veorq_s32(magnitude, dl_sign), dl_sign));
+    vst1q_s32(dl, vld1q_s32(dl + 1));
+#else
+    dx[0] = dx[1];
+    dx[1] = dx[2];
+    dx[2] = dx[3];
+    dx[3] = dx[4];
+    dx[4] = dl[4] >= 0 ? 1 : -1;
+    dx[5] = dl[5] >= 0 ? 2 : -2;
+    dx[6] = dl[6] >= 0 ? 2 : -2;
+    dx[7] = dl[7] >= 0 ? 4 : -4;
+    dl[0] = dl[1];
+    dl[1] = dl[2];
+    dl[2] = dl[3];
+    dl[3] = dl[4];
+#endif
+    /*the high half of dl is a running 3rd-order difference
+      which depends on itself serially*/
+    dl[4] = -dl[5] + (-dl[6] + (value - dl[7]));
+    dl[5] = -dl[6] + (value - dl[7]);
+    dl[6] = value - dl[7];
+    dl[7] = value;
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include <Python.h>
 #include "mod_defs.h"
+#include "common/stats.h"
+#include "common/md5.h"
 #include "decoders.h"
 #ifdef HAS_MP3
 #include <mpg123.h>
@@ -49,6 +51,9 @@ MOD_INIT(decoders)
 
     MOD_DEF(m, "decoders", "low-level audio format decoders", module_methods)
 
+    stats_init();
+    audiotools__MD5InitDispatch();
+
     decoders_FlacDecoderType.tp_new = PyType_GenericNew;
     if (PyType_Ready(&decoders_FlacDecoderType) < 0)
         return MOD_ERROR_VAL;
@@ -28,5 +28,6 @@ typedef int Py_ssize_t;
 #endif
 
 PyMethodDef module_methods[] = {
+    STATS_METHODS,
     {NULL}
 };
@@ -1,6 +1,7 @@
 #include "alac.h"
 #include "../common/m4a_atoms.h"
 #include "../framelist.h"
+#include "../common/stats.h"
 #include <string.h>
 
 /********************************************************
@@ -58,13 +59,20 @@ static int
 get_decoding_parameters(decoders_ALACDecoder *self,
                         struct qt_atom *moov_atom);
 
+#ifndef STANDALONE
 /*given a "moov" atom, parses the stream's seektable
   returns 1 on success, 0 on failure*/
 static int
 get_seektable(decoders_ALACDecoder *self,
               struct qt_atom *moov_atom);
 
-#ifndef STANDALONE
+/*given a seektable with total_alac_frames + 1 entries,
+  returns the latest seekpoint whose PCM frame offset is <= pcm_offset*/
+static const struct alac_seekpoint*
+find_seekpoint(const struct alac_seekpoint *seektable,
+               unsigned total_alac_frames,
+               long long pcm_offset);
+
 static PyObject*
 alac_exception(status_t status);
 #endif
@@ -387,12 +395,17 @@ ALACDecoder_read(decoders_ALACDecoder* self, PyObject *args)
     }
 
     /*build FrameList based on alac decoding parameters*/
+    STATS_START(framelist_timer);
     framelist = new_FrameList(self->audiotools_pcm,
                               self->channels,
                               self->bits_per_sample,
                               self->params.block_size);
+    STATS_STOP(framelist_timer,
+               STATS_ALAC_DECODE_FRAMELIST,
+               self->params.block_size * self->channels);
 
     /*decode ALAC frameset to FrameList*/
+    STATS_START(frame_timer);
     if (!setjmp(*br_try(self->bitstream))) {
         status = decode_frameset(self,
                                  &pcm_frames_read,
@@ -420,6 +433,10 @@ ALACDecoder_read(decoders_ALACDecoder* self, PyObject *args)
                      self->channels,
                      framelist->samples);
 
+    STATS_STOP(frame_timer,
+               STATS_ALAC_DECODE_FRAME,
+               pcm_frames_read * self->channels);
+
     self->read_pcm_frames += pcm_frames_read;
 
     /*return populated FrameList*/
@@ -458,21 +475,12 @@ ALACDecoder_seek(decoders_ALACDecoder* self, PyObject *args)
             return NULL;
         }
     } else {
-        unsigned i;
-        unsigned pcm_frames_offset = 0;
-        long byte_offset = 0;
-
-        /*find latest seekpoint whose first sample is <= seeked_offset
-          or 0 if there are no seekpoints in the seektable*/
-        for (i = 0; i < self->total_alac_frames; i++) {
-            if (seeked_offset >= self->seektable[i].pcm_frames) {
-                seeked_offset -= self->seektable[i].pcm_frames;
-                pcm_frames_offset += self->seektable[i].pcm_frames;
-                byte_offset += self->seektable[i].byte_size;
-            } else {
-                break;
-            }
-        }
+        const struct alac_seekpoint *seekpoint =
+            find_seekpoint(self->seektable,
+                           self->total_alac_frames,
+                           seeked_offset);
+        const unsigned pcm_frames_offset = seekpoint->pcm_frame_offset;
+        const long byte_offset = seekpoint->byte_offset;
 
         /*position bitstream to indicated position in file*/
         if (!setjmp(*br_try(self->bitstream))) {
@@ -590,6 +598,7 @@ get_decoding_parameters(decoders_ALACDecoder *self,
     return 1;
 }
 
+#ifndef STANDALONE
 static int
 get_seektable(decoders_ALACDecoder *self,
               struct qt_atom *moov_atom)
@@ -623,23 +632,50 @@ get_seektable(decoders_ALACDecoder *self,
         return 0;
     }
 
-    /*allocate and populate seektable*/
+    /*allocate and populate seektable with cumulative offsets
+      plus a final entry for the end of the stream*/
     time = stts_atom->_.stts.times[0];
     self->total_alac_frames = stts_total_frames;
-    self->seektable = malloc(stts_total_frames * sizeof(struct alac_seekpoint));
+    self->seektable = malloc((stts_total_frames + 1) *
+                             sizeof(struct alac_seekpoint));
+    self->seektable[0].pcm_frame_offset = 0;
+    self->seektable[0].byte_offset = 0;
     for (i = j = 0; i < stts_total_frames; i++) {
         while (time.occurences == 0) {
             time = stts_atom->_.stts.times[++j];
         }
-        self->seektable[i].pcm_frames = time.pcm_frame_count;
-        self->seektable[i].byte_size = stsz_atom->_.stsz.frame_size[i];
+        self->seektable[i + 1].pcm_frame_offset =
+            self->seektable[i].pcm_frame_offset + time.pcm_frame_count;
+        self->seektable[i + 1].byte_offset =
+            self->seektable[i].byte_offset + stsz_atom->_.stsz.frame_size[i];
         time.occurences -= 1;
     }
 
     return 1;
 }
 
-#ifndef STANDALONE
+static const struct alac_seekpoint*
+find_seekpoint(const struct alac_seekpoint *seektable,
+               unsigned total_alac_frames,
+               long long pcm_offset)
+{
+    unsigned low = 0;
+    unsigned high = total_alac_frames;
+
+    /*seektable[low] is always <= pcm_offset
+      since the first seekpoint starts at 0*/
+    while (low < high) {
+        const unsigned middle = low + ((high - low + 1) / 2);
+        if (seektable[middle].pcm_frame_offset <= pcm_offset) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    return &seektable[low];
+}
+
 static PyObject*
 alac_exception(status_t status)
 {
@@ -984,6 +1020,7 @@ read_residual_block(BitstreamReader *br,
     int history = params->initial_history;
     unsigned sign_modifier = 0;
     unsigned i = 0;
+    STATS_START(residual_timer);
 
     while (i < block_size) {
         /*get an unsigned residual based on "history"
@@ -1040,6 +1077,8 @@ read_residual_block(BitstreamReader *br,
             }
         }
     }
+
+    STATS_STOP(residual_timer, STATS_ALAC_DECODE_RESIDUALS, block_size);
 }
 
 static unsigned
@@ -1109,6 +1148,7 @@ decode_subframe(unsigned block_size,
     const unsigned coeff_count = subframe_header->coeff_count;
     int *coeff = subframe_header->coeff;
     unsigned i;
+    STATS_START(prediction_timer);
 
     subframe[0] = residuals[0];
 
@@ -1155,6 +1195,8 @@ decode_subframe(unsigned block_size,
             }
         }
     }
+
+    STATS_STOP(prediction_timer, STATS_ALAC_DECODE_PREDICTION, block_size);
 }
 
 static void
@@ -30,9 +30,12 @@ struct alac_parameters {
     unsigned maximum_K;
 };
 
+/*each seekpoint is the starting position of a single ALAC frame
+  with cumulative PCM frame and byte offsets,
+  so seeking is a binary search rather than a walk over frame sizes*/
 struct alac_seekpoint {
-    unsigned pcm_frames;
-    unsigned byte_size;
+    unsigned pcm_frame_offset;  /*PCM frames prior to this ALAC frame*/
+    long byte_offset;           /*bytes from start of mdat's contents*/
 };
 
 typedef struct {
@@ -52,6 +55,8 @@ typedef struct {
     unsigned channels;
     unsigned sample_rate;
 
+    /*the seektable has total_alac_frames + 1 entries
+      where the final entry marks the end of the stream*/
     unsigned total_alac_frames;
     struct alac_seekpoint *seektable;
 
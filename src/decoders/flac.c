@@ -1,6 +1,7 @@
 #include "flac.h"
 #include "../framelist.h"
 #include "../common/flac_crc.h"
+#include "../common/stats.h"
 #include <string.h>
 #include <errno.h>
 
@@ -61,7 +62,27 @@ struct frame_header {
     channel_assignment_t channel_assignment;
     unsigned channel_count;
     unsigned bits_per_sample;
-    unsigned frame_number;
+    uint64_t frame_number;     /*sample number if blocking strategy is 1*/
+};
+
+/*the size of each read performed when scanning for frames*/
+#define SCAN_CHUNK_SIZE 65536
+
+/*the largest possible frame header, including its sync code and CRC-8*/
+#define MAX_FRAME_HEADER_SIZE 16
+
+/*locates frames by their sync codes and headers alone
+  without decoding any subframes*/
+struct frame_scanner {
+    BitstreamReader *r;
+    const struct STREAMINFO *streaminfo;
+    uint8_t buffer[SCAN_CHUNK_SIZE + MAX_FRAME_HEADER_SIZE];
+    unsigned buffer_size;     /*the amount of data in buffer*/
+    unsigned position;        /*the next byte in buffer to scan*/
+    uint64_t buffer_offset;   /*offset of buffer[0] from start of scan*/
+    int end_of_stream;
+    uint64_t next_sample;     /*the sample the next frame must start at*/
+    unsigned block_size;      /*the first frame's block size, or 0*/
 };
 
 const static uint8_t empty_md5[16] = {0, 0, 0, 0, 0, 0, 0, 0,
@@ -97,7 +118,54 @@ read_frame_header(BitstreamReader *r,
                   struct frame_header *frame_header);
 
 static status_t
-read_utf8(BitstreamReader *r, unsigned *utf8);
+read_utf8(BitstreamReader *r, uint64_t *utf8);
+
+#ifndef STANDALONE
+/*decodes the next frame to a FrameList,
+  less any samples dropped by an exact seek
+  which may leave it empty before the end of the stream*/
+static PyObject*
+read_next_frame(decoders_FlacDecoder* self);
+
+/*reads up to "count" bytes from the reader to "buffer"
+  and returns the amount actually read,
+  which is less than "count" only at the end of the stream*/
+static unsigned
+read_available(BitstreamReader *r, uint8_t buffer[], unsigned count);
+
+/*block_size is that of the stream's first frame,
+  which a fixed-blocksize stream uses for every frame but the last
+  and which converts their frame numbers to sample numbers*/
+static void
+init_frame_scanner(struct frame_scanner *scanner,
+                   BitstreamReader *r,
+                   const struct STREAMINFO *streaminfo,
+                   uint64_t first_sample,
+                   unsigned block_size);
+
+/*returns the block size in the stream's first frame header
+  or 0 if that header is invalid
+
+  leaves the stream positioned at the first frame
+  and calls br_abort if an I/O error occurs*/
+static unsigned
+first_block_size(decoders_FlacDecoder *self);
+
+/*moves the reader forward by the given number of bytes*/
+static void
+seek_forward(BitstreamReader *r, uint64_t offset);
+
+/*finds the next frame starting at the scanner's next sample
+  and sets its byte offset from where scanning began
+  along with its frame header
+
+  returns 1 if a frame is found, 0 at the end of the stream,
+  and calls br_abort if an I/O error occurs*/
+static int
+next_scanned_frame(struct frame_scanner *scanner,
+                   uint64_t *byte_offset,
+                   struct frame_header *frame_header);
+#endif
 
 typedef status_t (*decode_f)(BitstreamReader *r,
                              const struct frame_header *frame_header,
@@ -272,6 +340,7 @@ FlacDecoder_init(decoders_FlacDecoder *self,
     self->seektable.seek_points = NULL;
     self->channel_mask = 0;
     self->remaining_samples = 0;
+    self->skip_samples = 0;
     self->closed = 0;
     audiotools__MD5Init(&(self->md5));
     self->perform_validation = 1;
@@ -499,6 +568,25 @@ FlacDecoder_channel_mask(decoders_FlacDecoder *self, void *closure)
 
 PyObject*
 FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args)
+{
+    for (;;) {
+        pcm_FrameList *framelist = (pcm_FrameList*)read_next_frame(self);
+
+        /*skip past frames whose samples all precede
+          an exact seek's target*/
+        if ((framelist == NULL) ||
+            (framelist->frames > 0) ||
+            (self->skip_samples == 0) ||
+            (self->remaining_samples == 0)) {
+            return (PyObject*)framelist;
+        } else {
+            Py_DECREF((PyObject*)framelist);
+        }
+    }
+}
+
+static PyObject*
+read_next_frame(decoders_FlacDecoder* self)
 {
     status_t status;
     struct frame_header frame_header;
@@ -530,6 +618,9 @@ FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args)
         }
     }
 
+    STATS_START(frame_timer);
+    STATS_START(header_timer);
+
     self->bitstream->add_callback(self->bitstream,
                                   (bs_callback_f)flac_crc16,
                                   &crc16);
@@ -542,6 +633,9 @@ FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args)
         PyErr_SetString(flac_exception(status), flac_strerror(status));
         return NULL;
     } else {
+        STATS_STOP(header_timer, STATS_FLAC_DECODE_FRAME_HEADER, 0);
+        STATS_START(framelist_timer);
+
         /*setup framelist to be output once populated*/
         pcm_FrameList *framelist = new_FrameList(self->audiotools_pcm,
                                                  frame_header.channel_count,
@@ -552,6 +646,10 @@ FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args)
         decode_f decode = get_decoder(frame_header.channel_assignment);
         assert(decode);
 
+        STATS_STOP(framelist_timer,
+                   STATS_FLAC_DECODE_FRAMELIST,
+                   framelist->frames * framelist->channels);
+
         if ((status = decode(self->bitstream,
                              &frame_header,
                              framelist->samples)) != OK) {
@@ -576,16 +674,37 @@ FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args)
 
         /*if validating, update running MD5 sum*/
         if (self->perform_validation) {
+            STATS_START(md5_timer);
             update_md5sum(&(self->md5),
                           framelist->samples,
                           frame_header.channel_count,
                           frame_header.bits_per_sample,
                           frame_header.block_size);
+            STATS_STOP(md5_timer,
+                       STATS_FLAC_DECODE_MD5,
+                       framelist->frames * framelist->channels);
         }
 
         self->remaining_samples -= MIN(self->remaining_samples,
                                        frame_header.block_size);
 
+        /*drop any leading samples before an exact seek's target*/
+        if (self->skip_samples) {
+            const unsigned skip = (unsigned)MIN(self->skip_samples,
+                                                framelist->frames);
+            memmove(framelist->samples,
+                    framelist->samples + (skip * framelist->channels),
+                    (framelist->frames - skip) *
+                    framelist->channels *
+                    sizeof(int));
+            framelist->frames -= skip;
+            self->skip_samples -= skip;
+        }
+
+        STATS_STOP(frame_timer,
+                   STATS_FLAC_DECODE_FRAME,
+                   frame_header.block_size * frame_header.channel_count);
+
         return (PyObject*)framelist;
     }
 }
@@ -709,9 +828,74 @@ FlacDecoder_frame_size(decoders_FlacDecoder* self, PyObject *args)
 }
 
 static PyObject*
-FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args)
+FlacDecoder_index(decoders_FlacDecoder* self, PyObject *args)
 {
+    const struct STREAMINFO *streaminfo = &(self->streaminfo);
+    struct frame_scanner scanner;
+    uint64_t byte_offset;
+    struct frame_header frame_header;
+    PyObject *index;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return NULL;
+    }
+
+    if ((index = PyList_New(0)) == NULL) {
+        return NULL;
+    }
+
+    if (!setjmp(*br_try(self->bitstream))) {
+        init_frame_scanner(&scanner,
+                           self->bitstream,
+                           streaminfo,
+                           0,
+                           first_block_size(self));
+
+        while (((streaminfo->total_samples == 0) ||
+                (scanner.next_sample < streaminfo->total_samples)) &&
+               next_scanned_frame(&scanner, &byte_offset, &frame_header)) {
+            PyObject *entry = Py_BuildValue(
+                "(K, K, I)",
+                (unsigned long long)byte_offset,
+                (unsigned long long)(scanner.next_sample -
+                                     frame_header.block_size),
+                frame_header.block_size);
+
+            if ((entry == NULL) || (PyList_Append(index, entry) == -1)) {
+                Py_XDECREF(entry);
+                br_etry(self->bitstream);
+                Py_DECREF(index);
+                return NULL;
+            }
+            Py_DECREF(entry);
+        }
+
+        /*rewind stream to the first frame*/
+        self->bitstream->setpos(self->bitstream, self->beginning_of_frames);
+        br_etry(self->bitstream);
+    } else {
+        br_etry(self->bitstream);
+        Py_DECREF(index);
+        PyErr_SetString(PyExc_IOError, "I/O error indexing stream");
+        return NULL;
+    }
+
+    self->remaining_samples = streaminfo->total_samples;
+    self->skip_samples = 0;
+    self->stream_finalized = 0;
+    audiotools__MD5Init(&(self->md5));
+    self->perform_validation = memcmp(streaminfo->MD5, empty_md5, 16) != 0;
+
+    return index;
+}
+
+static PyObject*
+FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"desired_pcm_offset", "exact", NULL};
     long long seeked_offset;
+    int exact = 0;
 
     const struct SEEKTABLE *seektable = &(self->seektable);
     uint64_t pcm_frames_offset = 0;
@@ -723,7 +907,8 @@ FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args)
         return NULL;
     }
 
-    if (!PyArg_ParseTuple(args, "L", &seeked_offset))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "L|i", kwlist,
+                                     &seeked_offset, &exact))
         return NULL;
 
     if (seeked_offset < 0) {
@@ -732,6 +917,7 @@ FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args)
     }
 
     self->stream_finalized = 0;
+    self->skip_samples = 0;
 
     /*find latest seekpoint whose first sample is <= seeked_offset
       or 0 if there are no seekpoints in the seektable*/
@@ -746,16 +932,52 @@ FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args)
 
     /*position bitstream to indicated value in file*/
     if (!setjmp(*br_try(self->bitstream))) {
-        self->bitstream->setpos(self->bitstream, self->beginning_of_frames);
-        while (byte_offset) {
-            /*perform this in chunks in case seeked distance
-              is longer than a "long" taken by fseek*/
-            const uint64_t seek = MIN(byte_offset, LONG_MAX);
-            self->bitstream->seek(self->bitstream,
-                                  (long)seek,
-                                  BS_SEEK_CUR);
-            byte_offset -= seek;
+        const unsigned block_size = first_block_size(self);
+
+        seek_forward(self->bitstream, byte_offset);
+
+        /*if the seekpoint's frame doesn't start at seeked_offset,
+          scan forward from it to the frame containing seeked_offset*/
+        if ((pcm_frames_offset < (uint64_t)seeked_offset) &&
+            ((uint64_t)seeked_offset < self->streaminfo.total_samples)) {
+            struct frame_scanner scanner;
+            uint64_t frame_offset;
+            uint64_t scanned_offset = 0;
+            struct frame_header frame_header;
+            br_pos_t *seekpoint = self->bitstream->getpos(self->bitstream);
+
+            init_frame_scanner(&scanner,
+                               self->bitstream,
+                               &(self->streaminfo),
+                               pcm_frames_offset,
+                               block_size);
+
+            if (!setjmp(*br_try(self->bitstream))) {
+                while (next_scanned_frame(&scanner,
+                                          &frame_offset,
+                                          &frame_header)) {
+                    if (scanner.next_sample > (uint64_t)seeked_offset) {
+                        pcm_frames_offset = (scanner.next_sample -
+                                             frame_header.block_size);
+                        scanned_offset = frame_offset;
+                        break;
+                    }
+                }
+                br_etry(self->bitstream);
+            } else {
+                /*release the seekpoint before passing the error on*/
+                br_etry(self->bitstream);
+                seekpoint->del(seekpoint);
+                br_abort(self->bitstream);
+            }
+
+            /*then go back and position the stream at that frame
+              or at the seekpoint if no frame is found*/
+            self->bitstream->setpos(self->bitstream, seekpoint);
+            seekpoint->del(seekpoint);
+            seek_forward(self->bitstream, scanned_offset);
         }
+
         br_etry(self->bitstream);
     } else {
         br_etry(self->bitstream);
@@ -776,6 +998,16 @@ FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args)
         self->perform_validation = 0;
     }
 
+    if (exact &&
+        (pcm_frames_offset < (uint64_t)seeked_offset) &&
+        ((uint64_t)seeked_offset < self->streaminfo.total_samples)) {
+        /*read() drops samples before seeked_offset,
+          which span several frames if the scan didn't find
+          the one containing seeked_offset*/
+        self->skip_samples = (uint64_t)seeked_offset - pcm_frames_offset;
+        pcm_frames_offset = (uint64_t)seeked_offset;
+    }
+
     /*return actual PCM frames position in file*/
     return Py_BuildValue("K", pcm_frames_offset);
 }
@@ -1029,15 +1261,18 @@ read_frame_header(BitstreamReader *r,
 }
 
 static status_t
-read_utf8(BitstreamReader *r, unsigned *utf8)
+read_utf8(BitstreamReader *r, uint64_t *utf8)
 {
     const unsigned count = r->read_unary(r, 0);
     unsigned i;
-    *utf8 = r->read(r, 7 - count);
+    if (count > 7) {
+        return INVALID_UTF8;
+    }
+    *utf8 = (count < 7) ? r->read(r, 7 - count) : 0;
     if (count > 0) {
         for (i = 0; i < (count - 1); i++) {
             if (r->read(r, 2) == 2) {
-                *utf8 = (*utf8 << 8) | (r->read(r, 6));
+                *utf8 = (*utf8 << 6) | (r->read(r, 6));
             } else {
                 return INVALID_UTF8;
             }
@@ -1046,6 +1281,161 @@ read_utf8(BitstreamReader *r, unsigned *utf8)
     return OK;
 }
 
+#ifndef STANDALONE
+static unsigned
+read_available(BitstreamReader *r, uint8_t buffer[], unsigned count)
+{
+    br_pos_t *start = r->getpos(r);
+    volatile unsigned read = 0;
+
+    if (!setjmp(*br_try(r))) {
+        r->read_bytes(r, buffer, count);
+        br_etry(r);
+        read = count;
+    } else {
+        br_etry(r);
+
+        /*fewer than "count" bytes remain,
+          so go back and read them one at a time*/
+        r->setpos(r, start);
+        if (!setjmp(*br_try(r))) {
+            for (; read < count; read++) {
+                buffer[read] = r->read(r, 8);
+            }
+            br_etry(r);
+        } else {
+            br_etry(r);
+        }
+    }
+
+    start->del(start);
+    return read;
+}
+
+static void
+init_frame_scanner(struct frame_scanner *scanner,
+                   BitstreamReader *r,
+                   const struct STREAMINFO *streaminfo,
+                   uint64_t first_sample,
+                   unsigned block_size)
+{
+    scanner->r = r;
+    scanner->streaminfo = streaminfo;
+    scanner->buffer_size = 0;
+    scanner->position = 0;
+    scanner->buffer_offset = 0;
+    scanner->end_of_stream = 0;
+    scanner->next_sample = first_sample;
+    scanner->block_size = block_size;
+}
+
+static unsigned
+first_block_size(decoders_FlacDecoder *self)
+{
+    struct frame_header frame_header;
+    status_t status;
+
+    self->bitstream->setpos(self->bitstream, self->beginning_of_frames);
+    status = read_frame_header(self->bitstream,
+                               &(self->streaminfo),
+                               &frame_header);
+    self->bitstream->setpos(self->bitstream, self->beginning_of_frames);
+
+    return (status == OK) ? frame_header.block_size : 0;
+}
+
+static void
+seek_forward(BitstreamReader *r, uint64_t offset)
+{
+    while (offset) {
+        /*perform this in chunks in case seeked distance
+          is longer than a "long" taken by fseek*/
+        const uint64_t seek = MIN(offset, LONG_MAX);
+        r->seek(r, (long)seek, BS_SEEK_CUR);
+        offset -= seek;
+    }
+}
+
+static int
+next_scanned_frame(struct frame_scanner *scanner,
+                   uint64_t *byte_offset,
+                   struct frame_header *frame_header)
+{
+    uint8_t *buffer = scanner->buffer;
+
+    for (;;) {
+        unsigned read;
+
+        /*look for sync codes followed by a valid frame header
+          whose position continues on from the previous frame,
+          which rules out sync codes occurring within subframes*/
+        while ((scanner->position + 1) < scanner->buffer_size) {
+            const unsigned i = scanner->position;
+
+            if ((!scanner->end_of_stream) &&
+                ((i + MAX_FRAME_HEADER_SIZE) > scanner->buffer_size)) {
+                /*header may be incomplete, so wait for more data*/
+                break;
+            }
+
+            scanner->position++;
+
+            if ((buffer[i] == 0xFF) && ((buffer[i + 1] & 0xFE) == 0xF8)) {
+                BitstreamReader *header_reader =
+                    br_open_buffer(buffer + i,
+                                   MIN(scanner->buffer_size - i,
+                                       MAX_FRAME_HEADER_SIZE),
+                                   BS_BIG_ENDIAN);
+                const status_t status = read_frame_header(header_reader,
+                                                          scanner->streaminfo,
+                                                          frame_header);
+                uint64_t sample_number;
+
+                header_reader->close(header_reader);
+
+                if (status != OK) {
+                    continue;
+                } else if (frame_header->blocking_strategy) {
+                    sample_number = frame_header->frame_number;
+                } else if (scanner->block_size) {
+                    sample_number = (frame_header->frame_number *
+                                     scanner->block_size);
+                } else {
+                    /*the frame's own block size is correct
+                      for every frame but a shorter last one*/
+                    sample_number = (frame_header->frame_number *
+                                     frame_header->block_size);
+                }
+
+                if (sample_number == scanner->next_sample) {
+                    scanner->next_sample += frame_header->block_size;
+                    *byte_offset = scanner->buffer_offset + i;
+                    return 1;
+                }
+            }
+        }
+
+        if (scanner->end_of_stream) {
+            return 0;
+        }
+
+        /*keep any unscanned bytes and append more data to them*/
+        memmove(buffer,
+                buffer + scanner->position,
+                scanner->buffer_size - scanner->position);
+        scanner->buffer_offset += scanner->position;
+        scanner->buffer_size -= scanner->position;
+        scanner->position = 0;
+
+        read = read_available(scanner->r,
+                              buffer + scanner->buffer_size,
+                              SCAN_CHUNK_SIZE);
+        scanner->end_of_stream = read < SCAN_CHUNK_SIZE;
+        scanner->buffer_size += read;
+    }
+}
+#endif
+
 static decode_f
 get_decoder(channel_assignment_t channel_assignment)
 {
@@ -1339,31 +1729,36 @@ read_FIXED_subframe(BitstreamReader *r,
         }
 
         /*residuals*/
+        STATS_START(residual_timer);
         if ((status = read_residual_block(r,
                                           block_size,
                                           predictor_order,
                                           residuals)) != OK) {
             return status;
         }
+        STATS_STOP(residual_timer,
+                   STATS_FLAC_DECODE_RESIDUALS,
+                   block_size - predictor_order);
 
+        STATS_START(fixed_timer);
         switch (predictor_order) {
         case 0:
             for (i = 0; i < block_size; i++) {
                 channel_data[i] = residuals[i];
             }
-            return OK;
+            break;
         case 1:
             for (i = 1; i < block_size; i++) {
                 channel_data[i] = channel_data[i - 1] + residuals[i - 1];
             }
-            return OK;
+            break;
         case 2:
             for (i = 2; i < block_size; i++) {
                 channel_data[i] = (2 * channel_data[i - 1]) -
                                   channel_data[i - 2] +
                                   residuals[i - 2];
             }
-            return OK;
+            break;
         case 3:
             for (i = 3; i < block_size; i++) {
                 channel_data[i] = (3 * channel_data[i - 1]) -
@@ -1371,7 +1766,7 @@ read_FIXED_subframe(BitstreamReader *r,
                                   channel_data[i - 3] +
                                   residuals[i - 3];
             }
-            return OK;
+            break;
         case 4:
             for (i = 4; i < block_size; i++) {
                 channel_data[i] = (4 * channel_data[i - 1]) -
@@ -1380,10 +1775,13 @@ read_FIXED_subframe(BitstreamReader *r,
                                   channel_data[i - 4] +
                                   residuals[i - 4];
             }
-            return OK;
+            break;
         default:
             return INVALID_FIXED_ORDER;
         }
+        STATS_STOP(fixed_timer, STATS_FLAC_DECODE_FIXED, block_size);
+
+        return OK;
     }
 }
 
@@ -1420,13 +1818,18 @@ read_LPC_subframe(BitstreamReader *r,
             coefficient[i] = r->read_signed(r, precision);
         }
 
+        STATS_START(residual_timer);
         if ((status = read_residual_block(r,
                                           block_size,
                                           predictor_order,
                                           residuals)) != OK) {
             return status;
         }
+        STATS_STOP(residual_timer,
+                   STATS_FLAC_DECODE_RESIDUALS,
+                   block_size - predictor_order);
 
+        STATS_START(lpc_timer);
         for (i = predictor_order; i < block_size; i++) {
             register int64_t sum = 0;
             unsigned j;
@@ -1437,6 +1840,7 @@ read_LPC_subframe(BitstreamReader *r,
             sum >>= shift;
             channel_data[i] = (int)sum + residuals[i - predictor_order];
         }
+        STATS_STOP(lpc_timer, STATS_FLAC_DECODE_LPC, block_size);
 
         return OK;
     }
@@ -1711,15 +2115,12 @@ update_md5sum(audiotools__MD5Context *md5sum,
               unsigned bits_per_sample,
               unsigned pcm_frames)
 {
-    const unsigned total_samples = pcm_frames * channels;
-    const unsigned buffer_size = total_samples * (bits_per_sample / 8);
-    unsigned char buffer[buffer_size];
-
-    int_to_pcm_converter(bits_per_sample, 0, 1)(total_samples,
-                                                pcm_data,
-                                                buffer);
-
-    audiotools__MD5Update(md5sum, buffer, buffer_size);
+    audiotools__MD5UpdateSamples(md5sum,
+                                 pcm_data,
+                                 pcm_frames * channels,
+                                 bits_per_sample,
+                                 0,
+                                 1);
 }
 
 static int
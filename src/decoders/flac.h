@@ -56,6 +56,7 @@ typedef struct {
     struct SEEKTABLE seektable;
     unsigned channel_mask;
     uint64_t remaining_samples;
+    uint64_t skip_samples;  /*samples to drop from the next frames read*/
     int closed;
 
     audiotools__MD5Context md5;
@@ -87,8 +88,22 @@ FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args);
 static PyObject*
 FlacDecoder_frame_size(decoders_FlacDecoder* self, PyObject *args);
 
+/*returns a list of (byte_offset, sample_number, block_size) tuples
+  for each frame in the stream, where byte_offset is relative
+  to the start of the first frame, as in SEEKTABLE
+
+  frames are located by their sync codes and headers alone,
+  without decoding subframes, and the stream is rewound afterward*/
+static PyObject*
+FlacDecoder_index(decoders_FlacDecoder* self, PyObject *args);
+
+/*positions the stream at the frame containing desired_pcm_offset
+  and returns that frame's first sample
+
+  if exact is true, the next read() starts at desired_pcm_offset itself
+  which is returned instead*/
 static PyObject*
-FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args);
+FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args, PyObject *kwds);
 
 static PyObject*
 FlacDecoder_close(decoders_FlacDecoder* self, PyObject *args);
@@ -116,9 +131,13 @@ PyMethodDef FlacDecoder_methods[] = {
     {"read", (PyCFunction)FlacDecoder_read,
      METH_VARARGS, "read(pcm_frame_count) -> FrameList"},
     {"seek", (PyCFunction)FlacDecoder_seek,
-     METH_VARARGS, "seek(desired_pcm_offset) -> actual_pcm_offset"},
+     METH_VARARGS | METH_KEYWORDS,
+     "seek(desired_pcm_offset, exact=False) -> actual_pcm_offset"},
     {"frame_size", (PyCFunction)FlacDecoder_frame_size,
      METH_NOARGS, "frame_size() -> (byte_length, pcm_frame_count)"},
+    {"index", (PyCFunction)FlacDecoder_index,
+     METH_NOARGS,
+     "index() -> [(byte_offset, sample_number, pcm_frame_count), ...]"},
     {"close", (PyCFunction)FlacDecoder_close,
      METH_NOARGS, "close() -> None"},
     {"__enter__", (PyCFunction)FlacDecoder_enter,
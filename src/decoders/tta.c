@@ -1,9 +1,12 @@
 #include "tta.h"
 #include "../common/tta_crc.h"
+#include "../common/tta_filter.h"
 #include "../framelist.h"
+#include "../common/stats.h"
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -59,6 +62,20 @@ struct prediction_params {
     int previous_sample;
 };
 
+/*a single TTA frame to be decoded on its own thread*/
+struct decode_job {
+    BitstreamReader *frame;
+    unsigned channels;
+    unsigned bits_per_sample;
+    unsigned block_size;
+    int *samples;
+    status_t status;
+
+    /*the thread running this job, if started*/
+    pthread_t worker;
+    int started;
+};
+
 /*******************************
  * private function signatures *
  *******************************/
@@ -101,6 +118,16 @@ read_tta_frame(BitstreamReader *frame,
                unsigned block_size,
                int samples[]);
 
+#ifndef STANDALONE
+static void*
+decode_frame_job(struct decode_job *job);
+
+/*runs all the given jobs to completion,
+  the first on the current thread and the rest on new threads*/
+static void
+run_decode_jobs(unsigned count, struct decode_job jobs[]);
+#endif
+
 static void
 init_residual_params(struct residual_params *params);
 
@@ -137,6 +164,12 @@ decorrelate_channels(unsigned channel_count,
 #ifndef STANDALONE
 static PyObject*
 tta_exception(status_t error);
+
+/*decodes up to "threads" TTA frames concurrently
+  using the seektable to split them from the stream
+  and returns them as a single FrameList*/
+static PyObject*
+read_tta_frames_threaded(decoders_TTADecoder *self);
 #endif
 
 static const char*
@@ -167,17 +200,26 @@ TTADecoder_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
 int
 TTADecoder_init(decoders_TTADecoder *self, PyObject *args, PyObject *kwds) {
     PyObject *file;
+    int threads = 1;
     status_t status;
+    static char *kwlist[] = {"file", "threads", NULL};
 
     self->seektable = NULL;
     self->bitstream = NULL;
     self->audiotools_pcm = NULL;
     self->frames_start = NULL;
 
-    if (!PyArg_ParseTuple(args, "O", &file)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|i", kwlist,
+                                     &file, &threads)) {
+        return -1;
+    } else if ((threads < 1) || (threads > TTA_MAX_THREADS)) {
+        PyErr_Format(PyExc_ValueError,
+                     "threads must be between 1 and %d",
+                     TTA_MAX_THREADS);
         return -1;
     } else {
         Py_INCREF(file);
+        self->threads = (unsigned)threads;
     }
 
     self->bitstream = br_open_external(file,
@@ -278,21 +320,31 @@ TTADecoder_read(decoders_TTADecoder* self, PyObject *args)
         return empty_FrameList(self->audiotools_pcm,
                                self->header.channels,
                                self->header.bits_per_sample);
+    } else if (self->threads > 1) {
+        return read_tta_frames_threaded(self);
     } else {
         const unsigned block_size =
             tta_block_size(self->current_tta_frame, &self->header);
+        STATS_START(framelist_timer);
         pcm_FrameList *framelist =
             new_FrameList(self->audiotools_pcm,
                           self->header.channels,
                           self->header.bits_per_sample,
                           block_size);
         status_t status;
+        STATS_STOP(framelist_timer,
+                   STATS_TTA_DECODE_FRAMELIST,
+                   block_size * self->header.channels);
+        STATS_START(frame_timer);
 
         if ((status = read_tta_frame(self->bitstream,
                                      self->header.channels,
                                      self->header.bits_per_sample,
                                      block_size,
                                      framelist->samples)) == OK) {
+            STATS_STOP(frame_timer,
+                       STATS_TTA_DECODE_FRAME,
+                       block_size * self->header.channels);
             self->current_tta_frame += 1;
             return (PyObject*)framelist;
         } else {
@@ -568,6 +620,47 @@ read_tta_frame(BitstreamReader *frame,
     return checksum.is_valid ? OK : CRC_MISMATCH;
 }
 
+#ifndef STANDALONE
+static void*
+decode_frame_job(struct decode_job *job)
+{
+    STATS_START(frame_timer);
+    job->status = read_tta_frame(job->frame,
+                                 job->channels,
+                                 job->bits_per_sample,
+                                 job->block_size,
+                                 job->samples);
+    STATS_STOP(frame_timer,
+               STATS_TTA_DECODE_FRAME,
+               job->block_size * job->channels);
+    return NULL;
+}
+
+static void
+run_decode_jobs(unsigned count, struct decode_job jobs[])
+{
+    unsigned i;
+
+    for (i = 1; i < count; i++) {
+        jobs[i].started = !pthread_create(&jobs[i].worker,
+                                          NULL,
+                                          (void*(*)(void*))decode_frame_job,
+                                          &jobs[i]);
+    }
+
+    decode_frame_job(&jobs[0]);
+
+    for (i = 1; i < count; i++) {
+        if (jobs[i].started) {
+            pthread_join(jobs[i].worker, NULL);
+        } else {
+            /*if a thread can't be started, run its job here instead*/
+            decode_frame_job(&jobs[i]);
+        }
+    }
+}
+#endif
+
 static void
 init_residual_params(struct residual_params *params)
 {
@@ -658,54 +751,18 @@ init_filter_params(unsigned bits_per_sample,
     params->dl[7] = 0;
 }
 
-static inline int
-sign(int x) {
-    if (x > 0) {
-        return 1;
-    } else if (x < 0) {
-        return -1;
-    } else {
-        return 0;
-    }
-}
-
 static int
 run_filter(struct filter_params *params, int residual)
 {
-    const int previous_sign = sign(params->previous_residual);
-    int32_t sum = params->round;
-    int filtered = residual;
+    const int32_t sum =
+        params->round + tta_filter_predict(params->qm,
+                                           params->dx,
+                                           params->dl,
+                                           tta_sign(params->previous_residual));
+    const int filtered = residual + (sum >> params->shift);
 
     params->previous_residual = residual;
-
-    sum += params->dl[0] * (params->qm[0] += previous_sign * params->dx[0]);
-    sum += params->dl[1] * (params->qm[1] += previous_sign * params->dx[1]);
-    sum += params->dl[2] * (params->qm[2] += previous_sign * params->dx[2]);
-    sum += params->dl[3] * (params->qm[3] += previous_sign * params->dx[3]);
-    sum += params->dl[4] * (params->qm[4] += previous_sign * params->dx[4]);
-    sum += params->dl[5] * (params->qm[5] += previous_sign * params->dx[5]);
-    sum += params->dl[6] * (params->qm[6] += previous_sign * params->dx[6]);
-    sum += params->dl[7] * (params->qm[7] += previous_sign * params->dx[7]);
-
-    filtered += (sum >> params->shift);
-
-    params->dx[0] = params->dx[1];
-    params->dx[1] = params->dx[2];
-    params->dx[2] = params->dx[3];
-    params->dx[3] = params->dx[4];
-    params->dx[4] = params->dl[4] >= 0 ? 1 : -1;
-    params->dx[5] = params->dl[5] >= 0 ? 2 : -2;
-    params->dx[6] = params->dl[6] >= 0 ? 2 : -2;
-    params->dx[7] = params->dl[7] >= 0 ? 4 : -4;
-    params->dl[0] = params->dl[1];
-    params->dl[1] = params->dl[2];
-    params->dl[2] = params->dl[3];
-    params->dl[3] = params->dl[4];
-    params->dl[4] =
-        -(params->dl[5]) + (-(params->dl[6]) + (filtered - params->dl[7]));
-    params->dl[5] = -(params->dl[6]) + (filtered - params->dl[7]);
-    params->dl[6] = filtered - params->dl[7];
-    params->dl[7] = filtered;
+    tta_filter_update(params->dx, params->dl, filtered);
 
     return filtered;
 }
@@ -757,6 +814,91 @@ decorrelate_channels(unsigned channel_count,
 }
 
 #ifndef STANDALONE
+static PyObject*
+read_tta_frames_threaded(decoders_TTADecoder *self)
+{
+    const unsigned remaining_tta_frames =
+        self->header.total_tta_frames - self->current_tta_frame;
+    const unsigned count = remaining_tta_frames < self->threads ?
+        remaining_tta_frames : self->threads;
+    struct decode_job *jobs;
+    unsigned total_pcm_frames = 0;
+    pcm_FrameList *framelist;
+    status_t status = OK;
+    unsigned i;
+
+    if ((jobs = malloc(count * sizeof(struct decode_job))) == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    for (i = 0; i < count; i++) {
+        jobs[i].frame = NULL;
+        jobs[i].channels = self->header.channels;
+        jobs[i].bits_per_sample = self->header.bits_per_sample;
+        jobs[i].block_size =
+            tta_block_size(self->current_tta_frame + i, &self->header);
+        total_pcm_frames += jobs[i].block_size;
+    }
+
+    /*split each frame's data from the stream
+      according to the sizes in the seektable*/
+    if (!setjmp(*br_try(self->bitstream))) {
+        for (i = 0; i < count; i++) {
+            jobs[i].frame = self->bitstream->substream(
+                self->bitstream,
+                self->seektable[self->current_tta_frame + i]);
+        }
+        br_etry(self->bitstream);
+    } else {
+        br_etry(self->bitstream);
+        for (i = 0; i < count; i++) {
+            if (jobs[i].frame) {
+                jobs[i].frame->close(jobs[i].frame);
+            }
+        }
+        free(jobs);
+        PyErr_SetString(PyExc_IOError, "I/O error reading stream");
+        return NULL;
+    }
+
+    /*decode all frames directly into a single FrameList*/
+    STATS_START(framelist_timer);
+    framelist = new_FrameList(self->audiotools_pcm,
+                              self->header.channels,
+                              self->header.bits_per_sample,
+                              total_pcm_frames);
+    STATS_STOP(framelist_timer,
+               STATS_TTA_DECODE_FRAMELIST,
+               total_pcm_frames * self->header.channels);
+    total_pcm_frames = 0;
+    for (i = 0; i < count; i++) {
+        jobs[i].samples =
+            framelist->samples + (total_pcm_frames * self->header.channels);
+        total_pcm_frames += jobs[i].block_size;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_decode_jobs(count, jobs);
+    Py_END_ALLOW_THREADS
+
+    for (i = 0; i < count; i++) {
+        if ((status == OK) && (jobs[i].status != OK)) {
+            status = jobs[i].status;
+        }
+        jobs[i].frame->close(jobs[i].frame);
+    }
+    free(jobs);
+
+    if (status == OK) {
+        self->current_tta_frame += count;
+        return (PyObject*)framelist;
+    } else {
+        Py_DECREF((PyObject*)framelist);
+        PyErr_SetString(tta_exception(status), tta_strerror(status));
+        return NULL;
+    }
+}
+
 static PyObject*
 tta_exception(status_t error)
 {
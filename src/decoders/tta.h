@@ -24,6 +24,9 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+/*the most TTA frames decoded concurrently*/
+#define TTA_MAX_THREADS 64
+
 struct tta_header {
     unsigned channels;
     unsigned bits_per_sample;
@@ -41,6 +44,9 @@ typedef struct {
     unsigned current_tta_frame;
     unsigned* seektable;
 
+    /*TTA frames to decode concurrently per read*/
+    unsigned threads;
+
     int closed;
 
     BitstreamReader* bitstream;
@@ -36,6 +36,16 @@ update_md5sum(audiotools__MD5Context *md5sum,
               unsigned bits_per_sample,
               unsigned pcm_frames);
 
+/*unpacks up to "pcm_frames" PCM frames to "samples"
+  with the GIL released, updating or verifying the running MD5 sum
+
+  returns the number of PCM frames read,
+  or -1 with an exception set if the MD5 sum doesn't match*/
+static int
+unpack_samples(decoders_WavPackDecoder *self,
+               int *samples,
+               unsigned pcm_frames);
+
 int
 WavPackDecoder_init(decoders_WavPackDecoder *self,
                     PyObject *args,
@@ -43,6 +53,8 @@ WavPackDecoder_init(decoders_WavPackDecoder *self,
     char error[80];
     char *filename = NULL;
     self->audiotools_pcm = NULL;
+    self->read_into_framelist = NULL;
+    self->read_into_capacity = 0;
 
     audiotools__MD5Init(&(self->md5));
     self->verifying_md5_sum = 1;
@@ -72,6 +84,7 @@ WavPackDecoder_init(decoders_WavPackDecoder *self,
 void
 WavPackDecoder_dealloc(decoders_WavPackDecoder *self) {
     Py_XDECREF(self->audiotools_pcm);
+    Py_XDECREF(self->read_into_framelist);
     if (self->context) {
         WavpackCloseFile(self->context);
     }
@@ -149,7 +162,7 @@ WavPackDecoder_read(decoders_WavPackDecoder* self, PyObject *args)
     pcm_FrameList *framelist;
     const unsigned channel_count = WavpackGetNumChannels(self->context);
     const unsigned bits_per_sample = WavpackGetBitsPerSample(self->context);
-    uint32_t frames_read;
+    int frames_read;
 
     if (self->closed) {
         PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
@@ -160,9 +173,8 @@ WavPackDecoder_read(decoders_WavPackDecoder* self, PyObject *args)
         return NULL;
     }
 
-    /*clamp number of PCM frames to a reasonable range
-      regardless of how many are requested*/
-    pcm_frames = MIN(MAX(pcm_frames, 1), 48000);
+    /*always read at least 1 PCM frame*/
+    pcm_frames = MAX(pcm_frames, 1);
 
     /*build FrameList to dump data into*/
     framelist = new_FrameList(self->audiotools_pcm,
@@ -171,21 +183,129 @@ WavPackDecoder_read(decoders_WavPackDecoder* self, PyObject *args)
                               pcm_frames);
 
     /*perform actual read*/
-    frames_read = WavpackUnpackSamples(self->context,
-                                       framelist->samples,
-                                       pcm_frames);
+    if ((frames_read = unpack_samples(self,
+                                      framelist->samples,
+                                      pcm_frames)) < 0) {
+        Py_DECREF((PyObject*)framelist);
+        return NULL;
+    }
 
     /*reduce FrameList's size accordingly*/
     framelist->frames = frames_read;
 
+    return (PyObject*)framelist;
+}
+
+PyObject*
+WavPackDecoder_read_into(decoders_WavPackDecoder* self, PyObject *args)
+{
+    PyObject *framelist_obj;
+    pcm_FrameList *framelist;
+    PyObject *framelist_type;
+    int pcm_frames;
+    int frames_read;
+    int is_framelist;
+    unsigned capacity;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "Oi", &framelist_obj, &pcm_frames)) {
+        return NULL;
+    }
+
+    if ((framelist_type = PyObject_GetAttrString(self->audiotools_pcm,
+                                                 "FrameList")) == NULL) {
+        return NULL;
+    }
+    is_framelist = PyObject_IsInstance(framelist_obj, framelist_type);
+    Py_DECREF(framelist_type);
+    if (is_framelist == -1) {
+        return NULL;
+    } else if (!is_framelist) {
+        PyErr_SetString(PyExc_TypeError, "not a FrameList object");
+        return NULL;
+    }
+
+    framelist = (pcm_FrameList*)framelist_obj;
+
+    if (framelist->channels != WavpackGetNumChannels(self->context)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "FrameList channel count mismatch");
+        return NULL;
+    }
+    if (framelist->bits_per_sample !=
+        WavpackGetBitsPerSample(self->context)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "FrameList bits-per-sample mismatch");
+        return NULL;
+    }
+
+    /*always read at least 1 PCM frame*/
+    pcm_frames = MAX(pcm_frames, 1);
+
+    /*a FrameList filled by an earlier read_into()
+      may have a larger sample buffer than its frame count*/
+    if (framelist_obj == self->read_into_framelist) {
+        capacity = self->read_into_capacity;
+    } else {
+        capacity = framelist->frames;
+    }
+
+    /*grow FrameList's sample buffer only if it's too small*/
+    if ((unsigned)pcm_frames > capacity) {
+        int *samples = realloc(framelist->samples,
+                               sizeof(int) *
+                               (size_t)pcm_frames *
+                               framelist->channels);
+        if (samples == NULL) {
+            return PyErr_NoMemory();
+        }
+        framelist->samples = samples;
+        capacity = (unsigned)pcm_frames;
+    }
+
+    Py_INCREF(framelist_obj);
+    Py_XDECREF(self->read_into_framelist);
+    self->read_into_framelist = framelist_obj;
+    self->read_into_capacity = capacity;
+
+    /*perform actual read*/
+    if ((frames_read = unpack_samples(self,
+                                      framelist->samples,
+                                      pcm_frames)) < 0) {
+        framelist->frames = 0;
+        return NULL;
+    }
+
+    /*then reduce FrameList's size accordingly*/
+    framelist->frames = frames_read;
+
+    return Py_BuildValue("i", frames_read);
+}
+
+static int
+unpack_samples(decoders_WavPackDecoder *self,
+               int *samples,
+               unsigned pcm_frames)
+{
+    uint32_t frames_read;
+    int md5_mismatch = 0;
+
+    /*unpacking and MD5 summing touch no Python objects*/
+    Py_BEGIN_ALLOW_THREADS
+    frames_read = WavpackUnpackSamples(self->context, samples, pcm_frames);
+
     if (self->verifying_md5_sum) {
         if (frames_read) {
             /*compute running MD5 sum*/
             update_md5sum(&(self->md5),
-                          framelist->samples,
-                          framelist->channels,
-                          framelist->bits_per_sample,
-                          framelist->frames);
+                          samples,
+                          WavpackGetNumChannels(self->context),
+                          WavpackGetBitsPerSample(self->context),
+                          frames_read);
         } else {
             /*verify final MD5 sum*/
             uint8_t stored_md5_sum[16];
@@ -196,17 +316,18 @@ WavPackDecoder_read(decoders_WavPackDecoder* self, PyObject *args)
             if (WavpackGetMD5Sum(self->context, stored_md5_sum)) {
                 audiotools__MD5Final(stream_md5_sum, &(self->md5));
 
-                if (memcmp(stored_md5_sum, stream_md5_sum, 16)) {
-                    Py_DECREF((PyObject*)framelist);
-                    PyErr_SetString(PyExc_IOError,
-                                    "MD5 mismatch at end of stream");
-                    return NULL;
-                }
+                md5_mismatch = memcmp(stored_md5_sum, stream_md5_sum, 16);
             }
         }
     }
+    Py_END_ALLOW_THREADS
 
-    return (PyObject*)framelist;
+    if (md5_mismatch) {
+        PyErr_SetString(PyExc_IOError, "MD5 mismatch at end of stream");
+        return -1;
+    } else {
+        return (int)frames_read;
+    }
 }
 
 
@@ -257,14 +378,10 @@ update_md5sum(audiotools__MD5Context *md5sum,
               unsigned bits_per_sample,
               unsigned pcm_frames)
 {
-    const unsigned total_samples = pcm_frames * channels;
-    const unsigned buffer_size = total_samples * (bits_per_sample / 8);
-    unsigned char buffer[buffer_size];
-    int_to_pcm_converter(bits_per_sample,
-                         0,
-                         (bits_per_sample > 8))(total_samples,
-                                                pcm_data,
-                                                buffer);
-
-    audiotools__MD5Update(md5sum, buffer, buffer_size);
+    audiotools__MD5UpdateSamples(md5sum,
+                                 pcm_data,
+                                 pcm_frames * channels,
+                                 bits_per_sample,
+                                 0,
+                                 (bits_per_sample > 8));
 }
@@ -36,6 +36,12 @@ typedef struct {
 
     int closed;
 
+    /*the FrameList last passed to read_into()
+      and how many PCM frames its sample buffer holds,
+      which may be more than its current frame count*/
+    PyObject* read_into_framelist;
+    unsigned read_into_capacity;
+
 } decoders_WavPackDecoder;
 
 int
@@ -72,6 +78,14 @@ WavPackDecoder_close(decoders_WavPackDecoder* self, PyObject *args);
 PyObject*
 WavPackDecoder_read(decoders_WavPackDecoder* self, PyObject *args);
 
+/*reads up to "pcm_frames" PCM frames into an existing FrameList
+  whose channels and bits-per-sample match the stream's,
+  growing its buffer only as needed and resizing it to the frames read
+
+  returns the number of PCM frames read*/
+PyObject*
+WavPackDecoder_read_into(decoders_WavPackDecoder* self, PyObject *args);
+
 PyObject*
 WavPackDecoder_seek(decoders_WavPackDecoder* self, PyObject *args);
 
@@ -84,6 +98,8 @@ WavPackDecoder_exit(decoders_WavPackDecoder* self, PyObject *args);
 PyMethodDef WavPackDecoder_methods[] = {
     {"read", (PyCFunction)WavPackDecoder_read,
      METH_VARARGS, "read(pcm_frame_count) -> FrameList"},
+    {"read_into", (PyCFunction)WavPackDecoder_read_into,
+     METH_VARARGS, "read_into(framelist, pcm_frame_count) -> frames read"},
     {"seek", (PyCFunction)WavPackDecoder_seek,
      METH_VARARGS, "seek(desired_pcm_offset) -> actual_pcm_offset"},
     {"close", (PyCFunction)WavPackDecoder_close,
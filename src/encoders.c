@@ -1,6 +1,8 @@
 #include <Python.h>
 #include "mod_defs.h"
 #include "bitstream.h"
+#include "common/stats.h"
+#include "common/md5.h"
 #include "encoders.h"
 
 /********************************************************
@@ -30,5 +32,9 @@ MOD_INIT(encoders)
 
     MOD_DEF(m, "encoders", "low-level audio format encoders",  module_methods)
 
+    stats_init();
+    audiotools__MD5InitDispatch();
+    flacenc_init_dispatch();
+
     return MOD_SUCCESS_VAL(m);
 }
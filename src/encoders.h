@@ -30,6 +30,9 @@ typedef int Py_ssize_t;
 PyObject*
 encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds);
 
+void
+flacenc_init_dispatch(void);
+
 PyObject*
 encoders_encode_alac(PyObject *dummy, PyObject *args, PyObject *keywds);
 
@@ -91,5 +94,6 @@ PyMethodDef module_methods[] = {
     {"encode_opus", (PyCFunction)encoders_encode_opus,
     METH_VARARGS | METH_KEYWORDS, "Encode Opus file from PCMReader"},
 #endif
+    STATS_METHODS,
     {NULL}
 };
@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <math.h>
 #include "../common/m4a_atoms.h"
+#include "../common/stats.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -167,7 +168,11 @@ encode_alac(BitstreamWriter *output,
 {
     time_t timestamp = time(NULL);
 
-    if (total_pcm_frames) {
+    /*if output isn't seekable, the mdat atom's size can't be rewritten
+      after encoding and frames must go to temporary space instead*/
+    const int seekable = bw_seekable(output);
+
+    if (seekable && total_pcm_frames) {
         /*output temporary metadata atoms based on dummy frame sizes list*/
         bw_pos_t *start = output->getpos(output);
 
@@ -249,6 +254,49 @@ encode_alac(BitstreamWriter *output,
 #endif
 
         /*return actual frame sizes list*/
+        return actual_sizes;
+    } else if (seekable) {
+        /*total PCM frames isn't known in advance,
+          so write the mdat atom directly after the ftyp atom
+          followed by the moov atom built from actual frame sizes*/
+        const unsigned ftyp_size = write_ftyp(output);
+        struct alac_frame_size *size;
+
+        struct alac_frame_size *actual_sizes =
+            encode_mdat(output,
+                        pcmreader,
+                        block_size,
+                        initial_history,
+                        history_multiplier,
+                        maximum_k);
+
+        if (!actual_sizes) {
+            return NULL;
+        }
+
+        /*encode_mdat() returns to its header to rewrite the mdat size
+          so move past the end of the mdat atom before writing moov*/
+        output->seek(output, 0, BS_SEEK_END);
+
+        /*determine total PCM frames written from frame sizes list*/
+        for (size = actual_sizes; size; size = size->next) {
+            total_pcm_frames += size->pcm_frames_size;
+        }
+
+        write_moov(output,
+                   timestamp,
+                   pcmreader->sample_rate,
+                   pcmreader->channels,
+                   pcmreader->bits_per_sample,
+                   total_pcm_frames,
+                   block_size,
+                   history_multiplier,
+                   initial_history,
+                   maximum_k,
+                   actual_sizes,
+                   ftyp_size + 8,
+                   encoder_version);
+
         return actual_sizes;
     } else {
         FILE *tempfile = tmpfile();
@@ -257,7 +305,7 @@ encode_alac(BitstreamWriter *output,
             bw_open_accumulator(BS_BIG_ENDIAN);
         unsigned metadata_size;
         struct alac_frame_size *size;
-        unsigned total_pcm_frames = 0;
+        unsigned encoded_pcm_frames = 0;
         uint8_t buffer[BUFFER_SIZE];
         size_t bytes_read;
 
@@ -282,8 +330,19 @@ encode_alac(BitstreamWriter *output,
 
         /*determine total PCM frames written from frame sizes list*/
         for (size = actual_sizes; size; size = size->next) {
-            total_pcm_frames += size->pcm_frames_size;
+            encoded_pcm_frames += size->pcm_frames_size;
+        }
+
+#ifndef STANDALONE
+        if (total_pcm_frames && (encoded_pcm_frames != total_pcm_frames)) {
+            /*total PCM frames mismatch after encoding*/
+            free_alac_frame_sizes(actual_sizes);
+            metadata_size_writer->close(metadata_size_writer);
+            fclose(tempfile);
+            PyErr_SetString(PyExc_IOError, "total PCM frames mismatch");
+            return NULL;
         }
+#endif
 
         /*get metadata size in order to determine chunk offsets*/
         metadata_size = write_metadata(
@@ -292,7 +351,7 @@ encode_alac(BitstreamWriter *output,
             pcmreader->sample_rate,
             pcmreader->channels,
             pcmreader->bits_per_sample,
-            total_pcm_frames,
+            encoded_pcm_frames,
             block_size,
             history_multiplier,
             initial_history,
@@ -311,7 +370,7 @@ encode_alac(BitstreamWriter *output,
             pcmreader->sample_rate,
             pcmreader->channels,
             pcmreader->bits_per_sample,
-            total_pcm_frames,
+            encoded_pcm_frames,
             block_size,
             history_multiplier,
             initial_history,
@@ -379,17 +438,32 @@ encode_mdat(BitstreamWriter *output,
     output->write_bytes(output, (uint8_t*)"mdat", 4);
 
     /*write frames from pcm_reader until empty*/
-    while ((pcm_frames_read = pcmreader->read(pcmreader,
-                                              encoder.options.block_size,
-                                              samples)) > 0) {
-        frame_byte_size = 0;
-
-        /*perform encoding*/
-        write_frameset(output,
-                       &encoder,
-                       pcm_frames_read,
-                       pcmreader->channels,
-                       samples);
+    for (;;) {
+        STATS_START(read_timer);
+        pcm_frames_read = pcmreader->read(pcmreader,
+                                          encoder.options.block_size,
+                                          samples);
+        STATS_STOP(read_timer,
+                   STATS_ALAC_ENCODE_READ,
+                   pcm_frames_read * pcmreader->channels);
+        if (pcm_frames_read == 0) {
+            break;
+        } else {
+            STATS_START(frame_timer);
+
+            frame_byte_size = 0;
+
+            /*perform encoding*/
+            write_frameset(output,
+                           &encoder,
+                           pcm_frames_read,
+                           pcmreader->channels,
+                           samples);
+
+            STATS_STOP(frame_timer,
+                       STATS_ALAC_ENCODE_FRAME,
+                       pcm_frames_read * pcmreader->channels);
+        }
 
         /*log each frameset's size in bytes and size in samples*/
         frame_sizes = push_frame_size(frame_sizes,
@@ -993,6 +1067,7 @@ compute_coefficients(struct alac_context* encoder,
 {
     double windowed_signal[sample_count];
     double autocorrelated[MAX_QLP_COEFFS + 1];
+    STATS_START(lpc_timer);
 
     /*window the input samples*/
     window_signal(sample_count,
@@ -1042,6 +1117,9 @@ compute_coefficients(struct alac_context* encoder,
                             qlp_coefficients8,
                             residual_values8);
 
+        /*residual encoding is counted separately*/
+        STATS_STOP(lpc_timer, STATS_ALAC_ENCODE_LPC, sample_count);
+
         /*encode residual block for QLP coefficients at order 4*/
         residual_block4->reset(residual_block4);
         encode_residuals(encoder,
@@ -1318,6 +1396,7 @@ encode_residuals(struct alac_context* encoder,
     const unsigned maximum_k = encoder->options.maximum_k;
     unsigned k;
     unsigned zeroes;
+    STATS_START(residual_timer);
 
     while (i < residual_count) {
         if (residuals[i] >= 0) {
@@ -1364,6 +1443,8 @@ encode_residuals(struct alac_context* encoder,
             history = 0xFFFF;
         }
     }
+
+    STATS_STOP(residual_timer, STATS_ALAC_ENCODE_RESIDUALS, residual_count);
 }
 
 static void
@@ -1439,13 +1520,74 @@ write_metadata(BitstreamWriter* bw,
                const struct alac_frame_size *frame_sizes,
                unsigned frames_offset,
                const char encoder_version[])
+{
+    /*total size of all metadata atoms*/
+    unsigned total_size;
+
+    struct qt_atom *free;
+
+    total_size = write_ftyp(bw);
+
+    total_size += write_moov(bw,
+                             timestamp,
+                             sample_rate,
+                             channels,
+                             bits_per_sample,
+                             total_pcm_frames,
+                             block_size,
+                             history_multiplier,
+                             initial_history,
+                             maximum_K,
+                             frame_sizes,
+                             frames_offset,
+                             encoder_version);
+
+    /*free atom*/
+    free = qt_free_new(4096);
+    free->build(free, bw);
+    total_size += free->size(free);
+    free->free(free);
+
+    return total_size;
+}
+
+static unsigned
+write_ftyp(BitstreamWriter* bw)
+{
+    struct qt_atom *ftyp = qt_ftyp_new((uint8_t*)"M4A ", 0, 4,
+                                       (uint8_t*)"M4A ",
+                                       (uint8_t*)"mp42",
+                                       (uint8_t*)"isom",
+                                       (uint8_t*)"\x00\x00\x00\x00");
+    unsigned size;
+
+    ftyp->build(ftyp, bw);
+    size = ftyp->size(ftyp);
+    ftyp->free(ftyp);
+    return size;
+}
+
+static unsigned
+write_moov(BitstreamWriter* bw,
+           time_t timestamp,
+           unsigned sample_rate,
+           unsigned channels,
+           unsigned bits_per_sample,
+           unsigned total_pcm_frames,
+           unsigned block_size,
+           unsigned history_multiplier,
+           unsigned initial_history,
+           unsigned maximum_K,
+           const struct alac_frame_size *frame_sizes,
+           unsigned frames_offset,
+           const char encoder_version[])
 {
     const qt_time_t qt_timestamp = time_to_mac_utc(timestamp);
     const unsigned geometry[9] = {0x10000, 0x0, 0x0, 0x0, 0x10000,
                                   0x0, 0x0, 0x0, 0x40000000};
 
-    /*total size of all metadata atoms*/
-    unsigned total_size = 0;
+    /*size of the moov atom*/
+    unsigned moov_size;
 
     /*the largest ALAC frame size, in bytes*/
     unsigned max_coded_frame_size = 0;
@@ -1463,7 +1605,6 @@ write_metadata(BitstreamWriter* bw,
     unsigned chunk_size = 0;
 
     /*some atoms to generate*/
-    struct qt_atom *ftyp;
     struct qt_atom *stts = qt_stts_new(0, 0);
     struct qt_atom *stsc = qt_stsc_new(0, 0);
     struct qt_atom *stsz = qt_stsz_new(0, 0, 0);
@@ -1471,7 +1612,6 @@ write_metadata(BitstreamWriter* bw,
     struct qt_atom *stbl;
     struct qt_atom *moov;
     struct qt_atom *meta;
-    struct qt_atom *free;
 
     const struct alac_frame_size *size;
     struct stsc_entry *latest_entry;
@@ -1521,16 +1661,6 @@ write_metadata(BitstreamWriter* bw,
     bitrate *= sample_rate;
     bitrate /= total_pcm_frames;
 
-    /*ftyp atom*/
-    ftyp = qt_ftyp_new((uint8_t*)"M4A ", 0, 4,
-                       (uint8_t*)"M4A ",
-                       (uint8_t*)"mp42",
-                       (uint8_t*)"isom",
-                       (uint8_t*)"\x00\x00\x00\x00");
-    ftyp->build(ftyp, bw);
-    total_size += ftyp->size(ftyp);
-    ftyp->free(ftyp);
-
     /*stbl atom*/
     stbl = qt_tree_new("stbl", 5,
       qt_stsd_new(0, 0, 1,
@@ -1597,16 +1727,10 @@ write_metadata(BitstreamWriter* bw,
       qt_tree_new("udta", 1,
         meta));
     moov->build(moov, bw);
-    total_size += moov->size(moov);
+    moov_size = moov->size(moov);
     moov->free(moov);
 
-    /*free atom*/
-    free = qt_free_new(4096);
-    free->build(free, bw);
-    total_size += free->size(free);
-    free->free(free);
-
-    return total_size;
+    return moov_size;
 }
 
 #ifdef STANDALONE
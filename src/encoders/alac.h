@@ -255,4 +255,26 @@ write_metadata(BitstreamWriter* bw,
                unsigned frames_offset,
                const char version[]);
 
+/*writes the "ftyp" atom and returns its size in bytes*/
+static unsigned
+write_ftyp(BitstreamWriter* bw);
+
+/*writes the "moov" atom describing the given frames
+  whose data begins at "frames_offset" from the start of the file
+  and returns its size in bytes*/
+static unsigned
+write_moov(BitstreamWriter* bw,
+           time_t timestamp,
+           unsigned sample_rate,
+           unsigned channels,
+           unsigned bits_per_sample,
+           unsigned total_pcm_frames,
+           unsigned block_size,
+           unsigned history_multiplier,
+           unsigned initial_history,
+           unsigned maximum_K,
+           const struct alac_frame_size *frame_sizes,
+           unsigned frames_offset,
+           const char version[]);
+
 #endif
@@ -2,16 +2,35 @@
 #include "../common/md5.h"
 #include "../common/flac_crc.h"
 #include "../pcm_conv.h"
+#include "../common/stats.h"
+#include "../common/cpu.h"
 #include <string.h>
 #include <inttypes.h>
 #include <math.h>
 #include <float.h>
+#if defined(CPU_X86)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 typedef enum {CONSTANT, VERBATIM, FIXED, LPC} subframe_type_t;
 
 /*maximum 5 bit value + 1*/
 #define MAX_QLP_COEFFS 32
 
+/*a subframe's type and parameters as chosen by analyze_subframe,
+  from which it can be written without any further analysis*/
+struct flac_subframe {
+    subframe_type_t type;
+    unsigned bits_per_sample;  /*not including any wasted bits*/
+    unsigned wasted_bps;
+    unsigned order;            /*FIXED and LPC subframes only*/
+    unsigned precision;        /*LPC subframes only*/
+    int shift;                 /*LPC subframes only*/
+    int coefficients[MAX_QLP_COEFFS];
+};
+
 #ifndef MIN
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
 #endif
@@ -58,14 +77,24 @@ static unsigned
 total_seek_points(const struct flac_frame_size *sizes,
                   unsigned seekpoint_interval);
 
+/*returns the most seek points a stream of the given length could need
+  if its frames are no more than maximum_block_size PCM frames each*/
+static unsigned
+maximum_seek_points(uint64_t total_pcm_frames,
+                    unsigned maximum_block_size,
+                    unsigned seekpoint_interval);
+
 static struct flac_frame_size*
 dummy_frame_sizes(uint64_t total_pcm_frames, unsigned block_size);
 
-static void
+/*writes PADDING large enough to hold the stream's eventual SEEKTABLE
+
+  returns the size of that PADDING, not including its block header*/
+static unsigned
 write_placeholder_SEEKTABLE(BitstreamWriter *output,
                             int is_last,
                             uint64_t total_pcm_frames,
-                            unsigned block_size,
+                            const struct flac_encoding_options *options,
                             unsigned seekpoint_interval);
 
 static void
@@ -96,13 +125,41 @@ encode_frames(struct PCMReader *pcmreader,
               const struct flac_encoding_options *options,
               audiotools__MD5Context *md5_context);
 
+/*encodes a single frame whose header is numbered by frame
+  or, when variable block sizes are in use, by first sample*/
 static void
 encode_frame(const struct PCMReader *pcmreader,
              BitstreamWriter *output,
              const struct flac_encoding_options *options,
              const int pcm_data[],
              unsigned pcm_frames,
-             unsigned frame_number);
+             uint64_t frame_number);
+
+/*returns the size of the frame encode_frame would generate, in bits,
+  from the sizes of its subframes without writing any of them*/
+static unsigned
+frame_bits(const struct PCMReader *pcmreader,
+           const struct flac_encoding_options *options,
+           const int pcm_data[],
+           unsigned pcm_frames,
+           uint64_t frame_number);
+
+/*determines whether the given block is smaller as a single frame
+  or split into halves, each of which may be split again
+  up to "splits" times
+
+  appends the PCM frame counts of the chosen frames
+  to lengths and updates count accordingly
+  and returns their total size in bits*/
+static unsigned
+split_block(const struct PCMReader *pcmreader,
+            const struct flac_encoding_options *options,
+            const int pcm_data[],
+            unsigned pcm_frames,
+            uint64_t sample_number,
+            unsigned splits,
+            unsigned lengths[],
+            unsigned *count);
 
 static void
 correlate_channels(unsigned pcm_frames,
@@ -117,9 +174,17 @@ write_frame_header(BitstreamWriter *output,
                    unsigned sample_rate,
                    unsigned channels,
                    unsigned bits_per_sample,
-                   unsigned frame_number,
+                   int variable_block_size,
+                   uint64_t frame_number,
                    unsigned channel_assignment);
 
+/*returns the size of the frame header write_frame_header would generate,
+  in bits*/
+static unsigned
+frame_header_bits(unsigned sample_count,
+                  unsigned sample_rate,
+                  uint64_t frame_number);
+
 static unsigned
 encode_block_size(unsigned block_size);
 
@@ -129,8 +194,11 @@ encode_sample_rate(unsigned sample_rate);
 static unsigned
 encode_bits_per_sample(unsigned bits_per_sample);
 
+static unsigned
+utf8_bytes(uint64_t value);
+
 static void
-write_utf8(BitstreamWriter *output, unsigned value);
+write_utf8(BitstreamWriter *output, uint64_t value);
 
 static void
 encode_subframe(BitstreamWriter *output,
@@ -139,6 +207,26 @@ encode_subframe(BitstreamWriter *output,
                 int samples[],
                 unsigned bits_per_sample);
 
+/*determines the smallest subframe for the given samples
+  from the sizes of candidate subframes, without writing any of them,
+  and removes any wasted bits from the samples in the process
+
+  returns the size of that subframe in bits*/
+static unsigned
+analyze_subframe(const struct flac_encoding_options *options,
+                 unsigned sample_count,
+                 int samples[],
+                 unsigned bits_per_sample,
+                 struct flac_subframe *subframe);
+
+/*writes a subframe whose parameters have been set by analyze_subframe*/
+static void
+write_subframe(BitstreamWriter *output,
+               const struct flac_encoding_options *options,
+               unsigned sample_count,
+               const int samples[],
+               const struct flac_subframe *subframe);
+
 static void
 write_subframe_header(BitstreamWriter *output,
                       subframe_type_t subframe_type,
@@ -159,30 +247,114 @@ encode_verbatim_subframe(BitstreamWriter *output,
                          unsigned bits_per_sample,
                          unsigned wasted_bps);
 
+/*determines the best FIXED subframe order for the given samples
+
+  returns the size of that FIXED subframe in bits*/
+static unsigned
+fixed_subframe_bits(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    const int samples[],
+                    unsigned bits_per_sample,
+                    unsigned wasted_bps,
+                    unsigned *order);
+
 static void
 encode_fixed_subframe(BitstreamWriter *output,
                       const struct flac_encoding_options *options,
                       unsigned sample_count,
                       const int samples[],
                       unsigned bits_per_sample,
-                      unsigned wasted_bps);
+                      unsigned wasted_bps,
+                      unsigned order);
 
 static void
 next_fixed_order(unsigned sample_count,
                  const int previous_order[],
                  int next_order[]);
 
+/*returns the sum of the absolute values of values[0..count - 1]*/
 static uint64_t
 abs_sum(unsigned count, const int values[]);
 
-/*calculates best LPC subframe and writes LPC subframe to disk*/
+/*returns the size in bits of an LPC subframe
+  with the given parameters*/
+static unsigned
+lpc_subframe_bits(const struct flac_encoding_options *options,
+                  unsigned sample_count,
+                  const int samples[],
+                  unsigned bits_per_sample,
+                  unsigned wasted_bps,
+                  unsigned predictor_order,
+                  unsigned precision,
+                  int shift,
+                  const int coefficients[]);
+
+/*calculates the residuals of samples[predictor_order..sample_count - 1]
+  from the given LPC parameters*/
+static void
+calculate_lpc_residuals(unsigned sample_count,
+                        const int samples[],
+                        unsigned bits_per_sample,
+                        unsigned predictor_order,
+                        int shift,
+                        const int coefficients[],
+                        int residuals[]);
+
+typedef void (*lpc_residuals_f)(unsigned sample_count,
+                                const int samples[],
+                                unsigned predictor_order,
+                                int shift,
+                                const int coefficients[],
+                                int residuals[]);
+
+/*returns the residual of samples[i] from the given LPC parameters*/
+static inline int
+lpc_residual(const int samples[],
+             unsigned i,
+             unsigned predictor_order,
+             int shift,
+             const int coefficients[]);
+
+/*calculates LPC residuals using 64-bit sums*/
+static void
+lpc_residuals_scalar(unsigned sample_count,
+                     const int samples[],
+                     unsigned predictor_order,
+                     int shift,
+                     const int coefficients[],
+                     int residuals[]);
+
+#if defined(CPU_X86)
+/*calculates LPC residuals using 32-bit sums, 4 or 8 samples at a time*/
+CPU_TARGET("sse4.1") static void
+lpc_residuals_sse4_1(unsigned sample_count,
+                     const int samples[],
+                     unsigned predictor_order,
+                     int shift,
+                     const int coefficients[],
+                     int residuals[]);
+
+CPU_TARGET("avx2") static void
+lpc_residuals_avx2(unsigned sample_count,
+                   const int samples[],
+                   unsigned predictor_order,
+                   int shift,
+                   const int coefficients[],
+                   int residuals[]);
+#elif defined(CPU_ARM_NEON)
+/*calculates LPC residuals using 32-bit sums, 4 samples at a time*/
 static void
-encode_lpc_subframe(BitstreamWriter *output,
-                    const struct flac_encoding_options *options,
-                    unsigned sample_count,
-                    const int samples[],
-                    unsigned bits_per_sample,
-                    unsigned wasted_bps);
+lpc_residuals_neon(unsigned sample_count,
+                   const int samples[],
+                   unsigned predictor_order,
+                   int shift,
+                   const int coefficients[],
+                   int residuals[]);
+#endif
+
+/*the LPC residual kernel to use when every sum fits in 32 bits,
+  set by flacenc_init_dispatch()*/
+static lpc_residuals_f lpc_residuals_32 = lpc_residuals_scalar;
 
 /*writes actual LPC subframe to disk,
   not including the subframe header*/
@@ -207,6 +379,11 @@ calculate_best_lpc_params(const struct flac_encoding_options *options,
                           int *shift,
                           int coefficients[]);
 
+/*returns the window for a block of the given size*/
+static const double*
+block_window(const struct flac_encoding_options *options,
+             unsigned sample_count);
+
 static void
 window_signal(unsigned sample_count,
               const int samples[],
@@ -249,6 +426,33 @@ write_residual_block(BitstreamWriter *output,
                      unsigned predictor_order,
                      const int residuals[]);
 
+/*returns the size in bits of the residual block
+  as it would be written by write_residual_block*/
+static unsigned
+residual_block_bits(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    unsigned predictor_order,
+                    const int residuals[]);
+
+/*returns the residual coding method needed for the given Rice parameters*/
+static unsigned
+residual_coding_method(unsigned partition_count,
+                       const unsigned rice_parameters[]);
+
+/*returns the size in bits of a residual partition,
+  including its Rice parameter or escape code
+
+  if the partition is to be written escaped, without Rice coding,
+  sets "escape_bits" to the bits-per-residual to use
+  otherwise sets it to 0*/
+static unsigned
+residual_partition_bits(const struct flac_encoding_options *options,
+                        unsigned coding_method,
+                        unsigned rice_parameter,
+                        unsigned partition_size,
+                        const int residuals[],
+                        unsigned *escape_bits);
+
 static void
 write_compressed_residual_partition(BitstreamWriter *output,
                                     unsigned coding_method,
@@ -297,6 +501,14 @@ frame_sizes_info(const struct flac_frame_size *sizes,
                  unsigned *maximum_frame_size,
                  uint64_t *total_samples);
 
+/*determines the minimum and maximum block sizes for STREAMINFO
+  which are both the options' block size unless it varies*/
+static void
+block_sizes_info(const struct flac_frame_size *sizes,
+                 const struct flac_encoding_options *options,
+                 unsigned *minimum_block_size,
+                 unsigned *maximum_block_size);
+
 static void
 free_frame_sizes(struct flac_frame_size *sizes);
 
@@ -309,6 +521,14 @@ calculate_wasted_bps(unsigned sample_count, const int *samples);
 static void
 tukey_window(double alpha, unsigned block_size, double *window);
 
+/*allocates Tukey windows for the options' block size
+  and for any split block sizes, if necessary*/
+static void
+init_windows(struct flac_encoding_options *options);
+
+static void
+free_windows(struct flac_encoding_options *options);
+
 static unsigned
 largest_residual_bits(const int residual[], unsigned residual_count);
 
@@ -326,6 +546,7 @@ flacenc_init_options(struct flac_encoding_options *options)
     options->exhaustive_model_search = 0;
     options->mid_side = 0;
     options->adaptive_mid_side = 0;
+    options->variable_block_size = 0;
 
     options->use_verbatim = 1;
     options->use_constant = 1;
@@ -355,6 +576,8 @@ flacenc_display_options(const struct flac_encoding_options *options,
            options->mid_side);
     printf("adaptive mid side       %d\n",
            options->adaptive_mid_side);
+    printf("variable block size     %d\n",
+           options->variable_block_size);
     printf("use VERBATIM subframes  %d\n",
            options->use_verbatim);
     printf("use CONSTANT subframes  %d\n",
@@ -365,6 +588,10 @@ flacenc_display_options(const struct flac_encoding_options *options,
 
 #define BUFFER_SIZE 4096
 
+/*the number of seekpoints reserved when encoding a stream
+  of unknown length directly to seekable output*/
+#define SEEKPOINTS_RESERVED 128
+
 flacenc_status_t
 flacenc_encode_flac(struct PCMReader *pcmreader,
                     BitstreamWriter *output,
@@ -385,6 +612,10 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
     const unsigned seekpoint_interval = MAX(pcmreader->sample_rate * 10,
                                             options->block_size * 10);
 
+    /*if output isn't seekable, metadata can't be rewritten
+      after encoding and frames must go to temporary space instead*/
+    const int seekable = bw_seekable(output);
+
     audiotools__MD5Init(&md5_context);
 
     /*set QLP coeff precision based on block size*/
@@ -411,22 +642,21 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
         options->max_rice_parameter = 31;
     }
 
-    /*generate Tukey window, if necessary*/
-    if (options->max_lpc_order) {
-        options->window = malloc(sizeof(double) * options->block_size);
-        tukey_window(0.5, options->block_size, options->window);
-    } else {
-        options->window = NULL;
-    }
+    /*generate Tukey windows, if necessary*/
+    init_windows(options);
 
     /*write signature*/
     output->write_bytes(output, signature, 4);
 
-    if (total_pcm_frames) {
+    if (seekable && total_pcm_frames) {
         /*total number of PCM frames is known in advance*/
 
         bw_pos_t *streaminfo_start = output->getpos(output);
         uint64_t encoded_pcm_frames;
+        unsigned minimum_block_size;
+        unsigned maximum_block_size;
+        unsigned reserved_size;
+        unsigned seektable_size;
 
         /*write placeholder STREAMINFO based on total PCM frames*/
         write_STREAMINFO(output,
@@ -442,11 +672,11 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
                          md5sum);
 
         /*write placeholder SEEKTABLE based on total PCM frames*/
-        write_placeholder_SEEKTABLE(output,
-                                    0,
-                                    total_pcm_frames,
-                                    options->block_size,
-                                    seekpoint_interval);
+        reserved_size = write_placeholder_SEEKTABLE(output,
+                                                    0,
+                                                    total_pcm_frames,
+                                                    options,
+                                                    seekpoint_interval);
 
         /*write VORBIS_COMMENT based on version and channel mask*/
         write_VORBIS_COMMENT(output,
@@ -465,8 +695,8 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
                                     options,
                                     &md5_context);
 
-        /*delete window now that we're done with it, if necessary*/
-        free(options->window);
+        /*delete windows now that we're done with them, if necessary*/
+        free_windows(options);
 
         /*ensure total PCM frames matches*/
         frame_sizes_info(frame_sizes,
@@ -481,13 +711,111 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
         }
 
         /*rewrite STREAMINFO based on frames information*/
+        block_sizes_info(frame_sizes,
+                         options,
+                         &minimum_block_size,
+                         &maximum_block_size);
         output->setpos(output, streaminfo_start);
         streaminfo_start->del(streaminfo_start);
         audiotools__MD5Final(md5sum, &md5_context);
+        write_STREAMINFO(output,
+                         0,
+                         minimum_block_size,
+                         maximum_block_size,
+                         minimum_frame_size,
+                         maximum_frame_size,
+                         pcmreader->sample_rate,
+                         pcmreader->channels,
+                         pcmreader->bits_per_sample,
+                         total_pcm_frames,
+                         md5sum);
+
+        /*rewrite SEEKTABLE based on frames information
+          followed by PADDING filling the remainder, if any*/
+        seektable_size =
+            total_seek_points(frame_sizes, seekpoint_interval) * (8 + 8 + 2);
+        write_SEEKTABLE(output,
+                        0,
+                        frame_sizes,
+                        seekpoint_interval);
+        if (seektable_size < reserved_size) {
+            write_PADDING(output, 0, reserved_size - seektable_size - 4);
+        }
+
+        /*free frames information*/
+        free_frame_sizes(frame_sizes);
+    } else if (seekable) {
+        /*total number of PCM frames isn't known in advance
+          but output is seekable, so frames are written directly
+          after metadata blocks with space reserved for a SEEKTABLE*/
+
+        bw_pos_t *streaminfo_start = output->getpos(output);
+        bw_pos_t *seektable_start;
+        const unsigned reserved_size = SEEKPOINTS_RESERVED * (8 + 8 + 2);
+        unsigned seektable_interval = seekpoint_interval;
+        unsigned seektable_size;
+        unsigned minimum_block_size;
+        unsigned maximum_block_size;
+
+        /*write placeholder STREAMINFO*/
         write_STREAMINFO(output,
                          0,
                          options->block_size,
                          options->block_size,
+                         (1 << 24) - 1,
+                         0,
+                         pcmreader->sample_rate,
+                         pcmreader->channels,
+                         pcmreader->bits_per_sample,
+                         0,
+                         md5sum);
+
+        /*write placeholder SEEKTABLE with room for the reserved seekpoints*/
+        seektable_start = output->getpos(output);
+        write_PADDING(output, 0, reserved_size);
+
+        /*write VORBIS_COMMENT based on version and channel mask*/
+        write_VORBIS_COMMENT(output,
+                             padding_size ? 0 : 1,
+                             version,
+                             pcmreader);
+
+        /*write PADDING to disk, if any*/
+        if (padding_size) {
+            write_PADDING(output, 1, padding_size);
+        }
+
+        frame_sizes = encode_frames(pcmreader,
+                                    output,
+                                    options,
+                                    &md5_context);
+
+        /*delete windows now that we're done with them, if necessary*/
+        free_windows(options);
+
+        if (!frame_sizes) {
+            streaminfo_start->del(streaminfo_start);
+            seektable_start->del(seektable_start);
+            return FLAC_READ_ERROR;
+        }
+
+        frame_sizes_info(frame_sizes,
+                         &minimum_frame_size,
+                         &maximum_frame_size,
+                         &total_pcm_frames);
+        block_sizes_info(frame_sizes,
+                         options,
+                         &minimum_block_size,
+                         &maximum_block_size);
+
+        /*rewrite STREAMINFO based on frames information*/
+        output->setpos(output, streaminfo_start);
+        streaminfo_start->del(streaminfo_start);
+        audiotools__MD5Final(md5sum, &md5_context);
+        write_STREAMINFO(output,
+                         0,
+                         minimum_block_size,
+                         maximum_block_size,
                          minimum_frame_size,
                          maximum_frame_size,
                          pcmreader->sample_rate,
@@ -496,22 +824,40 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
                          total_pcm_frames,
                          md5sum);
 
-        /*rewrite SEEKTABLE based on frames information*/
+        /*widen the interval between seekpoints
+          until they fit in the reserved space*/
+        while (total_seek_points(frame_sizes, seektable_interval) >
+               SEEKPOINTS_RESERVED) {
+            seektable_interval *= 2;
+        }
+        seektable_size =
+            total_seek_points(frame_sizes, seektable_interval) * (8 + 8 + 2);
+
+        /*write SEEKTABLE in reserved space
+          followed by PADDING filling the remainder, if any*/
+        output->setpos(output, seektable_start);
+        seektable_start->del(seektable_start);
         write_SEEKTABLE(output,
                         0,
                         frame_sizes,
-                        seekpoint_interval);
+                        seektable_interval);
+        if (seektable_size < reserved_size) {
+            write_PADDING(output, 0, reserved_size - seektable_size - 4);
+        }
 
         /*free frames information*/
         free_frame_sizes(frame_sizes);
     } else {
-        /*total number of PCM frames isn't known in advance*/
-
-        /*encode frames to temporary space*/
+        /*output isn't seekable,
+          so encode frames to temporary space
+          and write them after metadata blocks*/
         FILE *tempfile = tmpfile();
         BitstreamWriter *temp_output;
         uint8_t buffer[BUFFER_SIZE];
         size_t amount_read;
+        uint64_t encoded_pcm_frames;
+        unsigned minimum_block_size;
+        unsigned maximum_block_size;
 
         if (tempfile) {
             temp_output = bw_open(tempfile, BS_BIG_ENDIAN);
@@ -528,8 +874,8 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
 
         temp_output->free(temp_output);
 
-        /*delete window now that we're done with it, if necessary*/
-        free(options->window);
+        /*delete windows now that we're done with them, if necessary*/
+        free_windows(options);
 
         if (!frame_sizes) {
             fclose(tempfile);
@@ -540,20 +886,30 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
         frame_sizes_info(frame_sizes,
                          &minimum_frame_size,
                          &maximum_frame_size,
-                         &total_pcm_frames);
+                         &encoded_pcm_frames);
+        block_sizes_info(frame_sizes,
+                         options,
+                         &minimum_block_size,
+                         &maximum_block_size);
+
+        if (total_pcm_frames && (encoded_pcm_frames != total_pcm_frames)) {
+            free_frame_sizes(frame_sizes);
+            fclose(tempfile);
+            return FLAC_PCM_MISMATCH;
+        }
 
         /*write STREAMINFO to disk*/
         audiotools__MD5Final(md5sum, &md5_context);
         write_STREAMINFO(output,
                          0,
-                         options->block_size,
-                         options->block_size,
+                         minimum_block_size,
+                         maximum_block_size,
                          minimum_frame_size,
                          maximum_frame_size,
                          pcmreader->sample_rate,
                          pcmreader->channels,
                          pcmreader->bits_per_sample,
-                         total_pcm_frames,
+                         encoded_pcm_frames,
                          md5sum);
 
         /*write SEEKTABLE to disk*/
@@ -615,6 +971,7 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
                              "disable_fixed_subframes",
                              "disable_lpc_subframes",
                              "padding_size",
+                             "variable_block_size",
                              NULL};
 
     char *filename = NULL;
@@ -642,7 +999,7 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
     if (!PyArg_ParseTupleAndKeywords(
             args,
             keywds,
-            "sO&s|Liiiiiiiiiiii",
+            "sO&s|Liiiiiiiiiiiii",
             kwlist,
             &filename,
             py_obj_to_pcmreader,
@@ -661,7 +1018,8 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
             &no_constant_subframes,
             &no_fixed_subframes,
             &no_lpc_subframes,
-            &padding_size)) {
+            &padding_size,
+            &options.variable_block_size)) {
         return NULL;
     }
 
@@ -845,6 +1203,17 @@ total_seek_points(const struct flac_frame_size *sizes,
     return total;
 }
 
+static unsigned
+maximum_seek_points(uint64_t total_pcm_frames,
+                    unsigned maximum_block_size,
+                    unsigned seekpoint_interval)
+{
+    /*each seek point but the last spans at least
+      seekpoint_interval - maximum_block_size PCM frames*/
+    return (unsigned)(total_pcm_frames /
+                      (seekpoint_interval - maximum_block_size)) + 1;
+}
+
 static struct flac_frame_size*
 dummy_frame_sizes(uint64_t total_pcm_frames, unsigned block_size)
 {
@@ -864,21 +1233,33 @@ dummy_frame_sizes(uint64_t total_pcm_frames, unsigned block_size)
     return sizes;
 }
 
-static void
+static unsigned
 write_placeholder_SEEKTABLE(BitstreamWriter *output,
                             int is_last,
                             uint64_t total_pcm_frames,
-                            unsigned block_size,
+                            const struct flac_encoding_options *options,
                             unsigned seekpoint_interval)
 {
-    struct flac_frame_size *dummy_sizes =
-        dummy_frame_sizes(total_pcm_frames, block_size);
+    unsigned seek_points;
+
+    if (options->variable_block_size) {
+        /*frame sizes aren't known in advance,
+          so reserve enough space for any of them*/
+        seek_points = maximum_seek_points(total_pcm_frames,
+                                          options->block_size,
+                                          seekpoint_interval);
+    } else {
+        struct flac_frame_size *dummy_sizes =
+            dummy_frame_sizes(total_pcm_frames, options->block_size);
 
-    write_PADDING(
-        output, is_last,
-        total_seek_points(dummy_sizes, seekpoint_interval) * (8 + 8 + 2));
+        seek_points = total_seek_points(dummy_sizes, seekpoint_interval);
 
-    free_frame_sizes(dummy_sizes);
+        free_frame_sizes(dummy_sizes);
+    }
+
+    write_PADDING(output, is_last, seek_points * (8 + 8 + 2));
+
+    return seek_points * (8 + 8 + 2);
 }
 
 static void
@@ -1001,15 +1382,12 @@ update_md5sum(audiotools__MD5Context *md5sum,
               unsigned bits_per_sample,
               unsigned pcm_frames)
 {
-    const unsigned total_samples = pcm_frames * channels;
-    const unsigned buffer_size = total_samples * (bits_per_sample / 8);
-    unsigned char buffer[buffer_size];
-
-    int_to_pcm_converter(bits_per_sample, 0, 1)(total_samples,
-                                                pcm_data,
-                                                buffer);
-
-    audiotools__MD5Update(md5sum, buffer, buffer_size);
+    audiotools__MD5UpdateSamples(md5sum,
+                                 pcm_data,
+                                 pcm_frames * channels,
+                                 bits_per_sample,
+                                 0,
+                                 1);
 }
 
 static struct flac_frame_size*
@@ -1021,33 +1399,78 @@ encode_frames(struct PCMReader *pcmreader,
     struct flac_frame_size *frame_sizes = NULL;
     int pcm_data[options->block_size * pcmreader->channels];
     unsigned pcm_frames_read;
-    unsigned frame_number = 0;
+    uint64_t frame_number = 0;
+
+    for (;;) {
+        unsigned lengths[1 << FLAC_MAX_BLOCK_SPLITS];
+        unsigned count = 0;
+        unsigned offset = 0;
+        unsigned i;
 
-    while ((pcm_frames_read =
-            pcmreader->read(pcmreader, options->block_size, pcm_data)) > 0) {
-        unsigned frame_size = 0;
+        STATS_START(read_timer);
+        if ((pcm_frames_read = pcmreader->read(pcmreader,
+                                               options->block_size,
+                                               pcm_data)) == 0) {
+            break;
+        }
+        STATS_STOP(read_timer,
+                   STATS_FLAC_ENCODE_READ,
+                   pcm_frames_read * pcmreader->channels);
 
         /*update running MD5 of stream*/
+        STATS_START(md5_timer);
         update_md5sum(md5_context,
                       pcm_data,
                       pcmreader->channels,
                       pcmreader->bits_per_sample,
                       pcm_frames_read);
+        STATS_STOP(md5_timer,
+                   STATS_FLAC_ENCODE_MD5,
+                   pcm_frames_read * pcmreader->channels);
+
+        /*divide block into frames, if block sizes may vary*/
+        if (options->variable_block_size) {
+            split_block(pcmreader,
+                        options,
+                        pcm_data,
+                        pcm_frames_read,
+                        frame_number,
+                        FLAC_MAX_BLOCK_SPLITS,
+                        lengths,
+                        &count);
+        } else {
+            lengths[count++] = pcm_frames_read;
+        }
 
-        /*encode frame itself*/
-        output->add_callback(output, (bs_callback_f)byte_counter, &frame_size);
-        encode_frame(pcmreader,
-                     output,
-                     options,
-                     pcm_data,
-                     pcm_frames_read,
-                     frame_number++);
-        output->pop_callback(output, NULL);
+        for (i = 0; i < count; i++) {
+            unsigned frame_size = 0;
+            STATS_START(frame_timer);
 
-        /*save total length of frame*/
-        frame_sizes = push_frame_size(frame_sizes,
-                                      frame_size,
-                                      pcm_frames_read);
+            /*encode frame itself*/
+            output->add_callback(output,
+                                 (bs_callback_f)byte_counter,
+                                 &frame_size);
+            encode_frame(pcmreader,
+                         output,
+                         options,
+                         pcm_data + (offset * pcmreader->channels),
+                         lengths[i],
+                         frame_number);
+            output->pop_callback(output, NULL);
+
+            STATS_STOP(frame_timer,
+                       STATS_FLAC_ENCODE_FRAME,
+                       lengths[i] * pcmreader->channels);
+
+            /*save total length of frame*/
+            frame_sizes = push_frame_size(frame_sizes,
+                                          frame_size,
+                                          lengths[i]);
+
+            /*variable-size frames are numbered by their first sample*/
+            frame_number += options->variable_block_size ? lengths[i] : 1;
+            offset += lengths[i];
+        }
     }
 
     if (pcmreader->status == PCM_OK) {
@@ -1065,7 +1488,7 @@ encode_frame(const struct PCMReader *pcmreader,
              const struct flac_encoding_options *options,
              const int pcm_data[],
              unsigned pcm_frames,
-             unsigned frame_number)
+             uint64_t frame_number)
 {
     unsigned c;
     uint16_t crc16 = 0;
@@ -1080,14 +1503,15 @@ encode_frame(const struct PCMReader *pcmreader,
         int average_channel[pcm_frames];
         int difference_channel[pcm_frames];
 
-        BitstreamRecorder *left_subframe =
-            bw_open_recorder(BS_BIG_ENDIAN);
-        BitstreamRecorder *right_subframe =
-            bw_open_recorder(BS_BIG_ENDIAN);
-        BitstreamRecorder *average_subframe =
-            bw_open_recorder(BS_BIG_ENDIAN);
-        BitstreamRecorder *difference_subframe =
-            bw_open_recorder(BS_BIG_ENDIAN);
+        struct flac_subframe left_subframe;
+        struct flac_subframe right_subframe;
+        struct flac_subframe average_subframe;
+        struct flac_subframe difference_subframe;
+
+        unsigned left_size;
+        unsigned right_size;
+        unsigned average_size;
+        unsigned difference_size;
 
         unsigned independent;
         unsigned left_side;
@@ -1103,41 +1527,39 @@ encode_frame(const struct PCMReader *pcmreader,
                            average_channel,
                            difference_channel);
 
-        encode_subframe((BitstreamWriter*)left_subframe,
-                        options,
-                        pcm_frames,
-                        left_channel,
-                        pcmreader->bits_per_sample);
+        /*size up all 4 possible subframes
+          but only write the 2 which make up the smallest assignment*/
+        left_size = analyze_subframe(options,
+                                     pcm_frames,
+                                     left_channel,
+                                     pcmreader->bits_per_sample,
+                                     &left_subframe);
 
-        encode_subframe((BitstreamWriter*)right_subframe,
-                        options,
-                        pcm_frames,
-                        right_channel,
-                        pcmreader->bits_per_sample);
+        right_size = analyze_subframe(options,
+                                      pcm_frames,
+                                      right_channel,
+                                      pcmreader->bits_per_sample,
+                                      &right_subframe);
 
-        encode_subframe((BitstreamWriter*)average_subframe,
-                        options,
-                        pcm_frames,
-                        average_channel,
-                        pcmreader->bits_per_sample);
+        average_size = analyze_subframe(options,
+                                        pcm_frames,
+                                        average_channel,
+                                        pcmreader->bits_per_sample,
+                                        &average_subframe);
 
-        encode_subframe((BitstreamWriter*)difference_subframe,
-                        options,
-                        pcm_frames,
-                        difference_channel,
-                        pcmreader->bits_per_sample + 1);
+        difference_size = analyze_subframe(options,
+                                           pcm_frames,
+                                           difference_channel,
+                                           pcmreader->bits_per_sample + 1,
+                                           &difference_subframe);
 
-        independent = left_subframe->bits_written(left_subframe) +
-                      right_subframe->bits_written(right_subframe);
+        independent = left_size + right_size;
 
-        left_side = left_subframe->bits_written(left_subframe) +
-                    difference_subframe->bits_written(difference_subframe);
+        left_side = left_size + difference_size;
 
-        side_right = difference_subframe->bits_written(difference_subframe) +
-                     right_subframe->bits_written(right_subframe);
+        side_right = difference_size + right_size;
 
-        mid_side = average_subframe->bits_written(average_subframe) +
-                   difference_subframe->bits_written(difference_subframe);
+        mid_side = average_size + difference_size;
 
         if ((independent < left_side) &&
             (independent < side_right) &&
@@ -1148,10 +1570,13 @@ encode_frame(const struct PCMReader *pcmreader,
                                pcmreader->sample_rate,
                                pcmreader->channels,
                                pcmreader->bits_per_sample,
+                               options->variable_block_size,
                                frame_number,
                                1);
-            left_subframe->copy(left_subframe, output);
-            right_subframe->copy(right_subframe, output);
+            write_subframe(output, options, pcm_frames,
+                           left_channel, &left_subframe);
+            write_subframe(output, options, pcm_frames,
+                           right_channel, &right_subframe);
         } else if ((left_side < side_right) && (left_side < mid_side)) {
             /*write subframes using left-side order*/
             write_frame_header(output,
@@ -1159,10 +1584,13 @@ encode_frame(const struct PCMReader *pcmreader,
                                pcmreader->sample_rate,
                                pcmreader->channels,
                                pcmreader->bits_per_sample,
+                               options->variable_block_size,
                                frame_number,
                                8);
-            left_subframe->copy(left_subframe, output);
-            difference_subframe->copy(difference_subframe, output);
+            write_subframe(output, options, pcm_frames,
+                           left_channel, &left_subframe);
+            write_subframe(output, options, pcm_frames,
+                           difference_channel, &difference_subframe);
         } else if (side_right < mid_side) {
             /*write subframes using side-right order*/
             write_frame_header(output,
@@ -1170,10 +1598,13 @@ encode_frame(const struct PCMReader *pcmreader,
                                pcmreader->sample_rate,
                                pcmreader->channels,
                                pcmreader->bits_per_sample,
+                               options->variable_block_size,
                                frame_number,
                                9);
-            difference_subframe->copy(difference_subframe, output);
-            right_subframe->copy(right_subframe, output);
+            write_subframe(output, options, pcm_frames,
+                           difference_channel, &difference_subframe);
+            write_subframe(output, options, pcm_frames,
+                           right_channel, &right_subframe);
         } else {
             /*write subframes using mid-side order*/
             write_frame_header(output,
@@ -1181,16 +1612,14 @@ encode_frame(const struct PCMReader *pcmreader,
                                pcmreader->sample_rate,
                                pcmreader->channels,
                                pcmreader->bits_per_sample,
+                               options->variable_block_size,
                                frame_number,
                                10);
-            average_subframe->copy(average_subframe, output);
-            difference_subframe->copy(difference_subframe, output);
+            write_subframe(output, options, pcm_frames,
+                           average_channel, &average_subframe);
+            write_subframe(output, options, pcm_frames,
+                           difference_channel, &difference_subframe);
         }
-
-        left_subframe->close(left_subframe);
-        right_subframe->close(right_subframe);
-        average_subframe->close(average_subframe);
-        difference_subframe->close(difference_subframe);
     } else {
         /*store channels independently*/
 
@@ -1201,6 +1630,7 @@ encode_frame(const struct PCMReader *pcmreader,
                            pcmreader->sample_rate,
                            pcmreader->channels,
                            pcmreader->bits_per_sample,
+                           options->variable_block_size,
                            frame_number,
                            channel_assignment);
 
@@ -1226,6 +1656,137 @@ encode_frame(const struct PCMReader *pcmreader,
     output->write(output, 16, crc16);
 }
 
+static unsigned
+frame_bits(const struct PCMReader *pcmreader,
+           const struct flac_encoding_options *options,
+           const int pcm_data[],
+           unsigned pcm_frames,
+           uint64_t frame_number)
+{
+    unsigned bits = frame_header_bits(pcm_frames,
+                                      pcmreader->sample_rate,
+                                      frame_number);
+    struct flac_subframe subframe;
+
+    if ((pcmreader->channels == 2) &&
+        (options->mid_side || options->adaptive_mid_side)) {
+        /*use the smallest channel assignment, as encode_frame does*/
+        int left_channel[pcm_frames];
+        int right_channel[pcm_frames];
+        int average_channel[pcm_frames];
+        int difference_channel[pcm_frames];
+        unsigned left_size;
+        unsigned right_size;
+        unsigned average_size;
+        unsigned difference_size;
+
+        get_channel_data(pcm_data, 0, 2, pcm_frames, left_channel);
+        get_channel_data(pcm_data, 1, 2, pcm_frames, right_channel);
+
+        correlate_channels(pcm_frames,
+                           left_channel,
+                           right_channel,
+                           average_channel,
+                           difference_channel);
+
+        left_size = analyze_subframe(options,
+                                     pcm_frames,
+                                     left_channel,
+                                     pcmreader->bits_per_sample,
+                                     &subframe);
+        right_size = analyze_subframe(options,
+                                      pcm_frames,
+                                      right_channel,
+                                      pcmreader->bits_per_sample,
+                                      &subframe);
+        average_size = analyze_subframe(options,
+                                        pcm_frames,
+                                        average_channel,
+                                        pcmreader->bits_per_sample,
+                                        &subframe);
+        difference_size = analyze_subframe(options,
+                                           pcm_frames,
+                                           difference_channel,
+                                           pcmreader->bits_per_sample + 1,
+                                           &subframe);
+
+        bits += MIN(MIN(left_size + right_size,
+                        left_size + difference_size),
+                    MIN(difference_size + right_size,
+                        average_size + difference_size));
+    } else {
+        unsigned c;
+
+        for (c = 0; c < pcmreader->channels; c++) {
+            int channel_data[pcm_frames];
+
+            get_channel_data(pcm_data, c, pcmreader->channels,
+                             pcm_frames, channel_data);
+
+            bits += analyze_subframe(options,
+                                     pcm_frames,
+                                     channel_data,
+                                     pcmreader->bits_per_sample,
+                                     &subframe);
+        }
+    }
+
+    /*byte-align subframes and add CRC-16*/
+    return ((bits + 7) / 8 * 8) + 16;
+}
+
+static unsigned
+split_block(const struct PCMReader *pcmreader,
+            const struct flac_encoding_options *options,
+            const int pcm_data[],
+            unsigned pcm_frames,
+            uint64_t sample_number,
+            unsigned splits,
+            unsigned lengths[],
+            unsigned *count)
+{
+    const unsigned whole_bits = frame_bits(pcmreader,
+                                           options,
+                                           pcm_data,
+                                           pcm_frames,
+                                           sample_number);
+
+    /*only split evenly, and never below the 16 PCM frame minimum*/
+    if (splits && ((pcm_frames % 2) == 0) && ((pcm_frames / 2) >= 16)) {
+        const unsigned half = pcm_frames / 2;
+        unsigned split_lengths[1 << FLAC_MAX_BLOCK_SPLITS];
+        unsigned split_count = 0;
+        const unsigned split_bits =
+            split_block(pcmreader,
+                        options,
+                        pcm_data,
+                        half,
+                        sample_number,
+                        splits - 1,
+                        split_lengths,
+                        &split_count) +
+            split_block(pcmreader,
+                        options,
+                        pcm_data + (half * pcmreader->channels),
+                        half,
+                        sample_number + half,
+                        splits - 1,
+                        split_lengths,
+                        &split_count);
+
+        if (split_bits < whole_bits) {
+            unsigned i;
+            for (i = 0; i < split_count; i++) {
+                lengths[(*count)++] = split_lengths[i];
+            }
+            return split_bits;
+        }
+    }
+
+    lengths[(*count)++] = pcm_frames;
+    return whole_bits;
+}
+
 static void
 correlate_channels(unsigned pcm_frames,
                    const int left_channel[],
@@ -1247,7 +1808,8 @@ write_frame_header(BitstreamWriter *output,
                    unsigned sample_rate,
                    unsigned channels,
                    unsigned bits_per_sample,
-                   unsigned frame_number,
+                   int variable_block_size,
+                   uint64_t frame_number,
                    unsigned channel_assignment)
 {
     uint8_t crc8 = 0;
@@ -1259,7 +1821,7 @@ write_frame_header(BitstreamWriter *output,
 
     output->write(output, 14, 0x3FFE);            /*sync code*/
     output->write(output, 1, 0);                  /*reserved*/
-    output->write(output, 1, 0);                  /*blocking*/
+    output->write(output, 1, variable_block_size); /*blocking*/
     output->write(output, 4, encoded_block_size);
     output->write(output, 4, encoded_sample_rate);
     output->write(output, 4, channel_assignment);
@@ -1286,6 +1848,29 @@ write_frame_header(BitstreamWriter *output,
     output->write(output, 8, crc8);
 }
 
+static unsigned
+frame_header_bits(unsigned sample_count,
+                  unsigned sample_rate,
+                  uint64_t frame_number)
+{
+    unsigned bits = 32 + (utf8_bytes(frame_number) * 8) + 8;
+
+    switch (encode_block_size(sample_count)) {
+    case 6: bits += 8; break;
+    case 7: bits += 16; break;
+    default: break;
+    }
+
+    switch (encode_sample_rate(sample_rate)) {
+    case 12: bits += 8; break;
+    case 13:
+    case 14: bits += 16; break;
+    default: break;
+    }
+
+    return bits;
+}
+
 static unsigned
 encode_block_size(unsigned block_size)
 {
@@ -1355,40 +1940,49 @@ encode_bits_per_sample(unsigned bits_per_sample)
     }
 }
 
+static unsigned
+utf8_bytes(uint64_t value)
+{
+    if (value <= 0x7F) {
+        return 1;
+    } else if (value <= 0x7FF) {
+        return 2;
+    } else if (value <= 0xFFFF) {
+        return 3;
+    } else if (value <= 0x1FFFFF) {
+        return 4;
+    } else if (value <= 0x3FFFFFF) {
+        return 5;
+    } else if (value <= 0x7FFFFFFF) {
+        return 6;
+    } else {
+        /*sample numbers of variable-size frames may need up to 36 bits*/
+        return 7;
+    }
+}
+
 static void
-write_utf8(BitstreamWriter *output, unsigned value)
+write_utf8(BitstreamWriter *output, uint64_t value)
 {
     if (value <= 0x7F) {
         /*1 byte only*/
-        output->write(output, 8, value);
+        output->write(output, 8, (unsigned)value);
     } else {
-        unsigned int total_bytes = 0;
-        int shift;
-
         /*more than 1 byte*/
+        const unsigned total_bytes = utf8_bytes(value);
+        int shift = (total_bytes - 1) * 6;
 
-        if (value <= 0x7FF) {
-            total_bytes = 2;
-        } else if (value <= 0xFFFF) {
-            total_bytes = 3;
-        } else if (value <= 0x1FFFFF) {
-            total_bytes = 4;
-        } else if (value <= 0x3FFFFFF) {
-            total_bytes = 5;
-        } else if (value <= 0x7FFFFFFF) {
-            total_bytes = 6;
-        }
-
-        shift = (total_bytes - 1) * 6;
         /*send out the initial unary + leftover most-significant bits*/
         output->write_unary(output, 0, total_bytes);
-        output->write(output, 7 - total_bytes, value >> shift);
+        if (total_bytes < 7) {
+            output->write(output, 7 - total_bytes, (unsigned)(value >> shift));
+        }
 
         /*then send the least-significant bits,
           6 at a time with a unary 1 value appended*/
         for (shift -= 6; shift >= 0; shift -= 6) {
             output->write_unary(output, 0, 1);
-            output->write(output, 6, (value >> shift) & 0x3F);
+            output->write(output, 6, (unsigned)((value >> shift) & 0x3F));
         }
     }
 }
@@ -1399,19 +1993,35 @@ encode_subframe(BitstreamWriter *output,
                 unsigned sample_count,
                 int samples[],
                 unsigned bits_per_sample)
+{
+    struct flac_subframe subframe;
+
+    analyze_subframe(options,
+                     sample_count,
+                     samples,
+                     bits_per_sample,
+                     &subframe);
+
+    write_subframe(output, options, sample_count, samples, &subframe);
+}
+
+static unsigned
+analyze_subframe(const struct flac_encoding_options *options,
+                 unsigned sample_count,
+                 int samples[],
+                 unsigned bits_per_sample,
+                 struct flac_subframe *subframe)
 {
     if (options->use_constant && samples_identical(sample_count, samples)) {
-        encode_constant_subframe(output,
-                                 sample_count,
-                                 samples[0],
-                                 bits_per_sample,
-                                 0);
+        subframe->type = CONSTANT;
+        subframe->bits_per_sample = bits_per_sample;
+        subframe->wasted_bps = 0;
+        return 8 + bits_per_sample;
     } else {
         const unsigned wasted_bps =
             calculate_wasted_bps(sample_count, samples);
         unsigned smallest_subframe_size = 0;
-        BitstreamRecorder *fixed_subframe = NULL;
-        BitstreamRecorder *lpc_subframe = NULL;
+        unsigned subframe_size;
 
         /*remove wasted bits from least-signficant bits, if any*/
         if (wasted_bps) {
@@ -1422,79 +2032,138 @@ encode_subframe(BitstreamWriter *output,
             bits_per_sample -= wasted_bps;
         }
 
-        if (options->use_verbatim) {
+        subframe->bits_per_sample = bits_per_sample;
+        subframe->wasted_bps = wasted_bps;
+
+        /*fall back to a VERBATIM subframe
+          if no other subframe is smaller*/
+        subframe->type = VERBATIM;
+        subframe_size = 8 + wasted_bps + (bits_per_sample * sample_count);
+
+        if (options->use_verbatim) {
             smallest_subframe_size =
                 8 + wasted_bps +
                 ((bits_per_sample - wasted_bps) * sample_count);
         }
 
+        /*a candidate subframe replaces the current smallest one
+          if it's no larger, or if there is no smallest one yet*/
         if (options->use_fixed) {
-            fixed_subframe =
-                bw_open_limited_recorder(BS_BIG_ENDIAN,
-                                         smallest_subframe_size);
+            unsigned order;
+            STATS_START(fixed_timer);
+            const unsigned fixed_size = fixed_subframe_bits(options,
+                                                            sample_count,
+                                                            samples,
+                                                            bits_per_sample,
+                                                            wasted_bps,
+                                                            &order);
+            STATS_STOP(fixed_timer, STATS_FLAC_ENCODE_FIXED, sample_count);
+
+            if ((smallest_subframe_size == 0) ||
+                (fixed_size <= smallest_subframe_size)) {
+                subframe->type = FIXED;
+                subframe->order = order;
+                smallest_subframe_size = subframe_size = fixed_size;
+            }
+        }
 
-            if (!setjmp(*bw_try((BitstreamWriter*)fixed_subframe))) {
-                encode_fixed_subframe((BitstreamWriter*)fixed_subframe,
-                                      options,
+        if (options->max_lpc_order) {
+            unsigned order;
+            unsigned precision;
+            int shift;
+            int coefficients[MAX_QLP_COEFFS];
+            unsigned lpc_size;
+            STATS_START(lpc_timer);
+
+            calculate_best_lpc_params(options,
                                       sample_count,
                                       samples,
                                       bits_per_sample,
-                                      wasted_bps);
-                bw_etry((BitstreamWriter*)fixed_subframe);
-
-                smallest_subframe_size =
-                    fixed_subframe->bits_written(fixed_subframe);
-            } else {
-                /*FIXED subframe too large*/
-                bw_etry((BitstreamWriter*)fixed_subframe);
-                fixed_subframe->close(fixed_subframe);
-                fixed_subframe = NULL;
+                                      &order,
+                                      &precision,
+                                      &shift,
+                                      coefficients);
+
+            lpc_size = lpc_subframe_bits(options,
+                                         sample_count,
+                                         samples,
+                                         bits_per_sample,
+                                         wasted_bps,
+                                         order,
+                                         precision,
+                                         shift,
+                                         coefficients);
+
+            STATS_STOP(lpc_timer, STATS_FLAC_ENCODE_LPC, sample_count);
+
+            if ((smallest_subframe_size == 0) ||
+                (lpc_size <= smallest_subframe_size)) {
+                subframe->type = LPC;
+                subframe->order = order;
+                subframe->precision = precision;
+                subframe->shift = shift;
+                memcpy(subframe->coefficients,
+                       coefficients,
+                       order * sizeof(int));
+                subframe_size = lpc_size;
             }
         }
 
-        if (options->max_lpc_order) {
-            lpc_subframe =
-                bw_open_limited_recorder(BS_BIG_ENDIAN,
-                                         smallest_subframe_size);
+        return subframe_size;
+    }
+}
 
-            if (!setjmp(*bw_try((BitstreamWriter*)lpc_subframe))) {
-                encode_lpc_subframe((BitstreamWriter*)lpc_subframe,
-                                    options,
-                                    sample_count,
-                                    samples,
-                                    bits_per_sample,
-                                    wasted_bps);
-                bw_etry((BitstreamWriter*)lpc_subframe);
-
-                smallest_subframe_size =
-                    lpc_subframe->bits_written(lpc_subframe);
-
-                if (fixed_subframe) {
-                    fixed_subframe->close(fixed_subframe);
-                    fixed_subframe = NULL;
-                }
-            } else {
-                /*LPC subframe too large*/
-                bw_etry((BitstreamWriter*)lpc_subframe);
-                lpc_subframe->close(lpc_subframe);
-                lpc_subframe = NULL;
-            }
-        }
+static void
+write_subframe(BitstreamWriter *output,
+               const struct flac_encoding_options *options,
+               unsigned sample_count,
+               const int samples[],
+               const struct flac_subframe *subframe)
+{
+    STATS_START(subframe_timer);
 
-        if (lpc_subframe) {
-            lpc_subframe->copy(lpc_subframe, output);
-            lpc_subframe->close(lpc_subframe);
-        } else if (fixed_subframe) {
-            fixed_subframe->copy(fixed_subframe, output);
-            fixed_subframe->close(fixed_subframe);
-        } else {
-            encode_verbatim_subframe(output,
-                                     sample_count,
-                                     samples,
-                                     bits_per_sample,
-                                     wasted_bps);
-        }
+    switch (subframe->type) {
+    case CONSTANT:
+        encode_constant_subframe(output,
+                                 sample_count,
+                                 samples[0],
+                                 subframe->bits_per_sample,
+                                 subframe->wasted_bps);
+        break;
+    case VERBATIM:
+        encode_verbatim_subframe(output,
+                                 sample_count,
+                                 samples,
+                                 subframe->bits_per_sample,
+                                 subframe->wasted_bps);
+        break;
+    case FIXED:
+        encode_fixed_subframe(output,
+                              options,
+                              sample_count,
+                              samples,
+                              subframe->bits_per_sample,
+                              subframe->wasted_bps,
+                              subframe->order);
+        break;
+    case LPC:
+        write_subframe_header(output,
+                              LPC,
+                              subframe->order,
+                              subframe->wasted_bps);
+        write_lpc_subframe(output,
+                           options,
+                           sample_count,
+                           samples,
+                           subframe->bits_per_sample,
+                           subframe->order,
+                           subframe->precision,
+                           subframe->shift,
+                           subframe->coefficients);
+        break;
     }
+
+    STATS_STOP(subframe_timer, STATS_FLAC_ENCODE_SUBFRAME, sample_count);
 }
 
 static void
@@ -1555,13 +2224,13 @@ encode_verbatim_subframe(BitstreamWriter *output,
     }
 }
 
-static void
-encode_fixed_subframe(BitstreamWriter *output,
-                      const struct flac_encoding_options *options,
-                      unsigned sample_count,
-                      const int samples[],
-                      unsigned bits_per_sample,
-                      unsigned wasted_bps)
+static unsigned
+fixed_subframe_bits(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    const int samples[],
+                    unsigned bits_per_sample,
+                    unsigned wasted_bps,
+                    unsigned *order)
 {
     const unsigned max_order = sample_count > 4 ? 4 : sample_count - 1;
     int order1[max_order >= 1 ? sample_count - 1 : 0];
@@ -1598,23 +2267,52 @@ encode_fixed_subframe(BitstreamWriter *output,
         }
     }
 
+    *order = best_order;
+
+    /*subframe header, warm-up samples and residual block*/
+    return 8 + wasted_bps +
+           (best_order * bits_per_sample) +
+           residual_block_bits(options,
+                               sample_count,
+                               best_order,
+                               orders[best_order]);
+}
+
+static void
+encode_fixed_subframe(BitstreamWriter *output,
+                      const struct flac_encoding_options *options,
+                      unsigned sample_count,
+                      const int samples[],
+                      unsigned bits_per_sample,
+                      unsigned wasted_bps,
+                      unsigned order)
+{
+    int residuals[sample_count];
+    unsigned i;
+
     /*write subframe header*/
     write_subframe_header(output,
                           FIXED,
-                          best_order,
+                          order,
                           wasted_bps);
 
     /*write warm-up samples*/
-    for (i = 0; i < best_order; i++) {
+    for (i = 0; i < order; i++) {
         output->write_signed(output, bits_per_sample, samples[i]);
     }
 
+    /*calculate residuals of the given order in place*/
+    memcpy(residuals, samples, sample_count * sizeof(int));
+    for (i = 0; i < order; i++) {
+        next_fixed_order(sample_count - i, residuals, residuals);
+    }
+
     /*write residual block*/
     write_residual_block(output,
                          options,
                          sample_count,
-                         best_order,
-                         orders[i]);
+                         order,
+                         residuals);
 }
 
 static void
@@ -1631,47 +2329,54 @@ next_fixed_order(unsigned sample_count,
 static uint64_t
 abs_sum(unsigned count, const int values[])
 {
-    register uint64_t accumulator = 0;
-    for (; count; count--) {
-        accumulator += abs(*values);
-        values += 1;
+    uint64_t sum = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums = zero;
+
+    for (; count >= 4; count -= 4) {
+        const __m128i block = _mm_loadu_si128((const __m128i*)values);
+        const __m128i sign = _mm_srai_epi32(block, 31);
+        const __m128i magnitudes =
+            _mm_sub_epi32(_mm_xor_si128(block, sign), sign);
+
+        /*widen to 64 bits so large values can't overflow the sum*/
+        sums = _mm_add_epi64(sums, _mm_unpacklo_epi32(magnitudes, zero));
+        sums = _mm_add_epi64(sums, _mm_unpackhi_epi32(magnitudes, zero));
+        values += 4;
+    }
+    sums = _mm_add_epi64(sums, _mm_unpackhi_epi64(sums, sums));
+#if defined(__x86_64__)
+    sum = (uint64_t)_mm_cvtsi128_si64(sums);
+#else
+    {
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i*)lanes, sums);
+        sum = lanes[0];
     }
-    return accumulator;
-}
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint64x2_t sums = vdupq_n_u64(0);
 
-static void
-encode_lpc_subframe(BitstreamWriter *output,
-                    const struct flac_encoding_options *options,
-                    unsigned sample_count,
-                    const int samples[],
-                    unsigned bits_per_sample,
-                    unsigned wasted_bps)
-{
-    unsigned predictor_order;
-    unsigned precision;
-    int shift;
-    int coefficients[MAX_QLP_COEFFS];
+    for (; count >= 4; count -= 4) {
+        const uint32x4_t magnitudes =
+            vreinterpretq_u32_s32(vabsq_s32(vld1q_s32(values)));
 
-    calculate_best_lpc_params(options,
-                              sample_count,
-                              samples,
-                              bits_per_sample,
-                              &predictor_order,
-                              &precision,
-                              &shift,
-                              coefficients);
+        /*widen to 64 bits so large values can't overflow the sum*/
+        sums = vpadalq_u32(sums, magnitudes);
+        values += 4;
+    }
+    sum = vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1);
+#endif
 
-    write_subframe_header(output, LPC, predictor_order, wasted_bps);
+    for (; count; count--) {
+        sum += values[0] >= 0 ?
+               (uint32_t)values[0] :
+               -(uint32_t)values[0];
+        values += 1;
+    }
 
-    write_lpc_subframe(output,
-                       options,
-                       sample_count,
-                       samples,
-                       bits_per_sample,
-                       predictor_order,
-                       precision,
-                       shift,
-                       coefficients);
+    return sum;
 }
 
 static void
@@ -1696,15 +2401,13 @@ write_lpc_subframe(BitstreamWriter *output,
     for (i = 0; i < predictor_order; i++) {
         output->write_signed(output, precision, coefficients[i]);
     }
-    for (i = predictor_order; i < sample_count; i++) {
-        register int64_t sum = 0;
-        register unsigned j;
-        for (j = 0; j < predictor_order; j++) {
-            sum += ((int64_t)coefficients[j] * (int64_t)samples[i - j - 1]);
-        }
-        sum >>= shift;
-        residuals[i - predictor_order] = samples[i] - (int)sum;
-    }
+    calculate_lpc_residuals(sample_count,
+                            samples,
+                            bits_per_sample,
+                            predictor_order,
+                            shift,
+                            coefficients,
+                            residuals);
     write_residual_block(output,
                          options,
                          sample_count,
@@ -1712,6 +2415,227 @@ write_lpc_subframe(BitstreamWriter *output,
                          residuals);
 }
 
+static unsigned
+lpc_subframe_bits(const struct flac_encoding_options *options,
+                  unsigned sample_count,
+                  const int samples[],
+                  unsigned bits_per_sample,
+                  unsigned wasted_bps,
+                  unsigned predictor_order,
+                  unsigned precision,
+                  int shift,
+                  const int coefficients[])
+{
+    int residuals[sample_count - 1];
+
+    calculate_lpc_residuals(sample_count,
+                            samples,
+                            bits_per_sample,
+                            predictor_order,
+                            shift,
+                            coefficients,
+                            residuals);
+
+    /*subframe header, warm-up samples, QLP precision and shift,
+      QLP coefficients and residual block*/
+    return 8 + wasted_bps +
+           (predictor_order * bits_per_sample) +
+           4 + 5 +
+           (predictor_order * precision) +
+           residual_block_bits(options,
+                               sample_count,
+                               predictor_order,
+                               residuals);
+}
+
+static void
+calculate_lpc_residuals(unsigned sample_count,
+                        const int samples[],
+                        unsigned bits_per_sample,
+                        unsigned predictor_order,
+                        int shift,
+                        const int coefficients[],
+                        int residuals[])
+{
+    uint64_t coefficient_sum = 0;
+    unsigned i;
+
+    for (i = 0; i < predictor_order; i++) {
+        coefficient_sum += coefficients[i] >= 0 ?
+                           coefficients[i] : -(int64_t)coefficients[i];
+    }
+
+    /*if no sum can leave 32 bits, wrapping arithmetic
+      gives the same residuals as 64-bit arithmetic*/
+    if ((coefficient_sum << (bits_per_sample - 1)) < (UINT64_C(1) << 31)) {
+        lpc_residuals_32(sample_count,
+                         samples,
+                         predictor_order,
+                         shift,
+                         coefficients,
+                         residuals);
+    } else {
+        lpc_residuals_scalar(sample_count,
+                             samples,
+                             predictor_order,
+                             shift,
+                             coefficients,
+                             residuals);
+    }
+}
+
+static inline int
+lpc_residual(const int samples[],
+             unsigned i,
+             unsigned predictor_order,
+             int shift,
+             const int coefficients[])
+{
+    register int64_t sum = 0;
+    register unsigned j;
+    for (j = 0; j < predictor_order; j++) {
+        sum += ((int64_t)coefficients[j] * (int64_t)samples[i - j - 1]);
+    }
+    sum >>= shift;
+    return samples[i] - (int)sum;
+}
+
+static void
+lpc_residuals_scalar(unsigned sample_count,
+                     const int samples[],
+                     unsigned predictor_order,
+                     int shift,
+                     const int coefficients[],
+                     int residuals[])
+{
+    register unsigned i;
+
+    for (i = predictor_order; i < sample_count; i++) {
+        residuals[i - predictor_order] =
+            lpc_residual(samples, i, predictor_order, shift, coefficients);
+    }
+}
+
+#if defined(CPU_X86)
+CPU_TARGET("sse4.1") static void
+lpc_residuals_sse4_1(unsigned sample_count,
+                     const int samples[],
+                     unsigned predictor_order,
+                     int shift,
+                     const int coefficients[],
+                     int residuals[])
+{
+    const __m128i shift_count = _mm_cvtsi32_si128(shift);
+    unsigned i;
+
+    for (i = predictor_order; (i + 4) <= sample_count; i += 4) {
+        __m128i sum = _mm_setzero_si128();
+        unsigned j;
+        for (j = 0; j < predictor_order; j++) {
+            const __m128i previous =
+                _mm_loadu_si128((const __m128i*)(samples + i - j - 1));
+            sum = _mm_add_epi32(
+                sum,
+                _mm_mullo_epi32(_mm_set1_epi32(coefficients[j]), previous));
+        }
+        sum = _mm_sra_epi32(sum, shift_count);
+        _mm_storeu_si128(
+            (__m128i*)(residuals + i - predictor_order),
+            _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(samples + i)),
+                          sum));
+    }
+
+    for (; i < sample_count; i++) {
+        residuals[i - predictor_order] =
+            lpc_residual(samples, i, predictor_order, shift, coefficients);
+    }
+}
+
+CPU_TARGET("avx2") static void
+lpc_residuals_avx2(unsigned sample_count,
+                   const int samples[],
+                   unsigned predictor_order,
+                   int shift,
+                   const int coefficients[],
+                   int residuals[])
+{
+    const __m128i shift_count = _mm_cvtsi32_si128(shift);
+    unsigned i;
+
+    for (i = predictor_order; (i + 8) <= sample_count; i += 8) {
+        __m256i sum = _mm256_setzero_si256();
+        unsigned j;
+        for (j = 0; j < predictor_order; j++) {
+            const __m256i previous =
+                _mm256_loadu_si256((const __m256i*)(samples + i - j - 1));
+            sum = _mm256_add_epi32(
+                sum,
+                _mm256_mullo_epi32(_mm256_set1_epi32(coefficients[j]),
+                                   previous));
+        }
+        sum = _mm256_sra_epi32(sum, shift_count);
+        _mm256_storeu_si256(
+            (__m256i*)(residuals + i - predictor_order),
+            _mm256_sub_epi32(
+                _mm256_loadu_si256((const __m256i*)(samples + i)), sum));
+    }
+
+    for (; i < sample_count; i++) {
+        residuals[i - predictor_order] =
+            lpc_residual(samples, i, predictor_order, shift, coefficients);
+    }
+}
+#elif defined(CPU_ARM_NEON)
+static void
+lpc_residuals_neon(unsigned sample_count,
+                   const int samples[],
+                   unsigned predictor_order,
+                   int shift,
+                   const int coefficients[],
+                   int residuals[])
+{
+    /*shifting left by a negative amount is an arithmetic right shift*/
+    const int32x4_t shift_count = vdupq_n_s32(-shift);
+    unsigned i;
+
+    for (i = predictor_order; (i + 4) <= sample_count; i += 4) {
+        int32x4_t sum = vdupq_n_s32(0);
+        unsigned j;
+        for (j = 0; j < predictor_order; j++) {
+            sum = vmlaq_n_s32(sum, vld1q_s32(samples + i - j - 1),
+                              coefficients[j]);
+        }
+        sum = vshlq_s32(sum, shift_count);
+        vst1q_s32(residuals + i - predictor_order,
+                  vsubq_s32(vld1q_s32(samples + i), sum));
+    }
+
+    for (; i < sample_count; i++) {
+        residuals[i - predictor_order] =
+            lpc_residual(samples, i, predictor_order, shift, coefficients);
+    }
+}
+#endif
+
+void
+flacenc_init_dispatch(void)
+{
+    lpc_residuals_32 = lpc_residuals_scalar;
+#if defined(CPU_X86)
+    const unsigned features = cpu_features();
+
+    if (features & CPU_AVX2) {
+        lpc_residuals_32 = lpc_residuals_avx2;
+    } else if (features & CPU_SSE4_1) {
+        lpc_residuals_32 = lpc_residuals_sse4_1;
+    }
+#elif defined(CPU_ARM_NEON)
+    if (cpu_features() & CPU_NEON) {
+        lpc_residuals_32 = lpc_residuals_neon;
+    }
+#endif
+}
+
 static void
 calculate_best_lpc_params(const struct flac_encoding_options *options,
                           unsigned sample_count,
@@ -1738,7 +2662,10 @@ calculate_best_lpc_params(const struct flac_encoding_options *options,
         double windowed_signal[sample_count];
         double autocorrelated[options->max_lpc_order + 1];
 
-        window_signal(sample_count, samples, options->window, windowed_signal);
+        window_signal(sample_count,
+                      samples,
+                      block_window(options, sample_count),
+                      windowed_signal);
 
         compute_autocorrelation_values(sample_count,
                                        windowed_signal,
@@ -1783,13 +2710,9 @@ calculate_best_lpc_params(const struct flac_encoding_options *options,
                 unsigned best_subframe_size = UINT_MAX;
 
                 for (order = 1; order <= max_lpc_order; order++) {
-                    BitstreamAccumulator *subframe =
-                        bw_open_limited_accumulator(
-                            BS_BIG_ENDIAN,
-                            best_subframe_size == UINT_MAX ?
-                            0 : best_subframe_size);
                     int candidate_coeff[order];
                     int candidate_shift;
+                    unsigned subframe_size;
 
                     quantize_lp_coefficients(order,
                                              lp_coeff,
@@ -1797,42 +2720,50 @@ calculate_best_lpc_params(const struct flac_encoding_options *options,
                                              candidate_coeff,
                                              &candidate_shift);
 
-                    if (!setjmp(*bw_try((BitstreamWriter*)subframe))) {
-                        write_lpc_subframe((BitstreamWriter*)subframe,
-                                           options,
-                                           sample_count,
-                                           samples,
-                                           bits_per_sample,
-                                           order,
-                                           *precision,
-                                           candidate_shift,
-                                           candidate_coeff);
-
-                        bw_etry((BitstreamWriter*)subframe);
-
-                        if (subframe->bits_written(subframe) <
-                            best_subframe_size) {
-                            /*and use values which generate
-                              the smallest LPC subframe when written*/
-                            *predictor_order = order;
-                            *shift = candidate_shift;
-                            memcpy(coefficients,
-                                   candidate_coeff,
-                                   order * sizeof(int));
-                            best_subframe_size =
-                                subframe->bits_written(subframe);
-                        }
-                    } else {
-                        bw_etry((BitstreamWriter*)subframe);
+                    subframe_size = lpc_subframe_bits(options,
+                                                      sample_count,
+                                                      samples,
+                                                      bits_per_sample,
+                                                      0,
+                                                      order,
+                                                      *precision,
+                                                      candidate_shift,
+                                                      candidate_coeff);
+
+                    if (subframe_size < best_subframe_size) {
+                        /*and use values which generate
+                          the smallest LPC subframe when written*/
+                        *predictor_order = order;
+                        *shift = candidate_shift;
+                        memcpy(coefficients,
+                               candidate_coeff,
+                               order * sizeof(int));
+                        best_subframe_size = subframe_size;
                     }
-
-                    subframe->close(subframe);
                 }
             }
         }
     }
 }
 
+static const double*
+block_window(const struct flac_encoding_options *options,
+             unsigned sample_count)
+{
+    unsigned i;
+
+    /*split blocks get a window of their own
+      while short blocks use the start of the full-sized one*/
+    for (i = 0; i < FLAC_MAX_BLOCK_SPLITS; i++) {
+        if (options->split_window[i] &&
+            (sample_count == (options->block_size >> (i + 1)))) {
+            return options->split_window[i];
+        }
+    }
+
+    return options->window;
+}
+
 static void
 window_signal(unsigned sample_count,
               const int samples[],
@@ -1972,7 +2903,7 @@ write_residual_block(BitstreamWriter *output,
     unsigned partition_order = 0;
     unsigned partition_count;
     unsigned rice_parameters[1 << options->max_residual_partition_order];
-    unsigned coding = 0;
+    unsigned coding;
     unsigned p;
     unsigned i = 0;
 
@@ -1986,81 +2917,142 @@ write_residual_block(BitstreamWriter *output,
     partition_count = 1 << partition_order;
 
     /*adjust coding method for large Rice parameters*/
-    for (p = 0; p < partition_count; p++) {
-        if (rice_parameters[p] > 14) {
-            coding = 1;
-        }
-    }
+    coding = residual_coding_method(partition_count, rice_parameters);
 
     output->write(output, 2, coding);
     output->write(output, 4, partition_order);
 
     /*write residual partition(s)*/
     for (p = 0; p < partition_count; p++) {
-        unsigned partition_size =
+        const unsigned partition_size =
             (sample_count / partition_count) - (p == 0 ? predictor_order : 0);
+        unsigned escape_bits;
 
-        if (options->use_verbatim || (partition_size == 0)) {
-            /*if our residuals get too large,
-              count on the VERBATIM subframe to bail us out*/
+        residual_partition_bits(options,
+                                coding,
+                                rice_parameters[p],
+                                partition_size,
+                                residuals + i,
+                                &escape_bits);
 
+        if (escape_bits) {
+            write_uncompressed_residual_partition(
+                output,
+                coding,
+                escape_bits,
+                partition_size,
+                residuals + i);
+        } else {
             write_compressed_residual_partition(
                 output,
                 coding,
                 rice_parameters[p],
                 partition_size,
                 residuals + i);
+        }
 
-            i += partition_size;
-        } else {
-            /*if VERBATIM isn't an option,
-              switch to escaped values if our residuals get too large*/
+        i += partition_size;
+    }
+}
 
-            const unsigned max_bits =
-                largest_residual_bits(residuals + i, partition_size);
+static unsigned
+residual_block_bits(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    unsigned predictor_order,
+                    const int residuals[])
+{
+    unsigned partition_order = 0;
+    unsigned partition_count;
+    unsigned rice_parameters[1 << options->max_residual_partition_order];
+    unsigned coding;
+    unsigned block_size = 2 + 4;
+    unsigned p;
+    unsigned i = 0;
 
-            BitstreamRecorder *partition =
-                bw_open_limited_recorder(BS_BIG_ENDIAN,
-                                         max_bits * partition_size);
+    best_rice_parameters(options,
+                         sample_count,
+                         predictor_order,
+                         residuals,
+                         &partition_order,
+                         rice_parameters);
 
-            BitstreamWriter *partition_w = (BitstreamWriter*)partition;
+    partition_count = 1 << partition_order;
 
-            if (!setjmp(*bw_try(partition_w))) {
-                write_compressed_residual_partition(
-                    partition_w,
-                    coding,
-                    rice_parameters[p],
-                    partition_size,
-                    residuals + i);
+    coding = residual_coding_method(partition_count, rice_parameters);
 
-                i += partition_size;
+    for (p = 0; p < partition_count; p++) {
+        const unsigned partition_size =
+            (sample_count / partition_count) - (p == 0 ? predictor_order : 0);
+        unsigned escape_bits;
 
-                bw_etry(partition_w);
+        block_size += residual_partition_bits(options,
+                                              coding,
+                                              rice_parameters[p],
+                                              partition_size,
+                                              residuals + i,
+                                              &escape_bits);
 
-                /*ensure partition is closed
-                  even if the dump to output should fail*/
-                if (!setjmp(*bw_try(output))) {
-                    partition->copy(partition, output);
-                    bw_etry(output);
-                    partition->close(partition);
-                } else {
-                    bw_etry(output);
-                    partition->close(partition);
-                    bw_abort(output);
-                }
-            } else {
-                /*partition too large, so switch to escaped values*/
-                bw_etry(partition_w);
-                partition->close(partition);
-
-                write_uncompressed_residual_partition(
-                    output,
-                    coding,
-                    max_bits,
-                    partition_size,
-                    residuals + i);
-                i += partition_size;
-            }
+        i += partition_size;
+    }
+
+    return block_size;
+}
+
+static unsigned
+residual_coding_method(unsigned partition_count,
+                       const unsigned rice_parameters[])
+{
+    unsigned p;
+
+    for (p = 0; p < partition_count; p++) {
+        if (rice_parameters[p] > 14) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static unsigned
+residual_partition_bits(const struct flac_encoding_options *options,
+                        unsigned coding_method,
+                        unsigned rice_parameter,
+                        unsigned partition_size,
+                        const int residuals[],
+                        unsigned *escape_bits)
+{
+    /*each residual is written as a unary-coded MSB with its stop bit
+      followed by "rice_parameter" LSBs*/
+    unsigned compressed_size =
+        (coding_method ? 5 : 4) + ((1 + rice_parameter) * partition_size);
+    unsigned i;
+
+    for (i = 0; i < partition_size; i++) {
+        const unsigned unsigned_ =
+            residuals[i] >= 0 ?
+            (unsigned)residuals[i] << 1 :
+            ((unsigned)(-residuals[i] - 1) << 1) + 1;
+
+        compressed_size += unsigned_ >> rice_parameter;
+    }
+
+    *escape_bits = 0;
+
+    if (options->use_verbatim || (partition_size == 0)) {
+        /*if our residuals get too large,
+          count on the VERBATIM subframe to bail us out*/
+        return compressed_size;
+    } else {
+        /*if VERBATIM isn't an option,
+          switch to escaped values if our residuals get too large*/
+        const unsigned max_bits =
+            largest_residual_bits(residuals, partition_size);
+
+        if (compressed_size <= (max_bits * partition_size)) {
+            return compressed_size;
+        } else {
+            *escape_bits = max_bits;
+            return (coding_method ? 5 : 4) + 5 + (max_bits * partition_size);
         }
     }
 }
@@ -2129,31 +3121,44 @@ best_rice_parameters(const struct flac_encoding_options *options,
             maximum_partition_order(sample_count,
                                     predictor_order,
                                     options->max_residual_partition_order);
-        unsigned i;
+        const unsigned max_partition_count = 1 << max_p_order;
+        uint64_t partition_sums[max_partition_count];
+        unsigned partition_bits[max_partition_count];
         unsigned best_total_size = UINT_MAX;
+        unsigned i;
+        unsigned p;
+        unsigned start = 0;
+
+        /*sum the residuals in each partition once, at the highest order
+          along with each partition's escaped size, if needed*/
+        for (p = 0; p < max_partition_count; p++) {
+            const unsigned partition_samples =
+                (sample_count / max_partition_count) -
+                ((p == 0) ? predictor_order : 0);
+
+            partition_sums[p] = abs_sum(partition_samples, residuals + start);
+            if (!options->use_verbatim) {
+                partition_bits[p] =
+                    largest_residual_bits(residuals + start,
+                                          partition_samples);
+            }
+            start += partition_samples;
+        }
 
-        for (i = 0; i <= max_p_order; i++) {
+        /*then work down from the highest order
+          with each lower order's sums being pairs of the one above*/
+        for (i = max_p_order; ; i--) {
             const unsigned partition_count = 1 << i;
             unsigned p_rice[partition_count];
             unsigned total_partitions_size = 0;
-            unsigned p;
 
             for (p = 0; p < partition_count; p++) {
                 const unsigned partition_samples =
                     (sample_count / partition_count) -
                     ((p == 0) ? predictor_order : 0);
-                const unsigned start =
-                    (p == 0) ? 0 :
-                    p * sample_count / partition_count - predictor_order;
-                const unsigned end = start + partition_samples;
-                register unsigned j;
-                register unsigned partition_sum = 0;
+                const uint64_t partition_sum = partition_sums[p];
                 unsigned partition_size;
 
-                for (j = start; j < end; j++) {
-                    partition_sum += abs(residuals[j]);
-                }
-
                 if (partition_sum > partition_samples) {
                     p_rice[p] =
                         ceil(log2((double)partition_sum /
@@ -2168,21 +3173,44 @@ best_rice_parameters(const struct flac_encoding_options *options,
                 partition_size =
                     4 +
                     ((1 + p_rice[p]) * partition_samples) +
-                    ((p_rice[p] > 0) ?
+                    (unsigned)((p_rice[p] > 0) ?
                     (partition_sum >> (p_rice[p] - 1)) :
                     (partition_sum << 1)) -
                     (partition_samples / 2);
 
+                if (!options->use_verbatim && partition_samples) {
+                    /*without VERBATIM subframes to fall back on,
+                      overly large partitions are written escaped*/
+                    partition_size =
+                        MIN(partition_size,
+                            4 + 5 + partition_bits[p] * partition_samples);
+                }
+
                 total_partitions_size += partition_size;
             }
 
-            if (total_partitions_size < best_total_size) {
+            /*lower orders are preferred when sizes tie*/
+            if (total_partitions_size <= best_total_size) {
                 best_total_size = total_partitions_size;
                 *partition_order = i;
                 memcpy(rice_parameters,
                        p_rice,
                        sizeof(unsigned) * partition_count);
             }
+
+            if (i == 0) {
+                break;
+            } else {
+                /*merge adjacent partitions in place for the next order*/
+                for (p = 0; p < partition_count / 2; p++) {
+                    partition_sums[p] =
+                        partition_sums[p * 2] + partition_sums[p * 2 + 1];
+                    if (!options->use_verbatim) {
+                        partition_bits[p] = MAX(partition_bits[p * 2],
+                                                partition_bits[p * 2 + 1]);
+                    }
+                }
+            }
         }
     }
 }
@@ -2254,6 +3282,29 @@ frame_sizes_info(const struct flac_frame_size *sizes,
     }
 }
 
+static void
+block_sizes_info(const struct flac_frame_size *sizes,
+                 const struct flac_encoding_options *options,
+                 unsigned *minimum_block_size,
+                 unsigned *maximum_block_size)
+{
+    if (options->variable_block_size && sizes) {
+        *minimum_block_size = *maximum_block_size = sizes->pcm_frames_size;
+
+        for (sizes = sizes->next; sizes; sizes = sizes->next) {
+            /*the final frame doesn't count toward the minimum*/
+            if (sizes->next) {
+                *minimum_block_size =
+                    MIN(*minimum_block_size, sizes->pcm_frames_size);
+            }
+            *maximum_block_size =
+                MAX(*maximum_block_size, sizes->pcm_frames_size);
+        }
+    } else {
+        *minimum_block_size = *maximum_block_size = options->block_size;
+    }
+}
+
 static void
 free_frame_sizes(struct flac_frame_size *sizes)
 {
@@ -2308,6 +3359,45 @@ calculate_wasted_bps(unsigned sample_count, const int *samples)
     return (wasted_bps < UINT_MAX) ? wasted_bps : 0;
 }
 
+static void
+init_windows(struct flac_encoding_options *options)
+{
+    unsigned i;
+
+    for (i = 0; i < FLAC_MAX_BLOCK_SPLITS; i++) {
+        options->split_window[i] = NULL;
+    }
+
+    if (options->max_lpc_order) {
+        options->window = malloc(sizeof(double) * options->block_size);
+        tukey_window(0.5, options->block_size, options->window);
+
+        if (options->variable_block_size) {
+            for (i = 0; i < FLAC_MAX_BLOCK_SPLITS; i++) {
+                const unsigned split_size = options->block_size >> (i + 1);
+                if (split_size >= 16) {
+                    options->split_window[i] =
+                        malloc(sizeof(double) * split_size);
+                    tukey_window(0.5, split_size, options->split_window[i]);
+                }
+            }
+        }
+    } else {
+        options->window = NULL;
+    }
+}
+
+static void
+free_windows(struct flac_encoding_options *options)
+{
+    unsigned i;
+
+    free(options->window);
+    for (i = 0; i < FLAC_MAX_BLOCK_SPLITS; i++) {
+        free(options->split_window[i]);
+    }
+}
+
 static void
 tukey_window(double alpha, unsigned block_size, double *window)
 {
@@ -2379,6 +3469,8 @@ int main(int argc, char *argv[])
          &options.adaptive_mid_side, 1},
         {"exhaustive-model-search", no_argument,
          &options.exhaustive_model_search, 1},
+        {"variable-block-size",     no_argument,
+         &options.variable_block_size, 1},
         {"disable-verbatim-subframes", no_argument,
          &options.use_verbatim, 0},
         {"disable-constant-subframes", no_argument,
@@ -2387,8 +3479,9 @@ int main(int argc, char *argv[])
          &options.use_fixed, 0},
         {NULL,                      no_argument,       NULL,  0}
     };
-    const static char* short_opts = "-hc:r:b:T:B:l:P:R:mMe";
+    const static char* short_opts = "-hc:r:b:T:B:l:P:R:mMeV";
 
+    flacenc_init_dispatch();
     flacenc_init_options(&options);
 
     errno = 0;
@@ -2468,6 +3561,9 @@ int main(int argc, char *argv[])
         case 'e':
             options.exhaustive_model_search = 1;
             break;
+        case 'V':
+            options.variable_block_size = 1;
+            break;
         case 'h': /*fallthrough*/
         case ':':
         case '?':
@@ -2487,6 +3583,8 @@ int main(int argc, char *argv[])
             printf("-m, --mid-side                  use mid-side encoding\n");
             printf("-e, --exhaustive-model-search   "
                    "search for best subframe exhaustively\n");
+            printf("-V, --variable-block-size       "
+                   "vary block size up to --block-size\n");
             return 0;
         default:
             break;
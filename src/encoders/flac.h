@@ -30,6 +30,10 @@ typedef enum {
     FLAC_NO_TEMPFILE   /*unable to open temporary file*/
 } flacenc_status_t;
 
+/*the number of times a block may be halved
+  when variable block sizes are in use*/
+#define FLAC_MAX_BLOCK_SPLITS 2
+
 struct flac_encoding_options {
     unsigned block_size;                    /*typically 1152 or 4096*/
     unsigned min_residual_partition_order;  /*typically 0*/
@@ -38,6 +42,7 @@ struct flac_encoding_options {
     int exhaustive_model_search;            /*a boolean*/
     int mid_side;                           /*a boolean*/
     int adaptive_mid_side;                  /*a boolean*/
+    int variable_block_size;                /*a boolean, block_size is largest*/
 
     int use_verbatim;                       /*a boolean for debugging*/
     int use_constant;                       /*a boolean for debugging*/
@@ -46,12 +51,18 @@ struct flac_encoding_options {
     unsigned qlp_coeff_precision;           /*derived from block size*/
     unsigned max_rice_parameter;            /*derived from bits-per-sample*/
     double *window;                         /*for windowing input samples*/
+    double *split_window[FLAC_MAX_BLOCK_SPLITS]; /*for split blocks, if any*/
 };
 
 /*sets the encoding options to sensible defaults*/
 void
 flacenc_init_options(struct flac_encoding_options *options);
 
+/*picks the fastest LPC kernels the CPU supports,
+  to be called once before encoding*/
+void
+flacenc_init_dispatch(void);
+
 /*displays the encoding options for debugging purposes*/
 void
 flacenc_display_options(const struct flac_encoding_options *options,
@@ -60,7 +71,18 @@ flacenc_display_options(const struct flac_encoding_options *options,
 
 /*encodes a FLAC file using data from the given PCMReader
   to the given output stream
-  using the given options*/
+  using the given options
+
+  if total_pcm_frames is 0 and the stream is seekable,
+  frames are written directly to the stream
+  and metadata is rewritten once encoding is finished
+  while unseekable streams buffer frames in a temporary file
+
+  in every case, metadata blocks are written in the order
+  STREAMINFO, SEEKTABLE, VORBIS_COMMENT and "padding_size" bytes of PADDING
+  though a stream written directly without a known length
+  may also have PADDING after its SEEKTABLE
+  for the reserved seekpoints it didn't use*/
 flacenc_status_t
 flacenc_encode_flac(struct PCMReader *pcmreader,
                     BitstreamWriter *output,
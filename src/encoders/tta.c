@@ -1,5 +1,8 @@
 #include "tta.h"
 #include "../common/tta_crc.h"
+#include "../common/tta_filter.h"
+#include "../common/stats.h"
+#include <pthread.h>
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -41,6 +44,19 @@ struct residual_params {
     int sum1;
 };
 
+/*a single TTA frame to be encoded on its own thread*/
+struct encode_job {
+    unsigned bits_per_sample;
+    unsigned channels;
+    unsigned block_size;
+    int *samples;
+    BitstreamRecorder *output;
+
+    /*the thread running this job, if started*/
+    pthread_t worker;
+    int started;
+};
+
 /*******************************
  * private function signatures *
  *******************************/
@@ -76,6 +92,21 @@ encode_frame(unsigned bits_per_sample,
              const int samples[],
              BitstreamWriter *output);
 
+/*encodes TTA frames from pcmreader to output
+  in batches of "threads" frames at a time*/
+static struct tta_frame_size*
+encode_tta_frames_threaded(struct PCMReader *pcmreader,
+                           BitstreamWriter *output,
+                           unsigned threads);
+
+static void*
+encode_frame_job(struct encode_job *job);
+
+/*runs all the given jobs to completion,
+  the first on the current thread and the rest on new threads*/
+static void
+run_encode_jobs(unsigned count, struct encode_job jobs[]);
+
 /*given a PCM frame's worth of samples and channel count,
   correlates the samples*/
 static void
@@ -125,25 +156,49 @@ reverse_frame_sizes(struct tta_frame_size **stack);
 
 struct tta_frame_size*
 ttaenc_encode_tta_frames(struct PCMReader *pcmreader,
-                         BitstreamWriter *output)
+                         BitstreamWriter *output,
+                         unsigned threads)
 {
     struct tta_frame_size *frame_sizes = NULL;
     const unsigned default_block_size = tta_block_size(pcmreader->sample_rate);
     unsigned block_size;
     unsigned frame_size = 0;
-    int *samples = malloc(default_block_size *
+    int *samples;
+
+    if (threads > 1) {
+        return encode_tta_frames_threaded(pcmreader, output, threads);
+    }
+
+    if ((samples = malloc((size_t)default_block_size *
                           pcmreader->channels *
-                          sizeof(int));
+                          sizeof(int))) == NULL) {
+#ifndef STANDALONE
+        PyErr_NoMemory();
+#endif
+        return NULL;
+    }
 
     output->add_callback(output, (bs_callback_f)byte_counter, &frame_size);
 
-    while ((block_size =
-            pcmreader->read(pcmreader, default_block_size, samples)) > 0) {
-        encode_frame(pcmreader->bits_per_sample,
-                     pcmreader->channels,
-                     block_size,
-                     samples,
-                     output);
+    for (;;) {
+        STATS_START(read_timer);
+        block_size = pcmreader->read(pcmreader, default_block_size, samples);
+        STATS_STOP(read_timer,
+                   STATS_TTA_ENCODE_READ,
+                   block_size * pcmreader->channels);
+        if (block_size == 0) {
+            break;
+        } else {
+            STATS_START(frame_timer);
+            encode_frame(pcmreader->bits_per_sample,
+                         pcmreader->channels,
+                         block_size,
+                         samples,
+                         output);
+            STATS_STOP(frame_timer,
+                       STATS_TTA_ENCODE_FRAME,
+                       block_size * pcmreader->channels);
+        }
         frame_sizes = append_size(frame_sizes, block_size, frame_size);
         frame_size = 0;
     }
@@ -279,6 +334,133 @@ encode_frame(unsigned bits_per_sample,
     output->write(output, 32, crc32 ^ 0xFFFFFFFF);
 }
 
+static struct tta_frame_size*
+encode_tta_frames_threaded(struct PCMReader *pcmreader,
+                           BitstreamWriter *output,
+                           unsigned threads)
+{
+    struct tta_frame_size *frame_sizes = NULL;
+    const unsigned default_block_size = tta_block_size(pcmreader->sample_rate);
+    const size_t block_samples = (size_t)default_block_size *
+                                 pcmreader->channels;
+    int *samples;
+    struct encode_job *jobs;
+    unsigned count;
+    unsigned i;
+
+    assert(threads <= TTA_MAX_THREADS);
+
+    samples = malloc((size_t)threads * block_samples * sizeof(int));
+    jobs = malloc(threads * sizeof(struct encode_job));
+    if ((samples == NULL) || (jobs == NULL)) {
+        free(samples);
+        free(jobs);
+#ifndef STANDALONE
+        PyErr_NoMemory();
+#endif
+        return NULL;
+    }
+
+    for (i = 0; i < threads; i++) {
+        jobs[i].bits_per_sample = pcmreader->bits_per_sample;
+        jobs[i].channels = pcmreader->channels;
+        jobs[i].block_size = 0;
+        jobs[i].samples = samples + (i * block_samples);
+        jobs[i].output = bw_open_bytes_recorder(BS_LITTLE_ENDIAN);
+    }
+
+    do {
+        /*read up to one TTA frame's worth of samples per job
+          exactly as the serial encoder would*/
+        for (count = 0; count < threads; count++) {
+            STATS_START(read_timer);
+            jobs[count].block_size = pcmreader->read(pcmreader,
+                                                     default_block_size,
+                                                     jobs[count].samples);
+            STATS_STOP(read_timer,
+                       STATS_TTA_ENCODE_READ,
+                       jobs[count].block_size * pcmreader->channels);
+            if (jobs[count].block_size == 0) {
+                break;
+            }
+        }
+
+        if (count) {
+            /*encoding touches no Python objects*/
+#ifndef STANDALONE
+            Py_BEGIN_ALLOW_THREADS
+#endif
+            run_encode_jobs(count, jobs);
+#ifndef STANDALONE
+            Py_END_ALLOW_THREADS
+#endif
+
+            /*then output encoded frames in order*/
+            for (i = 0; i < count; i++) {
+                BitstreamRecorder *frame = jobs[i].output;
+                frame->copy(frame, output);
+                frame_sizes = append_size(frame_sizes,
+                                          jobs[i].block_size,
+                                          frame->bytes_written(frame));
+                frame->reset(frame);
+            }
+        }
+    } while (count == threads);
+
+    for (i = 0; i < threads; i++) {
+        jobs[i].output->close(jobs[i].output);
+    }
+    free(jobs);
+    free(samples);
+
+    if (pcmreader->status == PCM_OK) {
+        reverse_frame_sizes(&frame_sizes);
+        return frame_sizes;
+    } else {
+        free_tta_frame_sizes(frame_sizes);
+        return NULL;
+    }
+}
+
+static void*
+encode_frame_job(struct encode_job *job)
+{
+    STATS_START(frame_timer);
+    encode_frame(job->bits_per_sample,
+                 job->channels,
+                 job->block_size,
+                 job->samples,
+                 (BitstreamWriter*)job->output);
+    STATS_STOP(frame_timer,
+               STATS_TTA_ENCODE_FRAME,
+               job->block_size * job->channels);
+    return NULL;
+}
+
+static void
+run_encode_jobs(unsigned count, struct encode_job jobs[])
+{
+    unsigned i;
+
+    for (i = 1; i < count; i++) {
+        jobs[i].started = !pthread_create(&jobs[i].worker,
+                                          NULL,
+                                          (void*(*)(void*))encode_frame_job,
+                                          &jobs[i]);
+    }
+
+    encode_frame_job(&jobs[0]);
+
+    for (i = 1; i < count; i++) {
+        if (jobs[i].started) {
+            pthread_join(jobs[i].worker, NULL);
+        } else {
+            /*if a thread can't be started, run its job here instead*/
+            encode_frame_job(&jobs[i]);
+        }
+    }
+}
+
 static void
 correlate_channels(unsigned channel_count,
                    const int samples[],
@@ -369,53 +551,18 @@ init_filter_params(unsigned bits_per_sample,
     params->dl[7] = 0;
 }
 
-static inline int
-sign(int x) {
-    if (x > 0) {
-        return 1;
-    } else if (x < 0) {
-        return -1;
-    } else {
-        return 0;
-    }
-}
-
 static int
 run_filter(struct filter_params *params, int predicted)
 {
-    const int previous_sign = sign(params->previous_residual);
-    register int32_t sum = params->round;
-    int residual = predicted;
-
-    sum += params->dl[0] * (params->qm[0] += previous_sign * params->dx[0]);
-    sum += params->dl[1] * (params->qm[1] += previous_sign * params->dx[1]);
-    sum += params->dl[2] * (params->qm[2] += previous_sign * params->dx[2]);
-    sum += params->dl[3] * (params->qm[3] += previous_sign * params->dx[3]);
-    sum += params->dl[4] * (params->qm[4] += previous_sign * params->dx[4]);
-    sum += params->dl[5] * (params->qm[5] += previous_sign * params->dx[5]);
-    sum += params->dl[6] * (params->qm[6] += previous_sign * params->dx[6]);
-    sum += params->dl[7] * (params->qm[7] += previous_sign * params->dx[7]);
-
-    residual -= (sum >> params->shift);
-    params->previous_residual = residual;
+    const int32_t sum =
+        params->round + tta_filter_predict(params->qm,
+                                           params->dx,
+                                           params->dl,
+                                           tta_sign(params->previous_residual));
+    const int residual = predicted - (sum >> params->shift);
 
-    params->dx[0] = params->dx[1];
-    params->dx[1] = params->dx[2];
-    params->dx[2] = params->dx[3];
-    params->dx[3] = params->dx[4];
-    params->dx[4] = params->dl[4] >= 0 ? 1 : -1;
-    params->dx[5] = params->dl[5] >= 0 ? 2 : -2;
-    params->dx[6] = params->dl[6] >= 0 ? 2 : -2;
-    params->dx[7] = params->dl[7] >= 0 ? 4 : -4;
-    params->dl[0] = params->dl[1];
-    params->dl[1] = params->dl[2];
-    params->dl[2] = params->dl[3];
-    params->dl[3] = params->dl[4];
-    params->dl[4] =
-        -(params->dl[5]) + (-(params->dl[6]) + (predicted - params->dl[7]));
-    params->dl[5] = -(params->dl[6]) + (predicted - params->dl[7]);
-    params->dl[6] = predicted - params->dl[7];
-    params->dl[7] = predicted;
+    params->previous_residual = residual;
+    tta_filter_update(params->dx, params->dl, predicted);
 
     return residual;
 }
@@ -502,18 +649,24 @@ encoders_encode_tta(PyObject *dummy, PyObject *args, PyObject *keywds)
     const long long maximum_pcm_frames = 0xFFFFFFFFll;
     BitstreamWriter *output;
     struct tta_frame_size *frame_sizes;
-    static char *kwlist[] = {"file", "pcmreader", "total_pcm_frames", NULL};
+    int threads = 1;
+    static char *kwlist[] = {"file",
+                             "pcmreader",
+                             "total_pcm_frames",
+                             "threads",
+                             NULL};
 
     if (!PyArg_ParseTupleAndKeywords(
-            args, keywds, "OO&|L", kwlist,
+            args, keywds, "OO&|Li", kwlist,
             &file_obj,
             py_obj_to_pcmreader,
             &pcmreader,
-            &total_pcm_frames)) {
+            &total_pcm_frames,
+            &threads)) {
         return NULL;
     }
 
-    /*sanity check total PCM frames*/
+    /*sanity check total PCM frames and thread count*/
     if (total_pcm_frames < 0) {
         PyErr_SetString(PyExc_ValueError,
                         "total_pcm_frames must be >= 0");
@@ -522,6 +675,11 @@ encoders_encode_tta(PyObject *dummy, PyObject *args, PyObject *keywds)
         PyErr_SetString(PyExc_ValueError,
                         "total_pcm_frames must be <= 0xFFFFFFFF");
         return NULL;
+    } else if ((threads < 1) || (threads > TTA_MAX_THREADS)) {
+        PyErr_Format(PyExc_ValueError,
+                     "threads must be between 1 and %d",
+                     TTA_MAX_THREADS);
+        return NULL;
     }
 
     /*wrap BitstreamWriter around file object*/
@@ -562,9 +720,14 @@ encoders_encode_tta(PyObject *dummy, PyObject *args, PyObject *keywds)
 
         /*write frames*/
         if ((frame_sizes =
-             ttaenc_encode_tta_frames(pcmreader, output)) == NULL) {
+             ttaenc_encode_tta_frames(pcmreader,
+                                      output,
+                                      (unsigned)threads)) == NULL) {
             seektable_pos->del(seektable_pos);
-            PyErr_SetString(PyExc_IOError, "read error during encoding");
+            /*keep MemoryError, otherwise it's a read error*/
+            if (!PyErr_ExceptionMatches(PyExc_MemoryError)) {
+                PyErr_SetString(PyExc_IOError, "read error during encoding");
+            }
             goto error;
         }
 
@@ -597,10 +760,15 @@ encoders_encode_tta(PyObject *dummy, PyObject *args, PyObject *keywds)
         }
 
         /*write frames to temporary space*/
-        frame_sizes = ttaenc_encode_tta_frames(pcmreader, tempwriter);
+        frame_sizes = ttaenc_encode_tta_frames(pcmreader,
+                                               tempwriter,
+                                               (unsigned)threads);
         tempwriter->free(tempwriter);
         if (!frame_sizes) {
-            PyErr_SetString(PyExc_IOError, "read error during encoding");
+            /*keep MemoryError, otherwise it's a read error*/
+            if (!PyErr_ExceptionMatches(PyExc_MemoryError)) {
+                PyErr_SetString(PyExc_IOError, "read error during encoding");
+            }
             goto error;
         }
 
@@ -661,6 +829,7 @@ main(int argc, char* argv[]) {
     unsigned sample_rate = 44100;
     unsigned bits_per_sample = 16;
     unsigned total_pcm_frames = 0;
+    unsigned threads = 1;
 
     struct PCMReader *pcmreader;
     BitstreamWriter *output;
@@ -678,8 +847,9 @@ main(int argc, char* argv[]) {
         {"sample-rate",             required_argument, NULL, 'r'},
         {"bits-per-sample",         required_argument, NULL, 'b'},
         {"total-pcm-frames",        required_argument, NULL, 'T'},
+        {"threads",                 required_argument, NULL, 't'},
         {NULL,                      no_argument,       NULL, 0}};
-    const static char* short_opts = "-hc:r:b:T:";
+    const static char* short_opts = "-hc:r:b:T:t:";
 
     while ((c = getopt_long(argc,
                             argv,
@@ -720,6 +890,20 @@ main(int argc, char* argv[]) {
                 return 1;
             }
             break;
+        case 't':
+            {
+                char *end;
+                const long value = strtol(optarg, &end, 10);
+                if ((end == optarg) || *end ||
+                    (value < 1) || (value > TTA_MAX_THREADS)) {
+                    printf("--threads must be between 1 and %d\n",
+                           TTA_MAX_THREADS);
+                    return 1;
+                } else {
+                    threads = (unsigned)value;
+                }
+            }
+            break;
         case 'h': /*fallthrough*/
         case ':':
         case '?':
@@ -728,6 +912,7 @@ main(int argc, char* argv[]) {
             printf("-r, --sample_rate=#       input sample rate in Hz\n");
             printf("-b, --bits-per-sample=#   bits per input sample\n");
             printf("-T, --total-pcm-frames=#  total PCM frames of input\n");
+            printf("-t, --threads=#           TTA frames to encode at once\n");
             return 0;
         default:
             break;
@@ -780,7 +965,15 @@ main(int argc, char* argv[]) {
     output->write(output, 32, 0);
 
     /*write TTA frames*/
-    frame_sizes = ttaenc_encode_tta_frames(pcmreader, output);
+    if ((frame_sizes =
+         ttaenc_encode_tta_frames(pcmreader, output, threads)) == NULL) {
+        fprintf(stderr, "*** Error encoding TTA frames\n");
+        seektable_pos->del(seektable_pos);
+        output->close(output);
+        pcmreader->close(pcmreader);
+        pcmreader->del(pcmreader);
+        return 1;
+    }
 
     /*write finalized seektable*/
     output->setpos(output, seektable_pos);
@@ -24,6 +24,9 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+/*the most TTA frames encoded concurrently*/
+#define TTA_MAX_THREADS 64
+
 struct tta_frame_size {
     unsigned pcm_frames;
     unsigned byte_size;
@@ -35,10 +38,19 @@ struct tta_frame_size {
   which must be deallocated when no longer needed
   using free_tta_frame_sizes()
 
-  returns NULL if some error occurs reading from PCMReader*/
+  if threads > 1, up to that many TTA frames are encoded concurrently
+  (threads must be no more than TTA_MAX_THREADS)
+  and written to output in order
+  since every TTA frame starts from fresh prediction, filter
+  and residual parameters, the output is identical to a serial encode
+
+  returns NULL if some error occurs reading from PCMReader
+  or if memory can't be allocated,
+  in which case MemoryError is raised when built as a module*/
 struct tta_frame_size*
 ttaenc_encode_tta_frames(struct PCMReader *pcmreader,
-                         BitstreamWriter *output);
+                         BitstreamWriter *output,
+                         unsigned threads);
 
 /*given a list of TTA frame sizes, returns the total PCM frames*/
 unsigned
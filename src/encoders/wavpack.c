@@ -3,7 +3,6 @@
 #include <string.h>
 #include "../pcm_conv.h"
 #include "wavpack.h"
-#include <wavpack/wavpack.h>
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -40,6 +39,7 @@ encoders_encode_wavpack(PyObject *dummy, PyObject *args, PyObject *keywds)
                              "compression",
                              "wave_header",
                              "wave_footer",
+                             "threads",
                              NULL};
     char *filename;
     FILE *output_file = NULL;
@@ -58,12 +58,13 @@ encoders_encode_wavpack(PyObject *dummy, PyObject *args, PyObject *keywds)
 #endif
     uint8_t *header_data = NULL;
     uint8_t *footer_data = NULL;
+    int threads = 1;
     int result;
 
     if (!PyArg_ParseTupleAndKeywords(
             args,
             keywds,
-            "sO&|Liss#s#",
+            "sO&|Liss#s#i",
             kwlist,
             &filename,
             py_obj_to_pcmreader,
@@ -75,7 +76,8 @@ encoders_encode_wavpack(PyObject *dummy, PyObject *args, PyObject *keywds)
             &header_data,
             &header_len,
             &footer_data,
-            &footer_len)) {
+            &footer_len,
+            &threads)) {
         return NULL;
     }
 
@@ -97,6 +99,13 @@ encoders_encode_wavpack(PyObject *dummy, PyObject *args, PyObject *keywds)
         return NULL;
     }
 
+    if ((threads < 1) || (threads > WAVPACK_MAX_THREADS)) {
+        PyErr_Format(PyExc_ValueError,
+                     "threads must be between 1 and %d",
+                     WAVPACK_MAX_THREADS);
+        return NULL;
+    }
+
     /*open output file for writing*/
     errno = 0;
     if ((output_file = fopen(filename, "wb")) == NULL) {
@@ -115,7 +124,8 @@ encoders_encode_wavpack(PyObject *dummy, PyObject *args, PyObject *keywds)
                             (uint32_t)header_len,
                             header_data,
                             (uint32_t)footer_len,
-                            footer_data);
+                            footer_data,
+                            (unsigned)threads);
 
     /*cleanup PCMReader and output file*/
     output->close(output);
@@ -132,6 +142,8 @@ encoders_encode_wavpack(PyObject *dummy, PyObject *args, PyObject *keywds)
     case 2:
         PyErr_SetString(PyExc_ValueError, "total frames mismatch");
         return NULL;
+    case 3:
+        return PyErr_NoMemory();
     }
 }
 
@@ -156,59 +168,48 @@ encode_wavpack(BitstreamWriter *output,
                uint32_t header_size,
                uint8_t *header_data,
                uint32_t footer_size,
-               uint8_t *footer_data)
+               uint8_t *footer_data,
+               unsigned threads)
 {
     audiotools__MD5Context md5;
     unsigned char stream_md5[16];
     int *samples;
     unsigned pcm_frames_read;
     uint32_t total_frames_written = 0;
+    WavpackContext *context;
+    WavpackConfig config;
+
+    if (threads > 1) {
+        return encode_wavpack_threaded(output,
+                                       pcmreader,
+                                       total_pcm_frames,
+                                       block_size,
+                                       compression,
+                                       header_size,
+                                       header_data,
+                                       footer_size,
+                                       footer_data,
+                                       threads);
+    }
+
     audiotools__MD5Init(&md5);
 
     /*get context and set block output function*/
-    WavpackContext *context =
-        WavpackOpenFileOutput((WavpackBlockOutput)block_out,
-                              output,
-                              NULL);
-
-    WavpackConfig config;
+    context = WavpackOpenFileOutput((WavpackBlockOutput)block_out,
+                                    output,
+                                    NULL);
 
-    if (context) {
-        samples = malloc(pcmreader->channels * block_size * sizeof(int));
-    } else {
+    if (!context) {
         return 1;
+    } else if ((samples = malloc((size_t)pcmreader->channels *
+                                 block_size *
+                                 sizeof(int))) == NULL) {
+        WavpackCloseFile(context);
+        return 3;
     }
 
     /*set data format and encoding parameters*/
-    memset(&config, 0, sizeof(WavpackConfig));
-    config.bytes_per_sample = pcmreader->bits_per_sample / 8;
-    config.bits_per_sample = pcmreader->bits_per_sample;
-    if (pcmreader->channel_mask) {
-        config.channel_mask = pcmreader->channel_mask;
-    } else if (pcmreader->channels == 1) {
-        config.channel_mask = 0x4;
-    } else if (pcmreader->channels == 2) {
-        config.channel_mask = 0x3;
-    } else {
-        config.channel_mask = 0;
-    }
-    config.num_channels = pcmreader->channels;
-    config.sample_rate = pcmreader->sample_rate;
-    config.flags = CONFIG_MD5_CHECKSUM | CONFIG_OPTIMIZE_MONO;
-
-    switch (compression) {
-    default:
-        break;
-    case COMPRESSION_FAST:
-        config.flags |= CONFIG_FAST_FLAG;
-        break;
-    case COMPRESSION_HIGH:
-        config.flags |= CONFIG_HIGH_FLAG;
-        break;
-    case COMPRESSION_VERYHIGH:
-        config.flags |= CONFIG_VERY_HIGH_FLAG;
-        break;
-    }
+    init_config(&config, pcmreader, compression);
 
     if (!WavpackSetConfiguration(context,
                                  &config,
@@ -293,6 +294,304 @@ error:
     return 1;
 }
 
+static void
+init_config(WavpackConfig *config,
+            const struct PCMReader *pcmreader,
+            wavpack_compression_t compression)
+{
+    memset(config, 0, sizeof(WavpackConfig));
+    config->bytes_per_sample = pcmreader->bits_per_sample / 8;
+    config->bits_per_sample = pcmreader->bits_per_sample;
+    if (pcmreader->channel_mask) {
+        config->channel_mask = pcmreader->channel_mask;
+    } else if (pcmreader->channels == 1) {
+        config->channel_mask = 0x4;
+    } else if (pcmreader->channels == 2) {
+        config->channel_mask = 0x3;
+    } else {
+        config->channel_mask = 0;
+    }
+    config->num_channels = pcmreader->channels;
+    config->sample_rate = pcmreader->sample_rate;
+    config->flags = CONFIG_MD5_CHECKSUM | CONFIG_OPTIMIZE_MONO;
+
+    switch (compression) {
+    default:
+        break;
+    case COMPRESSION_FAST:
+        config->flags |= CONFIG_FAST_FLAG;
+        break;
+    case COMPRESSION_HIGH:
+        config->flags |= CONFIG_HIGH_FLAG;
+        break;
+    case COMPRESSION_VERYHIGH:
+        config->flags |= CONFIG_VERY_HIGH_FLAG;
+        break;
+    }
+}
+
+static int
+encode_wavpack_threaded(BitstreamWriter *output,
+                        struct PCMReader *pcmreader,
+                        uint32_t total_pcm_frames,
+                        unsigned block_size,
+                        wavpack_compression_t compression,
+                        uint32_t header_size,
+                        uint8_t *header_data,
+                        uint32_t footer_size,
+                        uint8_t *footer_data,
+                        unsigned threads)
+{
+    audiotools__MD5Context md5;
+    unsigned char stream_md5[16];
+    const size_t block_samples = (size_t)block_size * pcmreader->channels;
+    int *samples;
+    struct encode_job *jobs;
+    WavpackConfig config;
+    WavpackContext *context;
+    BitstreamRecorder *trailer;
+    uint64_t total_frames_written = 0;
+    int header_written = 0;
+    int result = 0;
+    unsigned count;
+    unsigned i;
+
+    samples = malloc((size_t)threads * block_samples * sizeof(int));
+    jobs = malloc(threads * sizeof(struct encode_job));
+    if ((samples == NULL) || (jobs == NULL)) {
+        free(samples);
+        free(jobs);
+        return 3;
+    }
+
+    audiotools__MD5Init(&md5);
+    init_config(&config, pcmreader, compression);
+
+    for (i = 0; i < threads; i++) {
+        jobs[i].config = &config;
+        jobs[i].total_pcm_frames = total_pcm_frames;
+        jobs[i].header_size = 0;
+        jobs[i].header_data = NULL;
+        jobs[i].samples = samples + (i * block_samples);
+        jobs[i].output = bw_open_bytes_recorder(BS_LITTLE_ENDIAN);
+    }
+
+    do {
+        /*read up to one block's worth of samples per job*/
+        for (count = 0; count < threads; count++) {
+            struct encode_job *job = &jobs[count];
+            if ((job->pcm_frames = pcmreader->read(pcmreader,
+                                                   block_size,
+                                                   job->samples)) == 0) {
+                break;
+            }
+            update_md5sum(&md5,
+                          job->samples,
+                          pcmreader->channels,
+                          pcmreader->bits_per_sample,
+                          job->pcm_frames);
+            job->block_index = total_frames_written;
+            total_frames_written += job->pcm_frames;
+        }
+
+        if (count) {
+            /*the RIFF header goes in the stream's very first block*/
+            if (!header_written) {
+                jobs[0].header_size = header_size;
+                jobs[0].header_data = header_data;
+                header_written = 1;
+            } else {
+                jobs[0].header_size = 0;
+                jobs[0].header_data = NULL;
+            }
+
+            /*encoding touches no Python objects*/
+#ifndef STANDALONE
+            Py_BEGIN_ALLOW_THREADS
+#endif
+            run_encode_jobs(count, jobs);
+#ifndef STANDALONE
+            Py_END_ALLOW_THREADS
+#endif
+
+            /*then output encoded blocks in order*/
+            for (i = 0; i < count; i++) {
+                if (jobs[i].status) {
+                    result = 1;
+                } else if (!result) {
+                    result = write_blocks(jobs[i].output,
+                                          jobs[i].block_index,
+                                          output);
+                }
+                jobs[i].output->reset(jobs[i].output);
+            }
+        }
+    } while ((count == threads) && !result);
+
+    for (i = 0; i < threads; i++) {
+        jobs[i].output->close(jobs[i].output);
+    }
+    free(jobs);
+    free(samples);
+
+    /*check for encode, allocation or read error*/
+    if (result) {
+        return result;
+    } else if (pcmreader->status != PCM_OK) {
+        return 1;
+    }
+
+    /*write a final metadata-only block containing the MD5 sum,
+      the RIFF trailer and the RIFF header if there were no blocks for it*/
+    audiotools__MD5Final(stream_md5, &md5);
+    trailer = bw_open_bytes_recorder(BS_LITTLE_ENDIAN);
+    if ((context = WavpackOpenFileOutput((WavpackBlockOutput)block_out,
+                                         trailer,
+                                         NULL)) == NULL) {
+        trailer->close(trailer);
+        return 1;
+    }
+
+    if (!WavpackSetConfiguration(context,
+                                 &config,
+                                 total_pcm_frames ?
+                                 total_pcm_frames : (uint32_t)-1) ||
+        (!header_written && header_size &&
+         !WavpackAddWrapper(context, header_data, header_size)) ||
+        !WavpackPackInit(context) ||
+        !WavpackStoreMD5Sum(context, stream_md5) ||
+        (footer_size &&
+         !WavpackAddWrapper(context, footer_data, footer_size)) ||
+        !WavpackFlushSamples(context)) {
+        WavpackCloseFile(context);
+        trailer->close(trailer);
+        return 1;
+    }
+
+    WavpackCloseFile(context);
+    result = write_blocks(trailer, total_frames_written, output);
+    trailer->close(trailer);
+    if (result) {
+        return result;
+    }
+
+    /*update total sample count, if necessary*/
+    if (total_pcm_frames) {
+        if (total_pcm_frames != total_frames_written) {
+            return 2;
+        }
+    } else {
+        output->seek(output, 12, BS_SEEK_SET);
+        output->write(output, 32, (uint32_t)total_frames_written);
+    }
+
+    return 0;
+}
+
+static void*
+encode_block_job(struct encode_job *job)
+{
+    WavpackContext *context =
+        WavpackOpenFileOutput((WavpackBlockOutput)block_out,
+                              job->output,
+                              NULL);
+    WavpackConfig config = *(job->config);
+
+    if (!context) {
+        job->status = 1;
+        return NULL;
+    }
+
+    /*encode the job's samples as a single block, if possible*/
+    config.block_samples = job->pcm_frames;
+
+    if (WavpackSetConfiguration(context,
+                                &config,
+                                job->total_pcm_frames ?
+                                job->total_pcm_frames : (uint32_t)-1) &&
+        ((job->header_size == 0) ||
+         WavpackAddWrapper(context, job->header_data, job->header_size)) &&
+        WavpackPackInit(context) &&
+        WavpackPackSamples(context, job->samples, job->pcm_frames) &&
+        WavpackFlushSamples(context)) {
+        job->status = 0;
+    } else {
+        job->status = 1;
+    }
+
+    WavpackCloseFile(context);
+    return NULL;
+}
+
+static void
+run_encode_jobs(unsigned count, struct encode_job jobs[])
+{
+    unsigned i;
+
+    for (i = 1; i < count; i++) {
+        jobs[i].started = !pthread_create(&jobs[i].worker,
+                                          NULL,
+                                          (void*(*)(void*))encode_block_job,
+                                          &jobs[i]);
+    }
+
+    encode_block_job(&jobs[0]);
+
+    for (i = 1; i < count; i++) {
+        if (jobs[i].started) {
+            pthread_join(jobs[i].worker, NULL);
+        } else {
+            /*if a thread can't be started, run its job here instead*/
+            encode_block_job(&jobs[i]);
+        }
+    }
+}
+
+static int
+write_blocks(const BitstreamRecorder *blocks,
+             uint64_t block_index,
+             BitstreamWriter *output)
+{
+    const unsigned total_size = blocks->bytes_written(blocks);
+    uint8_t *data;
+    unsigned offset = 0;
+
+    if (total_size == 0) {
+        return 0;
+    } else if ((data = malloc(total_size)) == NULL) {
+        return 3;
+    }
+
+    blocks->data(blocks, data);
+
+    /*each block's header is 32 bytes with a little-endian
+      block size at offset 4 and a 40-bit block index
+      whose upper 8 bits are at offset 10 and lower 32 bits at offset 16*/
+    while ((offset + 32) <= total_size) {
+        uint8_t *header = data + offset;
+        const uint32_t block_size = ((uint32_t)header[4] |
+                                     ((uint32_t)header[5] << 8) |
+                                     ((uint32_t)header[6] << 16) |
+                                     ((uint32_t)header[7] << 24)) + 8;
+        const uint64_t index = (((uint64_t)header[16] |
+                                 ((uint64_t)header[17] << 8) |
+                                 ((uint64_t)header[18] << 16) |
+                                 ((uint64_t)header[19] << 24) |
+                                 ((uint64_t)header[10] << 32)) +
+                                block_index);
+        header[10] = (index >> 32) & 0xFF;
+        header[16] = index & 0xFF;
+        header[17] = (index >> 8) & 0xFF;
+        header[18] = (index >> 16) & 0xFF;
+        header[19] = (index >> 24) & 0xFF;
+        offset += block_size;
+    }
+
+    output->write_bytes(output, data, total_size);
+    free(data);
+    return 0;
+}
+
 static void
 update_md5sum(audiotools__MD5Context *md5sum,
               const int pcm_data[],
@@ -300,16 +599,12 @@ update_md5sum(audiotools__MD5Context *md5sum,
               unsigned bits_per_sample,
               unsigned pcm_frames)
 {
-    const unsigned total_samples = pcm_frames * channels;
-    const unsigned buffer_size = total_samples * (bits_per_sample / 8);
-    unsigned char buffer[buffer_size];
-    int_to_pcm_converter(bits_per_sample,
-                         0,
-                         (bits_per_sample > 8))(total_samples,
-                                                pcm_data,
-                                                buffer);
-
-    audiotools__MD5Update(md5sum, buffer, buffer_size);
+    audiotools__MD5UpdateSamples(md5sum,
+                                 pcm_data,
+                                 pcm_frames * channels,
+                                 bits_per_sample,
+                                 0,
+                                 (bits_per_sample > 8));
 }
 
 static int
@@ -410,6 +705,7 @@ int main(int argc, char *argv[]) {
 
     unsigned block_size = 22050;
     wavpack_compression_t compression = COMPRESSION_NORMAL;
+    unsigned threads = 1;
 
     uint32_t header_size = 0;
     uint8_t *header_data = NULL;
@@ -427,8 +723,9 @@ int main(int argc, char *argv[]) {
         {"block-size",              required_argument, NULL, 'B'},
         {"compression",             required_argument, NULL, 'C'},
         {"header",                  required_argument, NULL, 'H'},
-        {"footer",                  required_argument, NULL, 'F'}};
-    const static char* short_opts = "-hc:m:r:b:T:C:H:F:";
+        {"footer",                  required_argument, NULL, 'F'},
+        {"threads",                 required_argument, NULL, 't'}};
+    const static char* short_opts = "-hc:m:r:b:T:C:H:F:t:";
 
     while ((c = getopt_long(argc,
                             argv,
@@ -504,6 +801,20 @@ int main(int argc, char *argv[]) {
                 return 1;
             }
             break;
+        case 't':
+            {
+                char *end;
+                const long value = strtol(optarg, &end, 10);
+                if ((end == optarg) || *end ||
+                    (value < 1) || (value > WAVPACK_MAX_THREADS)) {
+                    printf("--threads must be between 1 and %d\n",
+                           WAVPACK_MAX_THREADS);
+                    return 1;
+                } else {
+                    threads = (unsigned)value;
+                }
+            }
+            break;
         case 'h': /*fallthrough*/
         case ':':
         case '?':
@@ -518,6 +829,7 @@ int main(int argc, char *argv[]) {
             printf("-C, --compression=level         compression level\n");
             printf("-H, --header                    RIFF header\n");
             printf("-F, --footer                    RIFF footer\n");
+            printf("-t, --threads=#                 blocks to encode at once\n");
             return 0;
         default:
             break;
@@ -539,6 +851,7 @@ int main(int argc, char *argv[]) {
            (bits_per_sample == 24));
     assert(sample_rate > 0);
     assert(count_bits(channel_mask) == channels);
+    assert(threads > 0);
 
     pcmreader = pcmreader_open_raw(stdin,
                                    sample_rate,
@@ -561,7 +874,8 @@ int main(int argc, char *argv[]) {
                    header_size,
                    header_data,
                    footer_size,
-                   footer_data);
+                   footer_data,
+                   threads);
 
     output->close(output);
     pcmreader->close(pcmreader);
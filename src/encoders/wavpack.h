@@ -1,4 +1,6 @@
 #include <stdint.h>
+#include <pthread.h>
+#include <wavpack/wavpack.h>
 #include "../pcmreader.h"
 #include "../bitstream.h"
 #include "../common/md5.h"
@@ -22,6 +24,9 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+/*the most blocks encoded concurrently*/
+#define WAVPACK_MAX_THREADS 64
+
 typedef enum {
     COMPRESSION_UNKNOWN,
     COMPRESSION_FAST,
@@ -30,6 +35,24 @@ typedef enum {
     COMPRESSION_VERYHIGH
 } wavpack_compression_t;
 
+/*a run of PCM frames to be encoded into its own block(s)
+  by an independent WavpackContext on its own thread*/
+struct encode_job {
+    const WavpackConfig *config;
+    uint32_t total_pcm_frames;
+    uint32_t header_size;
+    uint8_t *header_data;
+    uint64_t block_index;
+    unsigned pcm_frames;
+    int *samples;
+    BitstreamRecorder *output;
+    int status;
+
+    /*the thread running this job, if started*/
+    pthread_t worker;
+    int started;
+};
+
 static void
 update_md5sum(audiotools__MD5Context *md5sum,
               const int pcm_data[],
@@ -49,5 +72,43 @@ encode_wavpack(BitstreamWriter *output,
                uint32_t header_size,
                uint8_t *header_data,
                uint32_t footer_size,
-               uint8_t *footer_data);
+               uint8_t *footer_data,
+               unsigned threads);
+
+static void
+init_config(WavpackConfig *config,
+            const struct PCMReader *pcmreader,
+            wavpack_compression_t compression);
+
+/*encodes each batch of "threads" blocks concurrently,
+  each with its own WavpackContext, then writes them in order
+  with their block indexes adjusted to their position in the stream*/
+static int
+encode_wavpack_threaded(BitstreamWriter *output,
+                        struct PCMReader *pcmreader,
+                        uint32_t total_pcm_frames,
+                        unsigned block_size,
+                        wavpack_compression_t compression,
+                        uint32_t header_size,
+                        uint8_t *header_data,
+                        uint32_t footer_size,
+                        uint8_t *footer_data,
+                        unsigned threads);
+
+static void*
+encode_block_job(struct encode_job *job);
+
+/*runs all the given jobs to completion,
+  the first on the current thread and the rest on new threads*/
+static void
+run_encode_jobs(unsigned count, struct encode_job jobs[]);
+
+/*writes the WavPack blocks in the recorder to output,
+  adding "block_index" to each block's 40-bit index
+
+  returns 0 on success, 3 if memory can't be allocated*/
+static int
+write_blocks(const BitstreamRecorder *blocks,
+             uint64_t block_index,
+             BitstreamWriter *output);
 
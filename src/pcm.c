@@ -24,6 +24,11 @@
 *******************************************************/
 
 #include "pcm.h"
+#ifndef STANDALONE
+#include "pcmreader.h"
+#include "common/cpu.h"
+#include "common/md5.h"
+#endif
 
 #ifndef MIN
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
@@ -60,6 +65,15 @@ PyMethodDef module_methods[] = {
     {"from_float_channels", (PyCFunction)FloatFrameList_from_channels,
      METH_VARARGS,
      "from_float_channels(floatframelist_list) -> FloatFrameList"},
+    {"compare_readers", (PyCFunction)pcm_compare_readers,
+     METH_VARARGS | METH_KEYWORDS,
+     "compare_readers(pcmreader1, pcmreader2, statistics=False) -> int"},
+    {"md5sums", (PyCFunction)pcm_md5sums,
+     METH_VARARGS | METH_KEYWORDS,
+     "md5sums(pcmreaders, signed=True, big_endian=False) -> [digest, ...]"},
+    {"cpu_features", (PyCFunction)pcm_cpu_features,
+     METH_NOARGS,
+     "cpu_features() -> [feature name, ...]"},
     {NULL}
 };
 
@@ -1570,6 +1584,454 @@ FloatFrameList_converter(PyObject* obj, void** floatframelist)
     }
 }
 
+/***********************
+  PCM stream comparison
+************************/
+
+#define COMPARE_CHUNK_SIZE 4096
+
+/*reads up to "pcm_frames" PCM frames from "reader" to "pcm_data",
+  continuing through short reads until the stream is exhausted
+
+  returns the number of frames read, which is less than requested
+  only at the end of the stream or if a read error occurs*/
+static unsigned
+fill_compare_buffer(struct PCMReader *reader,
+                    unsigned pcm_frames,
+                    int *pcm_data)
+{
+    unsigned total_read = 0;
+
+    while (total_read < pcm_frames) {
+        const unsigned frames_read =
+            reader->read(reader,
+                         pcm_frames - total_read,
+                         pcm_data + (total_read * reader->channels));
+        if (frames_read) {
+            total_read += frames_read;
+        } else {
+            break;
+        }
+    }
+
+    return total_read;
+}
+
+/*sets a Python exception for the given reader's error status
+  if one hasn't been set already
+
+  returns 1 if the reader has failed, 0 if not*/
+static int
+compare_reader_failed(const struct PCMReader *reader)
+{
+    switch (reader->status) {
+    case PCM_OK:
+        return 0;
+    case PCM_NON_FRAMELIST:
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_TypeError,
+                            "PCMReader.read() must return FrameList");
+        }
+        return 1;
+    case PCM_INVALID_FRAMELIST:
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError,
+                            "FrameList does not match PCMReader's stream");
+        }
+        return 1;
+    case PCM_READ_ERROR:
+    default:
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_IOError, "error reading from PCMReader");
+        }
+        return 1;
+    }
+}
+
+/*returns the offset of the first of "pcm_frames" PCM frames
+  which differ between "data1" and "data2",
+  or "pcm_frames" if they're all identical*/
+static unsigned
+first_mismatched_frame(const int *data1,
+                       const int *data2,
+                       unsigned pcm_frames,
+                       unsigned channels)
+{
+    const size_t frame_size = sizeof(int) * channels;
+    unsigned i;
+
+    if (!memcmp(data1, data2, frame_size * pcm_frames)) {
+        return pcm_frames;
+    }
+
+    for (i = 0; i < pcm_frames; i++) {
+        if (memcmp(data1 + (i * channels), data2 + (i * channels), frame_size))
+            break;
+    }
+    return i;
+}
+
+/*adds the number of mismatched frames in the given block
+  to "mismatches" and updates "max_difference"
+  with the largest absolute difference between any two samples*/
+static void
+mismatch_statistics(const int *data1,
+                    const int *data2,
+                    unsigned pcm_frames,
+                    unsigned channels,
+                    uint64_t *mismatches,
+                    int64_t *max_difference)
+{
+    unsigned i;
+
+    for (i = 0; i < pcm_frames; i++) {
+        int mismatched = 0;
+        unsigned c;
+        for (c = 0; c < channels; c++) {
+            const int64_t difference = (int64_t)data1[c] - (int64_t)data2[c];
+            if (difference) {
+                mismatched = 1;
+                if (difference > *max_difference) {
+                    *max_difference = difference;
+                } else if (-difference > *max_difference) {
+                    *max_difference = -difference;
+                }
+            }
+        }
+        *mismatches += mismatched;
+        data1 += channels;
+        data2 += channels;
+    }
+}
+
+PyObject*
+pcm_compare_readers(PyObject *dummy, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"pcmreader1", "pcmreader2", "statistics", NULL};
+    PyObject *reader1_obj;
+    PyObject *reader2_obj;
+    int statistics = 0;
+    struct PCMReader *reader1 = NULL;
+    struct PCMReader *reader2 = NULL;
+    int *data1 = NULL;
+    int *data2 = NULL;
+    unsigned channels;
+    uint64_t frame_number = 0;
+    int mismatch_found = 0;
+    uint64_t first_mismatch = 0;
+    uint64_t mismatches = 0;
+    int64_t max_difference = 0;
+    PyObject *result = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|i", kwlist,
+                                     &reader1_obj,
+                                     &reader2_obj,
+                                     &statistics))
+        return NULL;
+
+    if ((reader1 = pcmreader_open_python(reader1_obj)) == NULL)
+        return NULL;
+    if ((reader2 = pcmreader_open_python(reader2_obj)) == NULL) {
+        reader1->del(reader1);
+        return NULL;
+    }
+
+    if ((reader1->channels != reader2->channels) ||
+        (reader1->bits_per_sample != reader2->bits_per_sample)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "channels and bits-per-sample must match");
+        goto done;
+    }
+    if (reader1->channels == 0) {
+        PyErr_SetString(PyExc_ValueError, "channels must be greater than 0");
+        goto done;
+    }
+
+    channels = reader1->channels;
+    data1 = malloc(sizeof(int) * COMPARE_CHUNK_SIZE * channels);
+    data2 = malloc(sizeof(int) * COMPARE_CHUNK_SIZE * channels);
+    if ((data1 == NULL) || (data2 == NULL)) {
+        /*done frees whichever buffer was allocated*/
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    for (;;) {
+        const unsigned frames1 =
+            fill_compare_buffer(reader1, COMPARE_CHUNK_SIZE, data1);
+        unsigned frames2;
+        unsigned common_frames;
+        unsigned mismatch;
+
+        if (compare_reader_failed(reader1))
+            goto done;
+        frames2 = fill_compare_buffer(reader2, COMPARE_CHUNK_SIZE, data2);
+        if (compare_reader_failed(reader2))
+            goto done;
+
+        common_frames = MIN(frames1, frames2);
+
+        /*the samples themselves don't need the interpreter*/
+        Py_BEGIN_ALLOW_THREADS
+        mismatch = first_mismatched_frame(data1,
+                                          data2,
+                                          common_frames,
+                                          channels);
+        if (statistics && (mismatch < common_frames)) {
+            mismatch_statistics(data1 + (mismatch * channels),
+                                data2 + (mismatch * channels),
+                                common_frames - mismatch,
+                                channels,
+                                &mismatches,
+                                &max_difference);
+        }
+        Py_END_ALLOW_THREADS
+
+        if (frames1 != frames2) {
+            /*one stream has ended before the other,
+              so its missing frames all count as mismatched*/
+            mismatches += MAX(frames1, frames2) - common_frames;
+        }
+
+        if (!mismatch_found &&
+            ((mismatch < common_frames) || (frames1 != frames2))) {
+            mismatch_found = 1;
+            first_mismatch = frame_number + mismatch;
+            if (!statistics)
+                break;
+        }
+
+        frame_number += common_frames;
+
+        if ((frames1 == 0) && (frames2 == 0)) {
+            break;
+        } else if (frames1 != frames2) {
+            /*count the remainder of the longer stream as mismatched*/
+            struct PCMReader *longer = frames1 ? reader1 : reader2;
+            int *data = frames1 ? data1 : data2;
+            unsigned frames_read;
+
+            while ((frames_read = fill_compare_buffer(longer,
+                                                      COMPARE_CHUNK_SIZE,
+                                                      data)) > 0) {
+                mismatches += frames_read;
+            }
+            if (compare_reader_failed(longer))
+                goto done;
+            break;
+        }
+    }
+
+    if (statistics) {
+        if (mismatch_found) {
+            result = Py_BuildValue("(nnn)",
+                                   (Py_ssize_t)first_mismatch,
+                                   (Py_ssize_t)mismatches,
+                                   (Py_ssize_t)max_difference);
+        } else {
+            result = Py_BuildValue("(Oii)", Py_None, 0, 0);
+        }
+    } else if (mismatch_found) {
+        result = Py_BuildValue("n", (Py_ssize_t)first_mismatch);
+    } else {
+        Py_INCREF(Py_None);
+        result = Py_None;
+    }
+
+done:
+    free(data1);
+    free(data2);
+    reader1->del(reader1);
+    reader2->del(reader2);
+    return result;
+}
+
+/***************************
+  PCM stream MD5 checksums
+****************************/
+
+#define MD5_CHUNK_SIZE 4096
+
+struct md5_stream {
+    struct PCMReader *reader;
+    audiotools__MD5Context md5;
+    int *samples;
+    unsigned char *bytes;
+    int_to_pcm_f converter;
+    int finished;
+};
+
+PyObject*
+pcm_md5sums(PyObject *dummy, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"pcmreaders", "signed", "big_endian", NULL};
+    PyObject *pcmreaders_obj;
+    int is_signed = 1;
+    int is_big_endian = 0;
+    PyObject *pcmreaders = NULL;
+    Py_ssize_t count = 0;
+    struct md5_stream *streams = NULL;
+    audiotools__MD5Context **contexts = NULL;
+    const void **bufs = NULL;
+    unsigned long *lens = NULL;
+    unsigned remaining;
+    Py_ssize_t i;
+    PyObject *result = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|ii", kwlist,
+                                     &pcmreaders_obj,
+                                     &is_signed,
+                                     &is_big_endian))
+        return NULL;
+
+    if ((pcmreaders = PySequence_Fast(
+             pcmreaders_obj, "pcmreaders must be a sequence")) == NULL)
+        return NULL;
+    count = PySequence_Fast_GET_SIZE(pcmreaders);
+
+    streams = calloc(count ? count : 1, sizeof(struct md5_stream));
+    contexts = malloc(sizeof(audiotools__MD5Context*) * (count ? count : 1));
+    bufs = malloc(sizeof(void*) * (count ? count : 1));
+    lens = malloc(sizeof(unsigned long) * (count ? count : 1));
+    if ((streams == NULL) || (contexts == NULL) ||
+        (bufs == NULL) || (lens == NULL)) {
+        PyErr_NoMemory();
+        count = 0;
+        goto done;
+    }
+
+    for (i = 0; i < count; i++) {
+        struct md5_stream *stream = &streams[i];
+        struct PCMReader *reader;
+
+        if ((reader = stream->reader = pcmreader_open_python(
+                 PySequence_Fast_GET_ITEM(pcmreaders, i))) == NULL)
+            goto done;
+        if (reader->channels == 0) {
+            PyErr_SetString(PyExc_ValueError,
+                            "channels must be greater than 0");
+            goto done;
+        }
+        if ((stream->converter =
+             int_to_pcm_converter(reader->bits_per_sample,
+                                  is_big_endian,
+                                  is_signed)) == NULL) {
+            PyErr_SetString(PyExc_ValueError,
+                            "unsupported bits per sample");
+            goto done;
+        }
+        stream->samples =
+            malloc(sizeof(int) * MD5_CHUNK_SIZE * reader->channels);
+        stream->bytes = malloc((reader->bits_per_sample / 8) *
+                               MD5_CHUNK_SIZE * reader->channels);
+        if ((stream->samples == NULL) || (stream->bytes == NULL)) {
+            PyErr_NoMemory();
+            goto done;
+        }
+        audiotools__MD5Init(&stream->md5);
+    }
+
+    /*read a chunk from every unfinished stream,
+      then hash all the chunks in one batch*/
+    for (remaining = (unsigned)count; remaining > 0;) {
+        unsigned active = 0;
+
+        for (i = 0; i < count; i++) {
+            struct md5_stream *stream = &streams[i];
+            struct PCMReader *reader = stream->reader;
+            unsigned frames;
+
+            if (stream->finished)
+                continue;
+
+            frames = reader->read(reader, MD5_CHUNK_SIZE, stream->samples);
+            if (compare_reader_failed(reader)) {
+                goto done;
+            } else if (frames == 0) {
+                stream->finished = 1;
+                remaining--;
+            } else if (count == 1) {
+                /*a single stream is packed straight into its MD5 block*/
+                audiotools__MD5UpdateSamples(&stream->md5,
+                                             stream->samples,
+                                             frames * reader->channels,
+                                             reader->bits_per_sample,
+                                             is_big_endian,
+                                             is_signed);
+            } else {
+                stream->converter(frames * reader->channels,
+                                  stream->samples,
+                                  stream->bytes);
+                contexts[active] = &stream->md5;
+                bufs[active] = stream->bytes;
+                lens[active++] = (frames * reader->channels *
+                                  (reader->bits_per_sample / 8));
+            }
+        }
+
+        if (active) {
+            Py_BEGIN_ALLOW_THREADS
+            audiotools__MD5UpdateMany(contexts, bufs, lens, active);
+            Py_END_ALLOW_THREADS
+        }
+    }
+
+    if ((result = PyList_New(count)) == NULL)
+        goto done;
+    for (i = 0; i < count; i++) {
+        unsigned char digest[16];
+        PyObject *digest_obj;
+
+        audiotools__MD5Final(digest, &streams[i].md5);
+        if ((digest_obj =
+             PyBytes_FromStringAndSize((char *)digest, 16)) == NULL) {
+            Py_CLEAR(result);
+            goto done;
+        }
+        PyList_SET_ITEM(result, i, digest_obj);
+    }
+
+done:
+    for (i = 0; i < count; i++) {
+        if (streams[i].reader) {
+            streams[i].reader->del(streams[i].reader);
+        }
+        free(streams[i].samples);
+        free(streams[i].bytes);
+    }
+    free(streams);
+    free(contexts);
+    free(bufs);
+    free(lens);
+    Py_XDECREF(pcmreaders);
+    return result;
+}
+
+PyObject*
+pcm_cpu_features(PyObject *dummy, PyObject *args)
+{
+    const unsigned features = cpu_features();
+    PyObject *names = PyList_New(0);
+    unsigned i;
+
+    if (!names) {
+        return NULL;
+    }
+    for (i = 0; i < CPU_FEATURES; i++) {
+        if (features & (1 << i)) {
+            PyObject *name = Py_BuildValue(
+                "s", cpu_feature_name((cpu_feature_t)(1 << i)));
+            if (!name || (PyList_Append(names, name) < 0)) {
+                Py_XDECREF(name);
+                Py_DECREF(names);
+                return NULL;
+            }
+            Py_DECREF(name);
+        }
+    }
+    return names;
+}
+
 MOD_INIT(pcm)
 {
     PyObject* m;
@@ -1579,6 +2041,8 @@ MOD_INIT(pcm)
     if (!m)
         return MOD_ERROR_VAL;
 
+    audiotools__MD5InitDispatch();
+
     pcm_FrameListType.tp_new = PyType_GenericNew;
     if (PyType_Ready(&pcm_FrameListType) < 0)
         return MOD_ERROR_VAL;
@@ -221,6 +221,41 @@ FloatFrameList_from_channels(PyObject *dummy, PyObject *args);
 /*for use with the PyArg_ParseTuple function*/
 int
 FloatFrameList_converter(PyObject* obj, void** floatframelist);
+
+/***********************
+  PCM stream comparison
+************************/
+
+/*compare_readers(pcmreader1, pcmreader2, statistics=False)
+
+  reads both PCMReaders to completion (or until the first mismatch
+  if statistics aren't wanted) and returns the frame number
+  of the first mismatching PCM frame, or None if they match
+
+  if "statistics" is True, returns a
+  (first mismatch, mismatched frames, maximum difference) tuple instead*/
+PyObject*
+pcm_compare_readers(PyObject *dummy, PyObject *args, PyObject *kwds);
+
+/*md5sums(pcmreaders, signed=True, big_endian=False)
+
+  reads every PCMReader in the list to completion
+  and returns a list of their MD5 digests,
+  one per reader, of their samples as signed or unsigned,
+  little-endian or big-endian bytes
+
+  the readers are read in step with one another
+  so that their blocks can be hashed several at a time*/
+PyObject*
+pcm_md5sums(PyObject *dummy, PyObject *args, PyObject *kwds);
+
+/*cpu_features()
+
+  returns a list of the SIMD instruction sets, such as "sse4.1",
+  whose kernels the running processor supports,
+  which is empty if the AUDIOTOOLS_SCALAR environment variable is set*/
+PyObject*
+pcm_cpu_features(PyObject *dummy, PyObject *args);
 #endif
 
 #endif
@@ -1,6 +1,12 @@
 #include "pcm_conv.h"
+#include "common/cpu.h"
 #include <stdlib.h>
 #include <math.h>
+#if defined(CPU_X86)
+#include <immintrin.h>
+#elif defined(CPU_ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -54,6 +60,63 @@ PCM_CONV(SL24)
 PCM_CONV(UB24)
 PCM_CONV(UL24)
 
+/*vector versions of the signed 16 and 24 bit converters*/
+#if defined(CPU_X86)
+#define PCM_CONV_SIMD(name, isa, target)                          \
+    CPU_TARGET(target) static void                                \
+    pcm_##name##_to_int_##isa(unsigned total_samples,             \
+                              const unsigned char pcm_samples[],  \
+                              int int_samples[]);                 \
+                                                                  \
+    CPU_TARGET(target) static void                                \
+    int_to_##name##_pcm_##isa(unsigned total_samples,             \
+                              const int int_samples[],            \
+                              unsigned char pcm_samples[]);
+#define PCM_CONV_X86(name)                \
+    PCM_CONV_SIMD(name, sse4_1, "sse4.1") \
+    PCM_CONV_SIMD(name, avx2, "avx2")
+
+PCM_CONV_X86(SB16)
+PCM_CONV_X86(SL16)
+PCM_CONV_X86(SB24)
+PCM_CONV_X86(SL24)
+#elif defined(CPU_ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#define PCM_CONV_NEON_KERNELS
+#define PCM_CONV_NEON(name)                                       \
+    static void                                                   \
+    pcm_##name##_to_int_neon(unsigned total_samples,              \
+                             const unsigned char pcm_samples[],   \
+                             int int_samples[]);                  \
+                                                                  \
+    static void                                                   \
+    int_to_##name##_pcm_neon(unsigned total_samples,              \
+                             const int int_samples[],             \
+                             unsigned char pcm_samples[]);
+
+PCM_CONV_NEON(SB16)
+PCM_CONV_NEON(SL16)
+PCM_CONV_NEON(SB24)
+PCM_CONV_NEON(SL24)
+#endif
+
+/*converters indexed by [bytes per sample - 1][is_big_endian][is_signed]
+  which init_dispatch() points at the fastest kernels the CPU supports*/
+static pcm_to_int_f pcm_to_int_table[3][2][2] = {
+    {{pcm_U8_to_int, pcm_S8_to_int}, {pcm_U8_to_int, pcm_S8_to_int}},
+    {{pcm_UL16_to_int, pcm_SL16_to_int}, {pcm_UB16_to_int, pcm_SB16_to_int}},
+    {{pcm_UL24_to_int, pcm_SL24_to_int}, {pcm_UB24_to_int, pcm_SB24_to_int}}
+};
+
+static int_to_pcm_f int_to_pcm_table[3][2][2] = {
+    {{int_to_U8_pcm, int_to_S8_pcm}, {int_to_U8_pcm, int_to_S8_pcm}},
+    {{int_to_UL16_pcm, int_to_SL16_pcm}, {int_to_UB16_pcm, int_to_SB16_pcm}},
+    {{int_to_UL24_pcm, int_to_SL24_pcm}, {int_to_UB24_pcm, int_to_SB24_pcm}}
+};
+
+/*fills in the converter tables the first time it's called*/
+static void
+init_dispatch(void);
+
 #define PCM_INT_CONV_DEFS(bits)                           \
     static void                                           \
     int_##bits##_to_double(unsigned total_samples,        \
@@ -90,23 +153,12 @@ pcm_to_int_converter(unsigned bits_per_sample,
 {
     switch (bits_per_sample) {
     case 8:
-        if (is_signed) {
-            return pcm_S8_to_int;
-        } else {
-            return pcm_U8_to_int;
-        }
     case 16:
-        if (is_signed) {
-            return is_big_endian ? pcm_SB16_to_int : pcm_SL16_to_int;
-        } else {
-            return is_big_endian ? pcm_UB16_to_int : pcm_UL16_to_int;
-        }
     case 24:
-        if (is_signed) {
-            return is_big_endian ? pcm_SB24_to_int : pcm_SL24_to_int;
-        } else {
-            return is_big_endian ? pcm_UB24_to_int : pcm_UL24_to_int;
-        }
+        init_dispatch();
+        return pcm_to_int_table[bits_per_sample / 8 - 1]
+                               [is_big_endian ? 1 : 0]
+                               [is_signed ? 1 : 0];
     default:
         return NULL;
     }
@@ -119,23 +171,12 @@ int_to_pcm_converter(unsigned bits_per_sample,
 {
     switch (bits_per_sample) {
     case 8:
-        if (is_signed) {
-            return int_to_S8_pcm;
-        } else {
-            return int_to_U8_pcm;
-        }
     case 16:
-        if (is_signed) {
-            return is_big_endian ? int_to_SB16_pcm : int_to_SL16_pcm;
-        } else {
-            return is_big_endian ? int_to_UB16_pcm : int_to_UL16_pcm;
-        }
     case 24:
-        if (is_signed) {
-            return is_big_endian ? int_to_SB24_pcm : int_to_SL24_pcm;
-        } else {
-            return is_big_endian ? int_to_UB24_pcm : int_to_UL24_pcm;
-        }
+        init_dispatch();
+        return int_to_pcm_table[bits_per_sample / 8 - 1]
+                               [is_big_endian ? 1 : 0]
+                               [is_signed ? 1 : 0];
     default:
         return NULL;
     }
@@ -600,6 +641,494 @@ int_to_UL24_pcm(unsigned total_samples,
     }
 }
 
+#if defined(CPU_X86)
+/*pshufb masks for byte-swapping 16-bit values*/
+#define SWAP_16 _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, \
+                              9, 8, 11, 10, 13, 12, 15, 14)
+
+/*pshufb masks placing 4 packed 24-bit samples
+  in the top 3 bytes of each 32-bit lane,
+  starting from byte 0 of the register or from byte 4*/
+#define UNPACK_L24_LOW _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, \
+                                     -1, 6, 7, 8, -1, 9, 10, 11)
+#define UNPACK_L24_HIGH _mm_setr_epi8(-1, 4, 5, 6, -1, 7, 8, 9, \
+                                      -1, 10, 11, 12, -1, 13, 14, 15)
+#define UNPACK_B24_LOW _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, \
+                                     -1, 8, 7, 6, -1, 11, 10, 9)
+#define UNPACK_B24_HIGH _mm_setr_epi8(-1, 6, 5, 4, -1, 9, 8, 7, \
+                                      -1, 12, 11, 10, -1, 15, 14, 13)
+
+/*pshufb masks packing the low 3 bytes of each 32-bit lane
+  into the first 12 bytes of the register*/
+#define PACK_L24 _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, \
+                               -1, -1, -1, -1)
+#define PACK_B24 _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, \
+                               -1, -1, -1, -1)
+
+CPU_TARGET("sse4.1") static inline void
+pcm_S16_to_int_sse4_1(unsigned total_samples,
+                      const unsigned char pcm_samples[],
+                      int int_samples[],
+                      int is_big_endian)
+{
+    for (; total_samples >= 8; total_samples -= 8) {
+        __m128i pcm = _mm_loadu_si128((const __m128i*)pcm_samples);
+        if (is_big_endian) {
+            pcm = _mm_shuffle_epi8(pcm, SWAP_16);
+        }
+        _mm_storeu_si128((__m128i*)int_samples, _mm_cvtepi16_epi32(pcm));
+        _mm_storeu_si128((__m128i*)(int_samples + 4),
+                         _mm_cvtepi16_epi32(_mm_srli_si128(pcm, 8)));
+        pcm_samples += 16;
+        int_samples += 8;
+    }
+
+    if (is_big_endian) {
+        pcm_SB16_to_int(total_samples, pcm_samples, int_samples);
+    } else {
+        pcm_SL16_to_int(total_samples, pcm_samples, int_samples);
+    }
+}
+
+CPU_TARGET("sse4.1") static inline void
+int_to_S16_pcm_sse4_1(unsigned total_samples,
+                      const int int_samples[],
+                      unsigned char pcm_samples[],
+                      int is_big_endian)
+{
+    for (; total_samples >= 8; total_samples -= 8) {
+        /*saturating to 16 bits does the clamping*/
+        __m128i pcm = _mm_packs_epi32(
+            _mm_loadu_si128((const __m128i*)int_samples),
+            _mm_loadu_si128((const __m128i*)(int_samples + 4)));
+        if (is_big_endian) {
+            pcm = _mm_shuffle_epi8(pcm, SWAP_16);
+        }
+        _mm_storeu_si128((__m128i*)pcm_samples, pcm);
+        int_samples += 8;
+        pcm_samples += 16;
+    }
+
+    if (is_big_endian) {
+        int_to_SB16_pcm(total_samples, int_samples, pcm_samples);
+    } else {
+        int_to_SL16_pcm(total_samples, int_samples, pcm_samples);
+    }
+}
+
+CPU_TARGET("sse4.1") static inline void
+pcm_S24_to_int_sse4_1(unsigned total_samples,
+                      const unsigned char pcm_samples[],
+                      int int_samples[],
+                      int is_big_endian)
+{
+    const __m128i low_mask = is_big_endian ? UNPACK_B24_LOW : UNPACK_L24_LOW;
+    const __m128i high_mask =
+        is_big_endian ? UNPACK_B24_HIGH : UNPACK_L24_HIGH;
+
+    /*8 samples are 24 bytes, read as bytes 0-15 and 8-23
+      so nothing past the end of the input is touched*/
+    for (; total_samples >= 8; total_samples -= 8) {
+        const __m128i low = _mm_loadu_si128((const __m128i*)pcm_samples);
+        const __m128i high =
+            _mm_loadu_si128((const __m128i*)(pcm_samples + 8));
+
+        /*the arithmetic shift sign-extends each sample*/
+        _mm_storeu_si128((__m128i*)int_samples,
+                         _mm_srai_epi32(_mm_shuffle_epi8(low, low_mask), 8));
+        _mm_storeu_si128((__m128i*)(int_samples + 4),
+                         _mm_srai_epi32(_mm_shuffle_epi8(high, high_mask), 8));
+        pcm_samples += 24;
+        int_samples += 8;
+    }
+
+    if (is_big_endian) {
+        pcm_SB24_to_int(total_samples, pcm_samples, int_samples);
+    } else {
+        pcm_SL24_to_int(total_samples, pcm_samples, int_samples);
+    }
+}
+
+CPU_TARGET("sse4.1") static inline void
+int_to_S24_pcm_sse4_1(unsigned total_samples,
+                      const int int_samples[],
+                      unsigned char pcm_samples[],
+                      int is_big_endian)
+{
+    const __m128i mask = is_big_endian ? PACK_B24 : PACK_L24;
+    const __m128i min = _mm_set1_epi32(-0x800000);
+    const __m128i max = _mm_set1_epi32(0x7FFFFF);
+
+    for (; total_samples >= 8; total_samples -= 8) {
+        /*12 bytes each*/
+        const __m128i a = _mm_shuffle_epi8(
+            _mm_min_epi32(_mm_max_epi32(
+                _mm_loadu_si128((const __m128i*)int_samples), min), max),
+            mask);
+        const __m128i b = _mm_shuffle_epi8(
+            _mm_min_epi32(_mm_max_epi32(
+                _mm_loadu_si128((const __m128i*)(int_samples + 4)), min), max),
+            mask);
+        _mm_storeu_si128((__m128i*)pcm_samples,
+                         _mm_or_si128(a, _mm_slli_si128(b, 12)));
+        _mm_storel_epi64((__m128i*)(pcm_samples + 16), _mm_srli_si128(b, 4));
+        int_samples += 8;
+        pcm_samples += 24;
+    }
+
+    if (is_big_endian) {
+        int_to_SB24_pcm(total_samples, int_samples, pcm_samples);
+    } else {
+        int_to_SL24_pcm(total_samples, int_samples, pcm_samples);
+    }
+}
+
+CPU_TARGET("avx2") static inline void
+pcm_S16_to_int_avx2(unsigned total_samples,
+                    const unsigned char pcm_samples[],
+                    int int_samples[],
+                    int is_big_endian)
+{
+    for (; total_samples >= 8; total_samples -= 8) {
+        __m128i pcm = _mm_loadu_si128((const __m128i*)pcm_samples);
+        if (is_big_endian) {
+            pcm = _mm_shuffle_epi8(pcm, SWAP_16);
+        }
+        _mm256_storeu_si256((__m256i*)int_samples,
+                            _mm256_cvtepi16_epi32(pcm));
+        pcm_samples += 16;
+        int_samples += 8;
+    }
+
+    if (is_big_endian) {
+        pcm_SB16_to_int(total_samples, pcm_samples, int_samples);
+    } else {
+        pcm_SL16_to_int(total_samples, pcm_samples, int_samples);
+    }
+}
+
+CPU_TARGET("avx2") static inline void
+int_to_S16_pcm_avx2(unsigned total_samples,
+                    const int int_samples[],
+                    unsigned char pcm_samples[],
+                    int is_big_endian)
+{
+    const __m256i swap = _mm256_broadcastsi128_si256(SWAP_16);
+
+    for (; total_samples >= 16; total_samples -= 16) {
+        /*packing works within each 128-bit lane,
+          so the middle two 64-bit quarters need swapping afterward*/
+        __m256i pcm = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(
+                _mm256_loadu_si256((const __m256i*)int_samples),
+                _mm256_loadu_si256((const __m256i*)(int_samples + 8))),
+            0xD8);
+        if (is_big_endian) {
+            pcm = _mm256_shuffle_epi8(pcm, swap);
+        }
+        _mm256_storeu_si256((__m256i*)pcm_samples, pcm);
+        int_samples += 16;
+        pcm_samples += 32;
+    }
+
+    if (is_big_endian) {
+        int_to_SB16_pcm(total_samples, int_samples, pcm_samples);
+    } else {
+        int_to_SL16_pcm(total_samples, int_samples, pcm_samples);
+    }
+}
+
+CPU_TARGET("avx2") static inline void
+pcm_S24_to_int_avx2(unsigned total_samples,
+                    const unsigned char pcm_samples[],
+                    int int_samples[],
+                    int is_big_endian)
+{
+    const __m256i mask = is_big_endian ?
+        _mm256_inserti128_si256(_mm256_castsi128_si256(UNPACK_B24_LOW),
+                                UNPACK_B24_HIGH, 1) :
+        _mm256_inserti128_si256(_mm256_castsi128_si256(UNPACK_L24_LOW),
+                                UNPACK_L24_HIGH, 1);
+
+    for (; total_samples >= 8; total_samples -= 8) {
+        const __m256i pcm = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128((const __m128i*)pcm_samples)),
+            _mm_loadu_si128((const __m128i*)(pcm_samples + 8)), 1);
+        _mm256_storeu_si256((__m256i*)int_samples,
+                            _mm256_srai_epi32(_mm256_shuffle_epi8(pcm, mask),
+                                              8));
+        pcm_samples += 24;
+        int_samples += 8;
+    }
+
+    if (is_big_endian) {
+        pcm_SB24_to_int(total_samples, pcm_samples, int_samples);
+    } else {
+        pcm_SL24_to_int(total_samples, pcm_samples, int_samples);
+    }
+}
+
+CPU_TARGET("avx2") static inline void
+int_to_S24_pcm_avx2(unsigned total_samples,
+                    const int int_samples[],
+                    unsigned char pcm_samples[],
+                    int is_big_endian)
+{
+    const __m256i mask = _mm256_broadcastsi128_si256(
+        is_big_endian ? PACK_B24 : PACK_L24);
+    const __m256i min = _mm256_set1_epi32(-0x800000);
+    const __m256i max = _mm256_set1_epi32(0x7FFFFF);
+
+    for (; total_samples >= 8; total_samples -= 8) {
+        const __m256i packed = _mm256_shuffle_epi8(
+            _mm256_min_epi32(_mm256_max_epi32(
+                _mm256_loadu_si256((const __m256i*)int_samples), min), max),
+            mask);
+        /*12 bytes in each lane*/
+        const __m128i a = _mm256_castsi256_si128(packed);
+        const __m128i b = _mm256_extracti128_si256(packed, 1);
+        _mm_storeu_si128((__m128i*)pcm_samples,
+                         _mm_or_si128(a, _mm_slli_si128(b, 12)));
+        _mm_storel_epi64((__m128i*)(pcm_samples + 16), _mm_srli_si128(b, 4));
+        int_samples += 8;
+        pcm_samples += 24;
+    }
+
+    if (is_big_endian) {
+        int_to_SB24_pcm(total_samples, int_samples, pcm_samples);
+    } else {
+        int_to_SL24_pcm(total_samples, int_samples, pcm_samples);
+    }
+}
+
+#define PCM_CONV_SIMD_IMPL(name, width, is_big_endian, isa, target)     \
+    CPU_TARGET(target) static void                                      \
+    pcm_##name##_to_int_##isa(unsigned total_samples,                   \
+                              const unsigned char pcm_samples[],        \
+                              int int_samples[])                        \
+    {                                                                   \
+        pcm_S##width##_to_int_##isa(total_samples, pcm_samples,         \
+                                    int_samples, is_big_endian);        \
+    }                                                                   \
+                                                                        \
+    CPU_TARGET(target) static void                                      \
+    int_to_##name##_pcm_##isa(unsigned total_samples,                   \
+                              const int int_samples[],                  \
+                              unsigned char pcm_samples[])              \
+    {                                                                   \
+        int_to_S##width##_pcm_##isa(total_samples, int_samples,         \
+                                    pcm_samples, is_big_endian);        \
+    }
+
+PCM_CONV_SIMD_IMPL(SB16, 16, 1, sse4_1, "sse4.1")
+PCM_CONV_SIMD_IMPL(SL16, 16, 0, sse4_1, "sse4.1")
+PCM_CONV_SIMD_IMPL(SB24, 24, 1, sse4_1, "sse4.1")
+PCM_CONV_SIMD_IMPL(SL24, 24, 0, sse4_1, "sse4.1")
+PCM_CONV_SIMD_IMPL(SB16, 16, 1, avx2, "avx2")
+PCM_CONV_SIMD_IMPL(SL16, 16, 0, avx2, "avx2")
+PCM_CONV_SIMD_IMPL(SB24, 24, 1, avx2, "avx2")
+PCM_CONV_SIMD_IMPL(SL24, 24, 0, avx2, "avx2")
+#elif defined(PCM_CONV_NEON_KERNELS)
+static inline void
+pcm_S16_to_int_neon(unsigned total_samples,
+                    const unsigned char pcm_samples[],
+                    int int_samples[],
+                    int is_big_endian)
+{
+    for (; total_samples >= 8; total_samples -= 8) {
+        uint8x16_t pcm = vld1q_u8(pcm_samples);
+        int16x8_t samples;
+        if (is_big_endian) {
+            pcm = vrev16q_u8(pcm);
+        }
+        samples = vreinterpretq_s16_u8(pcm);
+        vst1q_s32(int_samples, vmovl_s16(vget_low_s16(samples)));
+        vst1q_s32(int_samples + 4, vmovl_s16(vget_high_s16(samples)));
+        pcm_samples += 16;
+        int_samples += 8;
+    }
+
+    if (is_big_endian) {
+        pcm_SB16_to_int(total_samples, pcm_samples, int_samples);
+    } else {
+        pcm_SL16_to_int(total_samples, pcm_samples, int_samples);
+    }
+}
+
+static inline void
+int_to_S16_pcm_neon(unsigned total_samples,
+                    const int int_samples[],
+                    unsigned char pcm_samples[],
+                    int is_big_endian)
+{
+    for (; total_samples >= 8; total_samples -= 8) {
+        /*saturating to 16 bits does the clamping*/
+        uint8x16_t pcm = vreinterpretq_u8_s16(
+            vcombine_s16(vqmovn_s32(vld1q_s32(int_samples)),
+                         vqmovn_s32(vld1q_s32(int_samples + 4))));
+        if (is_big_endian) {
+            pcm = vrev16q_u8(pcm);
+        }
+        vst1q_u8(pcm_samples, pcm);
+        int_samples += 8;
+        pcm_samples += 16;
+    }
+
+    if (is_big_endian) {
+        int_to_SB16_pcm(total_samples, int_samples, pcm_samples);
+    } else {
+        int_to_SL16_pcm(total_samples, int_samples, pcm_samples);
+    }
+}
+
+static inline void
+pcm_S24_to_int_neon(unsigned total_samples,
+                    const unsigned char pcm_samples[],
+                    int int_samples[],
+                    int is_big_endian)
+{
+    for (; total_samples >= 16; total_samples -= 16) {
+        /*splits 16 samples into planes of their 1st, 2nd and 3rd bytes*/
+        const uint8x16x3_t pcm = vld3q_u8(pcm_samples);
+        const uint8x16_t low = pcm.val[is_big_endian ? 2 : 0];
+        const uint8x16_t middle = pcm.val[1];
+        const int8x16_t high = vreinterpretq_s8_u8(pcm.val[is_big_endian ?
+                                                           0 : 2]);
+
+        /*interleaving the planes builds the 32-bit samples
+          with the high byte sign-extended*/
+        const uint8x16x2_t low_words = vzipq_u8(low, middle);
+        const uint16x8x2_t samples_0_7 = vzipq_u16(
+            vreinterpretq_u16_u8(low_words.val[0]),
+            vreinterpretq_u16_s16(vmovl_s8(vget_low_s8(high))));
+        const uint16x8x2_t samples_8_15 = vzipq_u16(
+            vreinterpretq_u16_u8(low_words.val[1]),
+            vreinterpretq_u16_s16(vmovl_s8(vget_high_s8(high))));
+
+        vst1q_s32(int_samples, vreinterpretq_s32_u16(samples_0_7.val[0]));
+        vst1q_s32(int_samples + 4,
+                  vreinterpretq_s32_u16(samples_0_7.val[1]));
+        vst1q_s32(int_samples + 8,
+                  vreinterpretq_s32_u16(samples_8_15.val[0]));
+        vst1q_s32(int_samples + 12,
+                  vreinterpretq_s32_u16(samples_8_15.val[1]));
+        pcm_samples += 48;
+        int_samples += 16;
+    }
+
+    if (is_big_endian) {
+        pcm_SB24_to_int(total_samples, pcm_samples, int_samples);
+    } else {
+        pcm_SL24_to_int(total_samples, pcm_samples, int_samples);
+    }
+}
+
+/*returns the bytes at the given bit offset of 16 samples*/
+static inline uint8x16_t
+byte_plane(const int32x4_t samples[4], int bit_offset)
+{
+    const int32x4_t shift = vdupq_n_s32(-bit_offset);
+    return vcombine_u8(
+        vmovn_u16(vcombine_u16(
+            vmovn_u32(vreinterpretq_u32_s32(vshlq_s32(samples[0], shift))),
+            vmovn_u32(vreinterpretq_u32_s32(vshlq_s32(samples[1], shift))))),
+        vmovn_u16(vcombine_u16(
+            vmovn_u32(vreinterpretq_u32_s32(vshlq_s32(samples[2], shift))),
+            vmovn_u32(vreinterpretq_u32_s32(vshlq_s32(samples[3], shift))))));
+}
+
+static inline void
+int_to_S24_pcm_neon(unsigned total_samples,
+                    const int int_samples[],
+                    unsigned char pcm_samples[],
+                    int is_big_endian)
+{
+    const int32x4_t min = vdupq_n_s32(-0x800000);
+    const int32x4_t max = vdupq_n_s32(0x7FFFFF);
+
+    for (; total_samples >= 16; total_samples -= 16) {
+        int32x4_t samples[4];
+        uint8x16x3_t pcm;
+        unsigned i;
+
+        for (i = 0; i < 4; i++) {
+            samples[i] = vminq_s32(vmaxq_s32(vld1q_s32(int_samples + i * 4),
+                                             min),
+                                   max);
+        }
+        pcm.val[is_big_endian ? 2 : 0] = byte_plane(samples, 0);
+        pcm.val[1] = byte_plane(samples, 8);
+        pcm.val[is_big_endian ? 0 : 2] = byte_plane(samples, 16);
+        vst3q_u8(pcm_samples, pcm);
+        int_samples += 16;
+        pcm_samples += 48;
+    }
+
+    if (is_big_endian) {
+        int_to_SB24_pcm(total_samples, int_samples, pcm_samples);
+    } else {
+        int_to_SL24_pcm(total_samples, int_samples, pcm_samples);
+    }
+}
+
+#define PCM_CONV_NEON_IMPL(name, width, is_big_endian)                  \
+    static void                                                         \
+    pcm_##name##_to_int_neon(unsigned total_samples,                    \
+                             const unsigned char pcm_samples[],         \
+                             int int_samples[])                         \
+    {                                                                   \
+        pcm_S##width##_to_int_neon(total_samples, pcm_samples,          \
+                                   int_samples, is_big_endian);         \
+    }                                                                   \
+                                                                        \
+    static void                                                         \
+    int_to_##name##_pcm_neon(unsigned total_samples,                    \
+                             const int int_samples[],                   \
+                             unsigned char pcm_samples[])               \
+    {                                                                   \
+        int_to_S##width##_pcm_neon(total_samples, int_samples,          \
+                                   pcm_samples, is_big_endian);         \
+    }
+
+PCM_CONV_NEON_IMPL(SB16, 16, 1)
+PCM_CONV_NEON_IMPL(SL16, 16, 0)
+PCM_CONV_NEON_IMPL(SB24, 24, 1)
+PCM_CONV_NEON_IMPL(SL24, 24, 0)
+#endif
+
+#define SET_KERNELS(isa)                                     \
+    pcm_to_int_table[1][0][1] = pcm_SL16_to_int_##isa;       \
+    pcm_to_int_table[1][1][1] = pcm_SB16_to_int_##isa;       \
+    pcm_to_int_table[2][0][1] = pcm_SL24_to_int_##isa;       \
+    pcm_to_int_table[2][1][1] = pcm_SB24_to_int_##isa;       \
+    int_to_pcm_table[1][0][1] = int_to_SL16_pcm_##isa;       \
+    int_to_pcm_table[1][1][1] = int_to_SB16_pcm_##isa;       \
+    int_to_pcm_table[2][0][1] = int_to_SL24_pcm_##isa;       \
+    int_to_pcm_table[2][1][1] = int_to_SB24_pcm_##isa;
+
+static void
+init_dispatch(void)
+{
+    static volatile int initialized = 0;
+
+    if (initialized) {
+        return;
+    }
+#if defined(CPU_X86)
+    if (cpu_features() & CPU_AVX2) {
+        SET_KERNELS(avx2)
+    } else if (cpu_features() & CPU_SSE4_1) {
+        SET_KERNELS(sse4_1)
+    }
+#elif defined(PCM_CONV_NEON_KERNELS)
+    if (cpu_features() & CPU_NEON) {
+        SET_KERNELS(neon)
+    }
+#endif
+    initialized = 1;
+}
+
 #include <stdio.h>
 
 #define PCM_INT_CONV(BITS, NEGATIVE_MIN, POSITIVE_MAX)                     \
@@ -5,6 +5,7 @@
 #include "pcm_conv.h"
 #include "bitstream.h"
 #include "samplerate/samplerate.h"
+#include "common/stats.h"
 #include "pcmconverter.h"
 #include "dither.c"
 
@@ -129,6 +130,8 @@ Averager_read(pcmconverter_Averager *self, PyObject *args)
         return NULL;
     }
 
+    STATS_START(convert_timer);
+
     framelist = new_FrameList(self->audiotools_pcm,
                               1,
                               self->pcmreader->bits_per_sample,
@@ -144,6 +147,10 @@ Averager_read(pcmconverter_Averager *self, PyObject *args)
                    (int)(accumulator / channel_count));
     }
 
+    STATS_STOP(convert_timer,
+               STATS_PCMCONVERTER_AVERAGER,
+               frames_read * channel_count);
+
     return (PyObject*)framelist;
 }
 
@@ -249,6 +256,8 @@ Downmixer_read(pcmconverter_Downmixer *self, PyObject *args)
         return NULL;
     }
 
+    STATS_START(convert_timer);
+
     framelist = new_FrameList(self->audiotools_pcm,
                               2,
                               self->pcmreader->bits_per_sample,
@@ -309,6 +318,10 @@ Downmixer_read(pcmconverter_Downmixer *self, PyObject *args)
                    (int)(MAX(MIN(right_i, SAMPLE_MAX), SAMPLE_MIN)));
     }
 
+    STATS_STOP(convert_timer,
+               STATS_PCMCONVERTER_DOWNMIXER,
+               frames_read * self->pcmreader->channels);
+
     return (PyObject*)framelist;
 }
 
@@ -421,6 +434,8 @@ Resampler_read(pcmconverter_Resampler *self, PyObject *args)
         return NULL;
     }
 
+    STATS_START(convert_timer);
+
     /*convert data to floats and append them to input buffer*/
     int_to_float_converter(
         bits_per_sample)(frames_read * channels,
@@ -455,6 +470,10 @@ Resampler_read(pcmconverter_Resampler *self, PyObject *args)
                          self->src_data.data_out,
                          framelist->samples);
 
+    STATS_STOP(convert_timer,
+               STATS_PCMCONVERTER_RESAMPLER,
+               frames_read * channels);
+
     /*return built FrameList*/
     return (PyObject*)framelist;
 }
@@ -613,6 +632,8 @@ BPSConverter_read(pcmconverter_BPSConverter *self, PyObject *args)
 
     framelist->frames = frames_read;
 
+    STATS_START(convert_timer);
+
     if (shift > 0) {
         /*going from fewer bits-per-sample to more, like 16 to 24 bps
           so perform left shift on each sample*/
@@ -634,6 +655,10 @@ BPSConverter_read(pcmconverter_BPSConverter *self, PyObject *args)
         }
     }
 
+    STATS_STOP(convert_timer,
+               STATS_PCMCONVERTER_BPSCONVERTER,
+               FrameList_samples_length(framelist));
+
     return (PyObject*)framelist;
 }
 
@@ -1083,6 +1108,363 @@ FadeOutReader_close(pcmconverter_FadeOutReader *self, PyObject *args)
 }
 
 
+/*******************************************************
+ PCMCat, PCMReaderHead, PCMReaderDeHead, LimitedPCMReader
+*******************************************************/
+
+static PyObject*
+Combinator_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    pcmconverter_Combinator *self;
+
+    self = (pcmconverter_Combinator *)type->tp_alloc(type, 0);
+
+    return (PyObject *)self;
+}
+
+/*returns a PCMReader struct for reading from the given parent object,
+  or NULL with an exception set if an error occurs
+
+  if the parent is one of the combinators in this module
+  (but not a Python subclass of one, which may override read())
+  its PCMReader is read directly*/
+static struct PCMReader*
+open_parent_pcmreader(PyObject *obj)
+{
+    if ((Py_TYPE(obj) == &pcmconverter_PCMCatType) ||
+        (Py_TYPE(obj) == &pcmconverter_PCMReaderHeadType) ||
+        (Py_TYPE(obj) == &pcmconverter_PCMReaderDeHeadType) ||
+        (Py_TYPE(obj) == &pcmconverter_LimitedPCMReaderType)) {
+        pcmconverter_Combinator *parent = (pcmconverter_Combinator*)obj;
+        if (parent->pcmreader) {
+            return pcmreader_open_borrowed(obj, &(parent->pcmreader));
+        } else {
+            PyErr_SetString(PyExc_ValueError, "uninitialized PCMReader");
+            return NULL;
+        }
+    } else {
+        return pcmreader_open_python(obj);
+    }
+}
+
+/*sets ValueError with the named message from audiotools.text*/
+static void
+set_text_error(const char *name)
+{
+    PyObject *text;
+    PyObject *message;
+
+    if ((text = PyImport_ImportModule("audiotools.text")) == NULL)
+        return;
+    message = PyObject_GetAttrString(text, name);
+    Py_DECREF(text);
+    if (message) {
+        PyErr_SetObject(PyExc_ValueError, message);
+        Py_DECREF(message);
+    }
+}
+
+static int
+Combinator_init(pcmconverter_Combinator *self)
+{
+    /*release whatever an earlier __init__ call opened*/
+    if (self->pcmreader) {
+        self->pcmreader->del(self->pcmreader);
+        self->pcmreader = NULL;
+    }
+    Py_CLEAR(self->audiotools_pcm);
+
+    self->closed = 0;
+    if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
+        return -1;
+    return 0;
+}
+
+int
+PCMCat_init(pcmconverter_Combinator *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *pcmreaders_obj;
+    PyObject *pcmreaders_seq;
+    Py_ssize_t count;
+    struct PCMReader **readers;
+    Py_ssize_t i;
+
+    if (Combinator_init(self))
+        return -1;
+
+    if (!PyArg_ParseTuple(args, "O", &pcmreaders_obj))
+        return -1;
+
+    if ((pcmreaders_seq = PySequence_Fast(pcmreaders_obj,
+                                          "pcmreaders must be a sequence"))
+        == NULL)
+        return -1;
+
+    if ((count = PySequence_Fast_GET_SIZE(pcmreaders_seq)) == 0) {
+        Py_DECREF(pcmreaders_seq);
+        set_text_error("ERR_NO_PCMREADERS");
+        return -1;
+    }
+
+    if ((readers = malloc(sizeof(struct PCMReader*) * count)) == NULL) {
+        Py_DECREF(pcmreaders_seq);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        PyObject *obj = PySequence_Fast_GET_ITEM(pcmreaders_seq, i);
+
+        if ((readers[i] = open_parent_pcmreader(obj)) == NULL)
+            goto error;
+
+        if (readers[i]->sample_rate != readers[0]->sample_rate) {
+            set_text_error("ERR_SAMPLE_RATE_MISMATCH");
+            i++;
+            goto error;
+        } else if (readers[i]->channels != readers[0]->channels) {
+            set_text_error("ERR_CHANNEL_COUNT_MISMATCH");
+            i++;
+            goto error;
+        } else if (readers[i]->bits_per_sample !=
+                   readers[0]->bits_per_sample) {
+            set_text_error("ERR_BPS_MISMATCH");
+            i++;
+            goto error;
+        }
+    }
+
+    Py_DECREF(pcmreaders_seq);
+    self->pcmreader = pcmreader_open_cat(readers, (unsigned)count);
+    free(readers);
+    return 0;
+
+error:
+    /*delete the readers opened so far*/
+    while (i > 0) {
+        i--;
+        readers[i]->del(readers[i]);
+    }
+    free(readers);
+    Py_DECREF(pcmreaders_seq);
+    return -1;
+}
+
+int
+PCMReaderHead_init(pcmconverter_Combinator *self,
+                   PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"pcmreader", "pcm_frames", "forward_close",
+                             NULL};
+    PyObject *pcmreader_obj;
+    PY_LONG_LONG pcm_frames;
+    int forward_close = 1;
+    struct PCMReader *parent;
+
+    if (Combinator_init(self))
+        return -1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OL|i", kwlist,
+                                     &pcmreader_obj,
+                                     &pcm_frames,
+                                     &forward_close))
+        return -1;
+
+    if (pcm_frames < 0) {
+        PyErr_SetString(PyExc_ValueError, "invalid pcm_frames value");
+        return -1;
+    }
+
+    if ((parent = open_parent_pcmreader(pcmreader_obj)) == NULL)
+        return -1;
+
+    self->pcmreader = pcmreader_open_head(parent,
+                                          (uint64_t)pcm_frames,
+                                          1,
+                                          forward_close);
+    return 0;
+}
+
+int
+PCMReaderDeHead_init(pcmconverter_Combinator *self,
+                     PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"pcmreader", "pcm_frames", "forward_close",
+                             NULL};
+    PyObject *pcmreader_obj;
+    PY_LONG_LONG pcm_frames;
+    int forward_close = 1;
+    struct PCMReader *parent;
+
+    if (Combinator_init(self))
+        return -1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OL|i", kwlist,
+                                     &pcmreader_obj,
+                                     &pcm_frames,
+                                     &forward_close))
+        return -1;
+
+    if ((parent = open_parent_pcmreader(pcmreader_obj)) == NULL)
+        return -1;
+
+    self->pcmreader = pcmreader_open_dehead(parent,
+                                            (int64_t)pcm_frames,
+                                            forward_close);
+    return 0;
+}
+
+int
+LimitedPCMReader_init(pcmconverter_Combinator *self,
+                      PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"buffered_pcmreader", "total_pcm_frames", NULL};
+    PyObject *pcmreader_obj;
+    PY_LONG_LONG total_pcm_frames;
+    struct PCMReader *parent;
+
+    if (Combinator_init(self))
+        return -1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OL", kwlist,
+                                     &pcmreader_obj,
+                                     &total_pcm_frames))
+        return -1;
+
+    if ((parent = open_parent_pcmreader(pcmreader_obj)) == NULL)
+        return -1;
+
+    /*closing a LimitedPCMReader leaves its parent open*/
+    self->pcmreader = pcmreader_open_head(parent,
+                                          (uint64_t)MAX(total_pcm_frames, 0),
+                                          0,
+                                          0);
+    return 0;
+}
+
+void
+Combinator_dealloc(pcmconverter_Combinator *self)
+{
+    if (self->pcmreader)
+        self->pcmreader->del(self->pcmreader);
+    Py_XDECREF(self->audiotools_pcm);
+
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+/*returns 1 if the combinator's PCMReader has been opened
+  or 0 with ValueError set if __init__ failed or was never called*/
+static int
+Combinator_initialized(pcmconverter_Combinator *self)
+{
+    if (self->pcmreader) {
+        return 1;
+    } else {
+        PyErr_SetString(PyExc_ValueError, "uninitialized PCMReader");
+        return 0;
+    }
+}
+
+static PyObject*
+Combinator_sample_rate(pcmconverter_Combinator *self, void *closure)
+{
+    if (!Combinator_initialized(self))
+        return NULL;
+    return Py_BuildValue("I", self->pcmreader->sample_rate);
+}
+
+static PyObject*
+Combinator_bits_per_sample(pcmconverter_Combinator *self, void *closure)
+{
+    if (!Combinator_initialized(self))
+        return NULL;
+    return Py_BuildValue("I", self->pcmreader->bits_per_sample);
+}
+
+static PyObject*
+Combinator_channels(pcmconverter_Combinator *self, void *closure)
+{
+    if (!Combinator_initialized(self))
+        return NULL;
+    return Py_BuildValue("I", self->pcmreader->channels);
+}
+
+static PyObject*
+Combinator_channel_mask(pcmconverter_Combinator *self, void *closure)
+{
+    if (!Combinator_initialized(self))
+        return NULL;
+    return Py_BuildValue("I", self->pcmreader->channel_mask);
+}
+
+static PyObject*
+Combinator_read(pcmconverter_Combinator *self, PyObject *args)
+{
+    int pcm_frames;
+    pcm_FrameList *framelist;
+    unsigned frames_read;
+
+    if (!PyArg_ParseTuple(args, "i", &pcm_frames)) {
+        return NULL;
+    } else if (pcm_frames <= 0) {
+        PyErr_SetString(PyExc_ValueError, "PCM frames must be >= 1");
+        return NULL;
+    } else if (!Combinator_initialized(self)) {
+        return NULL;
+    } else if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read from closed stream");
+        return NULL;
+    }
+
+    framelist = new_FrameList(self->audiotools_pcm,
+                              self->pcmreader->channels,
+                              self->pcmreader->bits_per_sample,
+                              pcm_frames);
+
+    frames_read = self->pcmreader->read(self->pcmreader,
+                                        pcm_frames,
+                                        framelist->samples);
+
+    if (!frames_read && (self->pcmreader->status != PCM_OK)) {
+        Py_DECREF((PyObject*)framelist);
+        /*keep any exception raised by a wrapped PCMReader's read()*/
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_IOError, "I/O error reading from stream");
+        }
+        return NULL;
+    }
+
+    framelist->frames = frames_read;
+
+    return (PyObject*)framelist;
+}
+
+static PyObject*
+Combinator_close(pcmconverter_Combinator *self, PyObject *args)
+{
+    if (!self->closed) {
+        self->closed = 1;
+        if (self->pcmreader)
+            self->pcmreader->close(self->pcmreader);
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject*
+Combinator_enter(pcmconverter_Combinator *self, PyObject *args)
+{
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject*
+Combinator_exit(pcmconverter_Combinator *self, PyObject *args)
+{
+    return Combinator_close(self, NULL);
+}
+
+
 MOD_INIT(pcmconverter)
 {
     PyObject* m;
@@ -1090,6 +1472,9 @@ MOD_INIT(pcmconverter)
     MOD_DEF(m, "pcmconverter", "a PCM stream conversion module",
             module_methods)
 
+    stats_init();
+    src_init_dispatch();
+
     pcmconverter_AveragerType.tp_new = PyType_GenericNew;
     if (PyType_Ready(&pcmconverter_AveragerType) < 0)
         return MOD_ERROR_VAL;
@@ -1118,6 +1503,22 @@ MOD_INIT(pcmconverter)
     if (PyType_Ready(&pcmconverter_FadeOutReaderType) < 0)
         return MOD_ERROR_VAL;
 
+    pcmconverter_PCMCatType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&pcmconverter_PCMCatType) < 0)
+        return MOD_ERROR_VAL;
+
+    pcmconverter_PCMReaderHeadType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&pcmconverter_PCMReaderHeadType) < 0)
+        return MOD_ERROR_VAL;
+
+    pcmconverter_PCMReaderDeHeadType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&pcmconverter_PCMReaderDeHeadType) < 0)
+        return MOD_ERROR_VAL;
+
+    pcmconverter_LimitedPCMReaderType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&pcmconverter_LimitedPCMReaderType) < 0)
+        return MOD_ERROR_VAL;
+
     Py_INCREF(&pcmconverter_AveragerType);
     PyModule_AddObject(m, "Averager",
                        (PyObject *)&pcmconverter_AveragerType);
@@ -1146,5 +1547,21 @@ MOD_INIT(pcmconverter)
     PyModule_AddObject(m, "FadeOutReader",
                        (PyObject *)&pcmconverter_FadeOutReaderType);
 
+    Py_INCREF(&pcmconverter_PCMCatType);
+    PyModule_AddObject(m, "PCMCat",
+                       (PyObject *)&pcmconverter_PCMCatType);
+
+    Py_INCREF(&pcmconverter_PCMReaderHeadType);
+    PyModule_AddObject(m, "PCMReaderHead",
+                       (PyObject *)&pcmconverter_PCMReaderHeadType);
+
+    Py_INCREF(&pcmconverter_PCMReaderDeHeadType);
+    PyModule_AddObject(m, "PCMReaderDeHead",
+                       (PyObject *)&pcmconverter_PCMReaderDeHeadType);
+
+    Py_INCREF(&pcmconverter_LimitedPCMReaderType);
+    PyModule_AddObject(m, "LimitedPCMReader",
+                       (PyObject *)&pcmconverter_LimitedPCMReaderType);
+
     return MOD_SUCCESS_VAL(m);
 }
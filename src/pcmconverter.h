@@ -18,6 +18,7 @@
 *******************************************************/
 
 PyMethodDef module_methods[] = {
+    STATS_METHODS,
     {NULL}
 };
 
@@ -705,3 +706,140 @@ PyTypeObject pcmconverter_FadeOutReaderType = {
     0,                         /* tp_alloc */
     FadeOutReader_new,         /* tp_new */
 };
+
+
+/*PCMCat, PCMReaderHead, PCMReaderDeHead and LimitedPCMReader
+  share a layout and everything but their initializers,
+  since each simply wraps one of pcmreader's combined readers
+
+  when one is given another of these as its parent,
+  it reads the parent's PCMReader struct directly
+  rather than going through its read() method*/
+typedef struct {
+    PyObject_HEAD
+
+    int closed;
+    struct PCMReader *pcmreader;
+    PyObject *audiotools_pcm;
+} pcmconverter_Combinator;
+
+static PyObject*
+Combinator_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+int
+PCMCat_init(pcmconverter_Combinator *self, PyObject *args, PyObject *kwds);
+
+int
+PCMReaderHead_init(pcmconverter_Combinator *self,
+                   PyObject *args, PyObject *kwds);
+
+int
+PCMReaderDeHead_init(pcmconverter_Combinator *self,
+                     PyObject *args, PyObject *kwds);
+
+int
+LimitedPCMReader_init(pcmconverter_Combinator *self,
+                      PyObject *args, PyObject *kwds);
+
+void
+Combinator_dealloc(pcmconverter_Combinator *self);
+
+static PyObject*
+Combinator_sample_rate(pcmconverter_Combinator *self, void *closure);
+
+static PyObject*
+Combinator_bits_per_sample(pcmconverter_Combinator *self, void *closure);
+
+static PyObject*
+Combinator_channels(pcmconverter_Combinator *self, void *closure);
+
+static PyObject*
+Combinator_channel_mask(pcmconverter_Combinator *self, void *closure);
+
+static PyObject*
+Combinator_read(pcmconverter_Combinator *self, PyObject *args);
+
+static PyObject*
+Combinator_close(pcmconverter_Combinator *self, PyObject *args);
+
+static PyObject*
+Combinator_enter(pcmconverter_Combinator *self, PyObject *args);
+
+static PyObject*
+Combinator_exit(pcmconverter_Combinator *self, PyObject *args);
+
+PyGetSetDef Combinator_getseters[] = {
+    {"sample_rate", (getter)Combinator_sample_rate,
+     NULL, "sample rate", NULL},
+    {"bits_per_sample", (getter)Combinator_bits_per_sample,
+     NULL, "bits per sample", NULL},
+    {"channels", (getter)Combinator_channels,
+     NULL, "channels", NULL},
+    {"channel_mask", (getter)Combinator_channel_mask,
+     NULL, "channel_mask", NULL},
+    {NULL}
+};
+
+PyMethodDef Combinator_methods[] = {
+    {"read", (PyCFunction)Combinator_read, METH_VARARGS, ""},
+    {"close", (PyCFunction)Combinator_close, METH_NOARGS, ""},
+    {"__enter__", (PyCFunction)Combinator_enter,
+     METH_NOARGS, "enter() -> self"},
+    {"__exit__", (PyCFunction)Combinator_exit,
+     METH_VARARGS, "exit(exc_type, exc_value, traceback) -> None"},
+    {NULL}
+};
+
+#define COMBINATOR_TYPE(name, doc)                                   \
+PyTypeObject pcmconverter_##name##Type = {                           \
+    PyVarObject_HEAD_INIT(NULL, 0)                                   \
+    "pcmconverter." #name,     /*tp_name*/                           \
+    sizeof(pcmconverter_Combinator), /*tp_basicsize*/                \
+    0,                         /*tp_itemsize*/                       \
+    (destructor)Combinator_dealloc, /*tp_dealloc*/                   \
+    0,                         /*tp_print*/                          \
+    0,                         /*tp_getattr*/                        \
+    0,                         /*tp_setattr*/                        \
+    0,                         /*tp_compare*/                        \
+    0,                         /*tp_repr*/                           \
+    0,                         /*tp_as_number*/                      \
+    0,                         /*tp_as_sequence*/                    \
+    0,                         /*tp_as_mapping*/                     \
+    0,                         /*tp_hash */                          \
+    0,                         /*tp_call*/                           \
+    0,                         /*tp_str*/                            \
+    0,                         /*tp_getattro*/                       \
+    0,                         /*tp_setattro*/                       \
+    0,                         /*tp_as_buffer*/                      \
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/           \
+    doc,                       /* tp_doc */                          \
+    0,                         /* tp_traverse */                     \
+    0,                         /* tp_clear */                        \
+    0,                         /* tp_richcompare */                  \
+    0,                         /* tp_weaklistoffset */               \
+    0,                         /* tp_iter */                         \
+    0,                         /* tp_iternext */                     \
+    Combinator_methods,        /* tp_methods */                      \
+    0,                         /* tp_members */                      \
+    Combinator_getseters,      /* tp_getset */                       \
+    0,                         /* tp_base */                         \
+    0,                         /* tp_dict */                         \
+    0,                         /* tp_descr_get */                    \
+    0,                         /* tp_descr_set */                    \
+    0,                         /* tp_dictoffset */                   \
+    (initproc)name##_init,     /* tp_init */                         \
+    0,                         /* tp_alloc */                        \
+    Combinator_new,            /* tp_new */                          \
+};
+
+COMBINATOR_TYPE(PCMCat,
+                "PCMCat(pcmreaders) -- concatenates several PCMReaders")
+COMBINATOR_TYPE(PCMReaderHead,
+                "PCMReaderHead(pcmreader, pcm_frames, forward_close=True)"
+                " -- truncates or pads a stream's ending")
+COMBINATOR_TYPE(PCMReaderDeHead,
+                "PCMReaderDeHead(pcmreader, pcm_frames, forward_close=True)"
+                " -- truncates or pads a stream's beginning")
+COMBINATOR_TYPE(LimitedPCMReader,
+                "LimitedPCMReader(buffered_pcmreader, total_pcm_frames)"
+                " -- reads up to a number of frames from a stream")
@@ -1,5 +1,6 @@
-#include <stdlib.h>
 #include "pcmreader.h"
+#include <stdlib.h>
+#include <string.h>
 
 #ifndef MIN
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
@@ -41,7 +42,11 @@ READER_DEFS(raw)
 READER_DEFS(error)
 #else
 READER_DEFS(python)
+READER_DEFS(borrowed)
 #endif
+READER_DEFS(cat)
+READER_DEFS(head)
+READER_DEFS(dehead)
 
 
 #ifdef STANDALONE
@@ -199,8 +204,105 @@ py_obj_to_pcmreader(PyObject *obj, void **pcmreader)
         return 0;
     }
 }
+
+struct PCMReader*
+pcmreader_open_borrowed(PyObject *obj, struct PCMReader **reader)
+{
+    struct PCMReader *borrowed = malloc(sizeof(struct PCMReader));
+
+    Py_INCREF(obj);
+    borrowed->input.borrowed.obj = obj;
+    borrowed->input.borrowed.reader = reader;
+
+    borrowed->sample_rate = (*reader)->sample_rate;
+    borrowed->channels = (*reader)->channels;
+    borrowed->channel_mask = (*reader)->channel_mask;
+    borrowed->bits_per_sample = (*reader)->bits_per_sample;
+
+    borrowed->status = PCM_OK;
+
+    borrowed->read = pcmreader_borrowed_read;
+    borrowed->close = pcmreader_borrowed_close;
+    borrowed->del = pcmreader_borrowed_del;
+    return borrowed;
+}
 #endif
 
+struct PCMReader*
+pcmreader_open_cat(struct PCMReader **readers, unsigned count)
+{
+    struct PCMReader *reader = malloc(sizeof(struct PCMReader));
+
+    reader->input.cat.readers = malloc(sizeof(struct PCMReader*) * count);
+    memcpy(reader->input.cat.readers,
+           readers,
+           sizeof(struct PCMReader*) * count);
+    reader->input.cat.count = count;
+    reader->input.cat.index = 0;
+
+    reader->sample_rate = readers[0]->sample_rate;
+    reader->channels = readers[0]->channels;
+    reader->channel_mask = readers[0]->channel_mask;
+    reader->bits_per_sample = readers[0]->bits_per_sample;
+
+    reader->status = PCM_OK;
+
+    reader->read = pcmreader_cat_read;
+    reader->close = pcmreader_cat_close;
+    reader->del = pcmreader_cat_del;
+    return reader;
+}
+
+struct PCMReader*
+pcmreader_open_head(struct PCMReader *parent,
+                    uint64_t pcm_frames,
+                    int pad,
+                    int forward_close)
+{
+    struct PCMReader *reader = malloc(sizeof(struct PCMReader));
+
+    reader->input.head.reader = parent;
+    reader->input.head.remaining = pcm_frames;
+    reader->input.head.pad = pad;
+    reader->input.head.forward_close = forward_close;
+
+    reader->sample_rate = parent->sample_rate;
+    reader->channels = parent->channels;
+    reader->channel_mask = parent->channel_mask;
+    reader->bits_per_sample = parent->bits_per_sample;
+
+    reader->status = PCM_OK;
+
+    reader->read = pcmreader_head_read;
+    reader->close = pcmreader_head_close;
+    reader->del = pcmreader_head_del;
+    return reader;
+}
+
+struct PCMReader*
+pcmreader_open_dehead(struct PCMReader *parent,
+                      int64_t pcm_frames,
+                      int forward_close)
+{
+    struct PCMReader *reader = malloc(sizeof(struct PCMReader));
+
+    reader->input.dehead.reader = parent;
+    reader->input.dehead.offset = pcm_frames;
+    reader->input.dehead.forward_close = forward_close;
+
+    reader->sample_rate = parent->sample_rate;
+    reader->channels = parent->channels;
+    reader->channel_mask = parent->channel_mask;
+    reader->bits_per_sample = parent->bits_per_sample;
+
+    reader->status = PCM_OK;
+
+    reader->read = pcmreader_dehead_read;
+    reader->close = pcmreader_dehead_close;
+    reader->del = pcmreader_dehead_del;
+    return reader;
+}
+
 void
 get_channel_data(const int *pcm_data,
                  unsigned channel_number,
@@ -424,8 +526,205 @@ pcmreader_python_del(struct PCMReader *self) {
     free(self);
 }
 
+static unsigned
+pcmreader_borrowed_read(struct PCMReader *self,
+                        unsigned pcm_frames,
+                        int *pcm_data)
+{
+    struct PCMReader *reader = *(self->input.borrowed.reader);
+    unsigned frames_read;
+
+    /*the owner's reader may have been replaced by another __init__ call
+      and its samples must still fit pcm_data*/
+    if ((reader == NULL) ||
+        (reader->channels != self->channels) ||
+        (reader->bits_per_sample != self->bits_per_sample)) {
+        PyErr_SetString(PyExc_ValueError, "parent PCMReader has changed");
+        self->status = PCM_READ_ERROR;
+        return 0;
+    }
+
+    frames_read = reader->read(reader, pcm_frames, pcm_data);
+    self->status = reader->status;
+    return frames_read;
+}
+
+static void
+pcmreader_borrowed_close(struct PCMReader *self)
+{
+    PyObject *result =
+        PyObject_CallMethod(self->input.borrowed.obj, "close", NULL);
+    if (result) {
+        Py_DECREF(result);
+    } else {
+        PyErr_Clear();
+    }
+}
+
+static void
+pcmreader_borrowed_del(struct PCMReader *self)
+{
+    Py_DECREF(self->input.borrowed.obj);
+    free(self);
+}
+
 #endif
 
+static unsigned
+pcmreader_cat_read(struct PCMReader *self,
+                   unsigned pcm_frames,
+                   int *pcm_data)
+{
+    /*read from the current reader until it's exhausted,
+      then move on to the next*/
+    while (self->input.cat.index < self->input.cat.count) {
+        struct PCMReader *reader =
+            self->input.cat.readers[self->input.cat.index];
+        const unsigned frames_read =
+            reader->read(reader, pcm_frames, pcm_data);
+
+        if (frames_read) {
+            return frames_read;
+        } else if (reader->status != PCM_OK) {
+            self->status = reader->status;
+            return 0;
+        } else {
+            self->input.cat.index += 1;
+        }
+    }
+
+    return 0;
+}
+
+static void
+pcmreader_cat_close(struct PCMReader *self)
+{
+    unsigned i;
+    for (i = 0; i < self->input.cat.count; i++) {
+        struct PCMReader *reader = self->input.cat.readers[i];
+        reader->close(reader);
+    }
+}
+
+static void
+pcmreader_cat_del(struct PCMReader *self)
+{
+    unsigned i;
+    for (i = 0; i < self->input.cat.count; i++) {
+        struct PCMReader *reader = self->input.cat.readers[i];
+        reader->del(reader);
+    }
+    free(self->input.cat.readers);
+    free(self);
+}
+
+static unsigned
+pcmreader_head_read(struct PCMReader *self,
+                    unsigned pcm_frames,
+                    int *pcm_data)
+{
+    struct PCMReader *reader = self->input.head.reader;
+    const unsigned to_read =
+        (unsigned)MIN(pcm_frames, self->input.head.remaining);
+    unsigned frames_read;
+
+    if (!to_read) {
+        /*window exhausted*/
+        return 0;
+    }
+
+    if ((frames_read = reader->read(reader, to_read, pcm_data)) > 0) {
+        self->input.head.remaining -= frames_read;
+        return frames_read;
+    } else if (reader->status != PCM_OK) {
+        self->status = reader->status;
+        return 0;
+    } else if (self->input.head.pad) {
+        /*parent is exhausted, so fill the rest of the window
+          with silence*/
+        memset(pcm_data, 0, sizeof(int) * to_read * self->channels);
+        self->input.head.remaining -= to_read;
+        return to_read;
+    } else {
+        self->input.head.remaining = 0;
+        return 0;
+    }
+}
+
+static void
+pcmreader_head_close(struct PCMReader *self)
+{
+    if (self->input.head.forward_close) {
+        struct PCMReader *reader = self->input.head.reader;
+        reader->close(reader);
+    }
+}
+
+static void
+pcmreader_head_del(struct PCMReader *self)
+{
+    struct PCMReader *reader = self->input.head.reader;
+    reader->del(reader);
+    free(self);
+}
+
+static unsigned
+pcmreader_dehead_read(struct PCMReader *self,
+                      unsigned pcm_frames,
+                      int *pcm_data)
+{
+    struct PCMReader *reader = self->input.dehead.reader;
+    unsigned frames_read;
+
+    if (self->input.dehead.offset < 0) {
+        /*pad beginning of stream with silence*/
+        const unsigned to_pad =
+            (unsigned)MIN(pcm_frames, -self->input.dehead.offset);
+        memset(pcm_data, 0, sizeof(int) * to_pad * self->channels);
+        self->input.dehead.offset += to_pad;
+        return to_pad;
+    }
+
+    /*remove PCM frames from the beginning of the stream,
+      using the output buffer as scratch space*/
+    while (self->input.dehead.offset > 0) {
+        const unsigned to_skip =
+            (unsigned)MIN(pcm_frames, self->input.dehead.offset);
+
+        if ((frames_read = reader->read(reader, to_skip, pcm_data)) > 0) {
+            self->input.dehead.offset -= frames_read;
+        } else if (reader->status != PCM_OK) {
+            self->status = reader->status;
+            return 0;
+        } else {
+            /*truncation longer than entire stream*/
+            self->input.dehead.offset = 0;
+            return 0;
+        }
+    }
+
+    frames_read = reader->read(reader, pcm_frames, pcm_data);
+    self->status = reader->status;
+    return frames_read;
+}
+
+static void
+pcmreader_dehead_close(struct PCMReader *self)
+{
+    if (self->input.dehead.forward_close) {
+        struct PCMReader *reader = self->input.dehead.reader;
+        reader->close(reader);
+    }
+}
+
+static void
+pcmreader_dehead_del(struct PCMReader *self)
+{
+    struct PCMReader *reader = self->input.dehead.reader;
+    reader->del(reader);
+    free(self);
+}
+
 #ifdef EXECUTABLE
 
 #define BLOCKSIZE 48000
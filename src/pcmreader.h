@@ -3,6 +3,7 @@
 #include "pcm.h"
 #endif
 #include <stdio.h>
+#include <stdint.h>
 #include "pcm_conv.h"
 
 /********************************************************
@@ -54,7 +55,28 @@ struct PCMReader {
             pcm_FrameList *framelist;  /*framelist object*/
             unsigned frames_remaining; /*frames remaining in framelist*/
         } python;
+        struct {
+            PyObject *obj;             /*Python object owning "reader"*/
+            struct PCMReader **reader; /*obj's reader, read directly*/
+        } borrowed;
         #endif
+        struct {
+            struct PCMReader **readers; /*readers to concatenate*/
+            unsigned count;             /*total number of readers*/
+            unsigned index;             /*reader currently being read*/
+        } cat;
+        struct {
+            struct PCMReader *reader;   /*parent reader*/
+            uint64_t remaining;         /*PCM frames left in window*/
+            int pad;                    /*pad short streams with silence*/
+            int forward_close;          /*close parent on close*/
+        } head;
+        struct {
+            struct PCMReader *reader;   /*parent reader*/
+            int64_t offset;             /*frames to skip if positive,
+                                          or to pad if negative*/
+            int forward_close;          /*close parent on close*/
+        } dehead;
     } input;
 
     unsigned sample_rate;
@@ -121,8 +143,50 @@ pcmreader_open_python(PyObject *obj);
 int
 py_obj_to_pcmreader(PyObject *obj, void **pcmreader);
 
+/*wraps a PCMReader struct around a reader owned by a Python object,
+  such as one of pcmconverter's readers,
+  reading from it directly rather than through obj.read()
+
+  "reader" points to where obj keeps its reader,
+  which obj.__init__ may replace or set to NULL,
+  so it's looked up again on every read
+
+  calls to close are forwarded to obj.close()*/
+struct PCMReader*
+pcmreader_open_borrowed(PyObject *obj, struct PCMReader **reader);
+
 #endif
 
+/*the following readers take ownership of their parent readers
+  and delete them when they themselves are deleted*/
+
+/*concatenates "count" readers, which must all have
+  the same sample rate, channel count and bits-per-sample
+
+  the array of readers is copied
+  and the stream takes the first reader's channel mask
+
+  closing the stream closes all of its readers*/
+struct PCMReader*
+pcmreader_open_cat(struct PCMReader **readers, unsigned count);
+
+/*truncates the parent stream to "pcm_frames" PCM frames
+
+  if "pad" is set, a shorter parent stream is extended with silence
+  to "pcm_frames" in total, otherwise the stream just ends early*/
+struct PCMReader*
+pcmreader_open_head(struct PCMReader *reader,
+                    uint64_t pcm_frames,
+                    int pad,
+                    int forward_close);
+
+/*removes "pcm_frames" PCM frames from the beginning of the parent stream
+  if positive, or prepends that many frames of silence if negative*/
+struct PCMReader*
+pcmreader_open_dehead(struct PCMReader *reader,
+                      int64_t pcm_frames,
+                      int forward_close);
+
 /*pcm_data must contain at least:  channel_count * pcm_frames  entries
 
   channel_data must contain at least:  pcm_frames  entries
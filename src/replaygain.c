@@ -64,6 +64,10 @@ PyMethodDef ReplayGain_methods[] = {
      METH_NOARGS, "album_peak() -> album peak float"},
     {"next_title", (PyCFunction)ReplayGain_next_title,
      METH_NOARGS, "call after each title is completed"},
+    {"album_state", (PyCFunction)ReplayGain_album_state,
+     METH_NOARGS, "album_state() -> album analysis as bytes"},
+    {"add_album_state", (PyCFunction)ReplayGain_add_album_state,
+     METH_VARARGS, "add_album_state(bytes) -> None"},
     {NULL}
 };
 
@@ -374,6 +378,64 @@ ReplayGain_album_peak(replaygain_ReplayGain *self)
     return Py_BuildValue("d", self->album_peak);
 }
 
+/*the album analysis of completed titles in native byte order,
+  which is only meaningful to ReplayGain objects on the same machine*/
+struct replaygain_album_state {
+    unsigned sample_rate;
+    double album_peak;
+    uint32_t histogram[STEPS_per_dB_times_MAX_dB];
+};
+
+PyObject*
+ReplayGain_album_state(replaygain_ReplayGain *self)
+{
+    struct replaygain_album_state state;
+
+    memset(&state, 0, sizeof(state));
+    state.sample_rate = self->sample_rate;
+    state.album_peak = self->album_peak;
+    memcpy(state.histogram, self->B, sizeof(state.histogram));
+
+    return PyBytes_FromStringAndSize((const char*)&state, sizeof(state));
+}
+
+PyObject*
+ReplayGain_add_album_state(replaygain_ReplayGain *self, PyObject *args)
+{
+    const char *bytes;
+#ifdef PY_SSIZE_T_CLEAN
+    Py_ssize_t bytes_len;
+#else
+    int bytes_len;
+#endif
+    struct replaygain_album_state state;
+    unsigned i;
+
+    if (!PyArg_ParseTuple(args, "s#", &bytes, &bytes_len))
+        return NULL;
+
+    if (bytes_len != sizeof(state)) {
+        PyErr_SetString(PyExc_ValueError, "invalid album state");
+        return NULL;
+    }
+    memcpy(&state, bytes, sizeof(state));
+    if (state.sample_rate != self->sample_rate) {
+        PyErr_SetString(PyExc_ValueError, "album state sample rate mismatch");
+        return NULL;
+    }
+
+    /*album gain depends only on the combined histogram
+      so merging in another object's titles is the same
+      as having analyzed them here*/
+    for (i = 0; i < STEPS_per_dB_times_MAX_dB; i++) {
+        self->B[i] += state.histogram[i];
+    }
+    self->album_peak = MAX(self->album_peak, state.album_peak);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 PyGetSetDef ReplayGainReader_getseters[] = {
     {"sample_rate",
      (getter)ReplayGainReader_sample_rate, NULL, "sample rate", NULL},
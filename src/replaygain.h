@@ -108,6 +108,15 @@ ReplayGain_album_gain(replaygain_ReplayGain *self);
 PyObject*
 ReplayGain_album_peak(replaygain_ReplayGain *self);
 
+/*returns the histogram and peak of every completed title
+  as a string which another ReplayGain object
+  at the same sample rate may add to its own album*/
+PyObject*
+ReplayGain_album_state(replaygain_ReplayGain *self);
+
+PyObject*
+ReplayGain_add_album_state(replaygain_ReplayGain *self, PyObject *args);
+
 gain_calc_status
 ReplayGain_analyze_samples(replaygain_ReplayGain* self,
                            const double* left_samples,
@@ -136,6 +136,8 @@ const char* sinc_get_description (int src_enum) ;
 
 int sinc_set_converter (SRC_PRIVATE *psrc, int src_enum) ;
 
+void sinc_init_dispatch (void) ;
+
 /* In src_linear.c */
 const char* linear_get_name (int src_enum) ;
 const char* linear_get_description (int src_enum) ;
@@ -360,6 +360,11 @@ src_get_version (void)
 {	return PACKAGE "-" VERSION " (c) 2002-2008 Erik de Castro Lopo" ;
 } /* src_get_version */
 
+void
+src_init_dispatch (void)
+{	sinc_init_dispatch () ;
+} /* src_init_dispatch */
+
 int
 src_is_valid_ratio (double ratio)
 {
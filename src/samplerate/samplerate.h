@@ -128,6 +128,13 @@ const char *src_get_name (int converter_type) ;
 const char *src_get_description (int converter_type) ;
 const char *src_get_version (void) ;
 
+/*
+**	Picks the fastest converter kernels the CPU supports.
+**	Call once before creating any converters.
+*/
+
+void src_init_dispatch (void) ;
+
 /*
 **	Set a new SRC ratio. This allows step responses
 **	in the conversion ratio.
@@ -29,6 +29,16 @@
 
 #include "float_cast.h"
 #include "common.h"
+#include "../common/cpu.h"
+
+/* The vector kernels accumulate each channel in its own lane
+** with the same operations in the same order as the scalar ones,
+** so their output is identical as long as scalar doubles use SSE2 too.
+*/
+#if defined (CPU_X86) && defined (__SSE2_MATH__)
+#define SINC_X86_KERNELS
+#include <immintrin.h>
+#endif
 
 #define	SINC_MAGIC_MARKER	MAKE_MAGIC (' ', 's', 'i', 'n', 'c', ' ')
 
@@ -81,6 +91,23 @@ static int sinc_mono_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data) ;
 
 static int prepare_data (SINC_FILTER *filter, SRC_DATA *data, int half_filter_chan_len) WARN_UNUSED ;
 
+typedef void (*calc_output_func) (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output) ;
+
+static void calc_output_stereo (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output) ;
+static void calc_output_quad (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output) ;
+static void calc_output_hex (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output) ;
+
+#ifdef SINC_X86_KERNELS
+static void calc_output_stereo_sse2 (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output) ;
+static void calc_output_quad_avx (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output) ;
+static void calc_output_hex_avx (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output) ;
+#endif
+
+/* Set by sinc_init_dispatch (). */
+static calc_output_func calc_output_stereo_kernel = calc_output_stereo ;
+static calc_output_func calc_output_quad_kernel = calc_output_quad ;
+static calc_output_func calc_output_hex_kernel = calc_output_hex ;
+
 static void sinc_reset (SRC_PRIVATE *psrc) ;
 
 static inline increment_t
@@ -419,7 +446,7 @@ sinc_mono_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 	return SRC_ERR_NO_ERROR ;
 } /* sinc_mono_vari_process */
 
-static inline void
+static void
 calc_output_stereo (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output)
 {	double		fraction, left [2], right [2], icoeff ;
 	increment_t	filter_index, max_filter_index ;
@@ -545,7 +572,7 @@ sinc_stereo_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 
 		start_filter_index = double_to_fp (input_index * float_increment) ;
 
-		calc_output_stereo (filter, increment, start_filter_index, float_increment / filter->index_inc, data->data_out + filter->out_gen) ;
+		calc_output_stereo_kernel (filter, increment, start_filter_index, float_increment / filter->index_inc, data->data_out + filter->out_gen) ;
 		filter->out_gen += 2 ;
 
 		/* Figure out the next index. */
@@ -567,7 +594,7 @@ sinc_stereo_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 	return SRC_ERR_NO_ERROR ;
 } /* sinc_stereo_vari_process */
 
-static inline void
+static void
 calc_output_quad (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output)
 {	double		fraction, left [4], right [4], icoeff ;
 	increment_t	filter_index, max_filter_index ;
@@ -699,7 +726,7 @@ sinc_quad_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 
 		start_filter_index = double_to_fp (input_index * float_increment) ;
 
-		calc_output_quad (filter, increment, start_filter_index, float_increment / filter->index_inc, data->data_out + filter->out_gen) ;
+		calc_output_quad_kernel (filter, increment, start_filter_index, float_increment / filter->index_inc, data->data_out + filter->out_gen) ;
 		filter->out_gen += 4 ;
 
 		/* Figure out the next index. */
@@ -721,7 +748,7 @@ sinc_quad_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 	return SRC_ERR_NO_ERROR ;
 } /* sinc_quad_vari_process */
 
-static inline void
+static void
 calc_output_hex (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output)
 {	double		fraction, left [6], right [6], icoeff ;
 	increment_t	filter_index, max_filter_index ;
@@ -859,7 +886,7 @@ sinc_hex_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 
 		start_filter_index = double_to_fp (input_index * float_increment) ;
 
-		calc_output_hex (filter, increment, start_filter_index, float_increment / filter->index_inc, data->data_out + filter->out_gen) ;
+		calc_output_hex_kernel (filter, increment, start_filter_index, float_increment / filter->index_inc, data->data_out + filter->out_gen) ;
 		filter->out_gen += 6 ;
 
 		/* Figure out the next index. */
@@ -1128,6 +1155,189 @@ sinc_multichan_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 	return SRC_ERR_NO_ERROR ;
 } /* sinc_multichan_vari_process */
 
+void
+sinc_init_dispatch (void)
+{
+#ifdef SINC_X86_KERNELS
+	unsigned features = cpu_features () ;
+
+	if (features & CPU_SSE2)
+		calc_output_stereo_kernel = calc_output_stereo_sse2 ;
+	if (features & CPU_AVX)
+	{	calc_output_quad_kernel = calc_output_quad_avx ;
+		calc_output_hex_kernel = calc_output_hex_avx ;
+		} ;
+#endif
+} /* sinc_init_dispatch */
+
+#ifdef SINC_X86_KERNELS
+
+/* Returns the interpolated filter coefficient at filter_index. */
+static inline double
+interpolate_coeff (const SINC_FILTER *filter, increment_t filter_index)
+{	double fraction = fp_to_double (filter_index) ;
+	int indx = fp_to_int (filter_index) ;
+
+	return filter->coeffs [indx] + fraction * (filter->coeffs [indx + 1] - filter->coeffs [indx]) ;
+} /* interpolate_coeff */
+
+CPU_TARGET ("sse2") static void
+calc_output_stereo_sse2 (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output)
+{	__m128d		left, right, icoeff ;
+	increment_t	filter_index, max_filter_index ;
+	int			data_index, coeff_count ;
+
+	/* Convert input parameters into fixed point. */
+	max_filter_index = int_to_fp (filter->coeff_half_len) ;
+
+	/* First apply the left half of the filter. */
+	filter_index = start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current - filter->channels * coeff_count ;
+
+	left = _mm_setzero_pd () ;
+	do
+	{	icoeff = _mm_set1_pd (interpolate_coeff (filter, filter_index)) ;
+
+		left = _mm_add_pd (left, _mm_mul_pd (icoeff,
+					_mm_cvtps_pd (_mm_castsi128_ps (_mm_loadl_epi64 ((const __m128i *) (filter->buffer + data_index)))))) ;
+
+		filter_index -= increment ;
+		data_index = data_index + 2 ;
+		}
+	while (filter_index >= MAKE_INCREMENT_T (0)) ;
+
+	/* Now apply the right half of the filter. */
+	filter_index = increment - start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current + filter->channels * (1 + coeff_count) ;
+
+	right = _mm_setzero_pd () ;
+	do
+	{	icoeff = _mm_set1_pd (interpolate_coeff (filter, filter_index)) ;
+
+		right = _mm_add_pd (right, _mm_mul_pd (icoeff,
+					_mm_cvtps_pd (_mm_castsi128_ps (_mm_loadl_epi64 ((const __m128i *) (filter->buffer + data_index)))))) ;
+
+		filter_index -= increment ;
+		data_index = data_index - 2 ;
+		}
+	while (filter_index > MAKE_INCREMENT_T (0)) ;
+
+	_mm_storel_epi64 ((__m128i *) output,
+		_mm_castps_si128 (_mm_cvtpd_ps (_mm_mul_pd (_mm_set1_pd (scale), _mm_add_pd (left, right))))) ;
+} /* calc_output_stereo_sse2 */
+
+CPU_TARGET ("avx") static void
+calc_output_quad_avx (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output)
+{	__m256d		left, right, icoeff ;
+	increment_t	filter_index, max_filter_index ;
+	int			data_index, coeff_count ;
+
+	/* Convert input parameters into fixed point. */
+	max_filter_index = int_to_fp (filter->coeff_half_len) ;
+
+	/* First apply the left half of the filter. */
+	filter_index = start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current - filter->channels * coeff_count ;
+
+	left = _mm256_setzero_pd () ;
+	do
+	{	icoeff = _mm256_set1_pd (interpolate_coeff (filter, filter_index)) ;
+
+		left = _mm256_add_pd (left, _mm256_mul_pd (icoeff, _mm256_cvtps_pd (_mm_loadu_ps (filter->buffer + data_index)))) ;
+
+		filter_index -= increment ;
+		data_index = data_index + 4 ;
+		}
+	while (filter_index >= MAKE_INCREMENT_T (0)) ;
+
+	/* Now apply the right half of the filter. */
+	filter_index = increment - start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current + filter->channels * (1 + coeff_count) ;
+
+	right = _mm256_setzero_pd () ;
+	do
+	{	icoeff = _mm256_set1_pd (interpolate_coeff (filter, filter_index)) ;
+
+		right = _mm256_add_pd (right, _mm256_mul_pd (icoeff, _mm256_cvtps_pd (_mm_loadu_ps (filter->buffer + data_index)))) ;
+
+		filter_index -= increment ;
+		data_index = data_index - 4 ;
+		}
+	while (filter_index > MAKE_INCREMENT_T (0)) ;
+
+	_mm_storeu_ps (output, _mm256_cvtpd_ps (_mm256_mul_pd (_mm256_set1_pd (scale), _mm256_add_pd (left, right)))) ;
+} /* calc_output_quad_avx */
+
+CPU_TARGET ("avx") static void
+calc_output_hex_avx (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output)
+{	__m256d		left03, right03, icoeff4 ;
+	__m128d		left45, right45, icoeff2 ;
+	increment_t	filter_index, max_filter_index ;
+	int			data_index, coeff_count ;
+	double		icoeff ;
+
+	/* Convert input parameters into fixed point. */
+	max_filter_index = int_to_fp (filter->coeff_half_len) ;
+
+	/* First apply the left half of the filter. */
+	filter_index = start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current - filter->channels * coeff_count ;
+
+	left03 = _mm256_setzero_pd () ;
+	left45 = _mm_setzero_pd () ;
+	do
+	{	icoeff = interpolate_coeff (filter, filter_index) ;
+		icoeff4 = _mm256_set1_pd (icoeff) ;
+		icoeff2 = _mm_set1_pd (icoeff) ;
+
+		left03 = _mm256_add_pd (left03, _mm256_mul_pd (icoeff4, _mm256_cvtps_pd (_mm_loadu_ps (filter->buffer + data_index)))) ;
+		left45 = _mm_add_pd (left45, _mm_mul_pd (icoeff2,
+					_mm_cvtps_pd (_mm_castsi128_ps (_mm_loadl_epi64 ((const __m128i *) (filter->buffer + data_index + 4)))))) ;
+
+		filter_index -= increment ;
+		data_index = data_index + 6 ;
+		}
+	while (filter_index >= MAKE_INCREMENT_T (0)) ;
+
+	/* Now apply the right half of the filter. */
+	filter_index = increment - start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current + filter->channels * (1 + coeff_count) ;
+
+	right03 = _mm256_setzero_pd () ;
+	right45 = _mm_setzero_pd () ;
+	do
+	{	icoeff = interpolate_coeff (filter, filter_index) ;
+		icoeff4 = _mm256_set1_pd (icoeff) ;
+		icoeff2 = _mm_set1_pd (icoeff) ;
+
+		right03 = _mm256_add_pd (right03, _mm256_mul_pd (icoeff4, _mm256_cvtps_pd (_mm_loadu_ps (filter->buffer + data_index)))) ;
+		right45 = _mm_add_pd (right45, _mm_mul_pd (icoeff2,
+					_mm_cvtps_pd (_mm_castsi128_ps (_mm_loadl_epi64 ((const __m128i *) (filter->buffer + data_index + 4)))))) ;
+
+		filter_index -= increment ;
+		data_index = data_index - 6 ;
+		}
+	while (filter_index > MAKE_INCREMENT_T (0)) ;
+
+	_mm_storeu_ps (output, _mm256_cvtpd_ps (_mm256_mul_pd (_mm256_set1_pd (scale), _mm256_add_pd (left03, right03)))) ;
+	_mm_storel_epi64 ((__m128i *) (output + 4),
+		_mm_castps_si128 (_mm_cvtpd_ps (_mm_mul_pd (_mm_set1_pd (scale), _mm_add_pd (left45, right45))))) ;
+} /* calc_output_hex_avx */
+
+#endif
+
 /*----------------------------------------------------------------------------------------
 */
 
@@ -212,6 +212,46 @@ class PCMCat(unittest.TestCase):
         for r in main_readers:
             self.assertRaises(ValueError, r.read, 2)
 
+        # ensure uninitialized readers raise ValueError
+        for reader_class in [audiotools.PCMCat,
+                             audiotools.PCMReaderHead,
+                             audiotools.PCMReaderDeHead,
+                             audiotools.LimitedPCMReader]:
+            reader = reader_class.__new__(reader_class)
+            for attr in ["sample_rate",
+                         "channels",
+                         "channel_mask",
+                         "bits_per_sample"]:
+                self.assertRaises(ValueError, getattr, reader, attr)
+            self.assertRaises(ValueError, reader.read, 2)
+            reader.close()
+
+        # ensure calling __init__ again releases the earlier readers
+        # and leaves readers borrowing from this one unable to read
+        # a stream that no longer fits
+        import sys
+        main_reader = EXACT_BLANK_PCM_Reader(10)
+        references = sys.getrefcount(main_reader)
+        reader = audiotools.PCMCat([main_reader])
+        self.assertGreater(sys.getrefcount(main_reader), references)
+        head = audiotools.PCMReaderHead(reader, 5)
+        reader.__init__([EXACT_BLANK_PCM_Reader(10, channels=1)])
+        self.assertEqual(sys.getrefcount(main_reader), references)
+        self.assertEqual(reader.channels, 1)
+        self.assertRaises(ValueError, head.read, 2)
+
+        # errors use the messages in audiotools.text
+        from audiotools.text import (ERR_NO_PCMREADERS,
+                                     ERR_SAMPLE_RATE_MISMATCH)
+        with self.assertRaises(ValueError) as raised:
+            audiotools.PCMCat([])
+        self.assertEqual(raised.exception.args[0], ERR_NO_PCMREADERS)
+        with self.assertRaises(ValueError) as raised:
+            audiotools.PCMCat([EXACT_BLANK_PCM_Reader(10),
+                               EXACT_BLANK_PCM_Reader(10,
+                                                      sample_rate=48000)])
+        self.assertEqual(raised.exception.args[0], ERR_SAMPLE_RATE_MISMATCH)
+
 
 class BufferedPCMReader(unittest.TestCase):
     @LIB_PCM
@@ -352,6 +392,115 @@ class LimitedPCMReader(unittest.TestCase):
         self.assertRaises(ValueError, main_reader.read, 2)
 
 
+class PCMBroadcast(unittest.TestCase):
+    @LIB_PCM
+    def test_pcm(self):
+        import threading
+        from test_formats import CLOSE_PCM_Reader, ERROR_PCM_Reader
+
+        def read_all(branch, checksum):
+            audiotools.transfer_framelist_data(branch, checksum.update)
+
+        for buffered_framelists in [1, 2, 16]:
+            main_reader = CLOSE_PCM_Reader(
+                test_streams.Sine16_Stereo(200000, 44100,
+                                           441.0, 0.50,
+                                           4410.0, 0.49, 1.0))
+            broadcast = audiotools.PCMBroadcast(main_reader,
+                                                buffered_framelists)
+            branches = [broadcast.branch() for i in range(3)]
+            for branch in branches:
+                self.assertEqual(branch.sample_rate, 44100)
+                self.assertEqual(branch.channels, 2)
+                self.assertEqual(branch.channel_mask, 0x3)
+                self.assertEqual(branch.bits_per_sample, 16)
+            checksums = [md5() for branch in branches]
+            threads = [threading.Thread(target=read_all,
+                                        args=(branch, checksum))
+                       for (branch, checksum) in zip(branches, checksums)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+
+            # every branch gets the whole stream
+            checksum = md5()
+            audiotools.transfer_framelist_data(
+                test_streams.Sine16_Stereo(200000, 44100,
+                                           441.0, 0.50,
+                                           4410.0, 0.49, 1.0),
+                checksum.update)
+            for branch_checksum in checksums:
+                self.assertEqual(branch_checksum.hexdigest(),
+                                 checksum.hexdigest())
+
+            # and the source is closed only once, by the last branch
+            self.assertEqual(main_reader.closes_called, 1)
+            for branch in branches:
+                self.assertRaises(ValueError, branch.read, 4096)
+
+        # a closed branch no longer holds back the others
+        main_reader = CLOSE_PCM_Reader(BLANK_PCM_Reader(2))
+        broadcast = audiotools.PCMBroadcast(main_reader, 1)
+        (branch1, branch2) = [broadcast.branch() for i in range(2)]
+        branch2.close()
+        self.assertEqual(main_reader.closes_called, 0)
+        self.assertEqual(
+            audiotools.pcm_frame_cmp(branch1, BLANK_PCM_Reader(2)), None)
+        self.assertEqual(main_reader.closes_called, 1)
+
+        # read errors of any kind are raised by every branch
+        # without the source being read again
+        for error in [IOError, ValueError, RuntimeError, KeyError]:
+            source = ERROR_PCM_Reader(error("error"), failure_chance=1.0)
+            broadcast = audiotools.PCMBroadcast(source)
+            branches = [broadcast.branch() for i in range(2)]
+            self.assertRaises(error, branches[0].read, 4096)
+            source.failure_chance = 0.0
+            self.assertRaises(error, branches[1].read, 4096)
+
+        # a branch reading from the source doesn't block
+        # other branches from reading FrameLists already buffered
+        class Blocking_Reader(audiotools.PCMReader):
+            def __init__(self):
+                audiotools.PCMReader.__init__(
+                    self, sample_rate=44100, channels=2,
+                    channel_mask=0x3, bits_per_sample=16)
+                self.reads = 0
+                self.reading = threading.Event()
+                self.resume = threading.Event()
+
+            def read(self, pcm_frames):
+                self.reads += 1
+                if self.reads > 1:
+                    self.reading.set()
+                    self.resume.wait()
+                return audiotools.pcm.from_list([0] * 20, 2, 16, True)
+
+            def close(self):
+                pass
+
+        source = Blocking_Reader()
+        broadcast = audiotools.PCMBroadcast(source, 2)
+        (branch1, branch2) = [broadcast.branch() for i in range(2)]
+        self.assertEqual(branch1.read(4096).frames, 10)
+        reader = threading.Thread(target=branch1.read, args=(4096,))
+        reader.start()
+        self.assertTrue(source.reading.wait(5))
+        result = []
+        buffered = threading.Thread(
+            target=lambda: result.append(branch2.read(4096)))
+        buffered.start()
+        buffered.join(5)
+        finished = not buffered.is_alive()
+        source.resume.set()
+        reader.join()
+        buffered.join()
+        self.assertTrue(finished)
+        self.assertEqual(result[0].frames, 10)
+        self.assertEqual(source.reads, 2)
+
+
 class PCMReaderWindow(unittest.TestCase):
     @LIB_PCM
     def test_pcm(self):
@@ -426,6 +575,46 @@ class PCMReaderWindow(unittest.TestCase):
                 # closes the main PCMReader also
                 self.assertRaises(ValueError, main_reader.read, 2)
 
+    @LIB_PCM
+    def test_nested(self):
+        from test_streams import FrameListReader
+        from test_formats import ERROR_PCM_Reader
+
+        # windows of windows of concatenated streams
+        # read one another directly but behave the same as a single window
+        samples = list(range(-500, 500))
+        reader = audiotools.PCMReaderWindow(
+            audiotools.PCMReaderWindow(
+                audiotools.PCMCat([FrameListReader(samples[0:300], 44100,
+                                                   1, 16),
+                                   audiotools.PCMReaderHead(
+                                       FrameListReader(samples[300:], 44100,
+                                                       1, 16),
+                                       700)]),
+                -10,
+                900),
+            110,
+            900)
+        read_samples = []
+        f = reader.read(7)
+        while len(f) > 0:
+            read_samples.extend(list(f))
+            f = reader.read(7)
+        self.assertEqual(read_samples, samples[100:890] + [0] * 110)
+        reader.close()
+        self.assertRaises(ValueError, reader.read, 7)
+
+        # errors from wrapped readers keep their type
+        reader = audiotools.PCMReaderHead(
+            audiotools.PCMCat([ERROR_PCM_Reader(IOError("error"),
+                                                failure_chance=1.0)]),
+            100)
+        self.assertRaises(IOError, reader.read, 10)
+        reader = audiotools.PCMReaderDeHead(
+            ERROR_PCM_Reader(ValueError("error"), failure_chance=1.0),
+            10)
+        self.assertRaises(ValueError, reader.read, 10)
+
 
 class Sines(unittest.TestCase):
     @LIB_PCM
@@ -1293,6 +1482,251 @@ class Test_pcm_frame_cmp(unittest.TestCase):
         self.assertEqual(reader1.closes_called, 1)
         self.assertEqual(reader2.closes_called, 1)
 
+    @LIB_CORE
+    def test_compare_readers(self):
+        from audiotools.pcm import compare_readers
+        from test_streams import FrameListReader
+
+        samples = [i % 200 - 100 for i in range(20000)]
+        changed = samples[:]
+        changed[9001] += 5
+        changed[15000] -= 300
+
+        # identical streams
+        self.assertIsNone(
+            compare_readers(FrameListReader(samples, 44100, 2, 16),
+                            FrameListReader(samples, 44100, 2, 16)))
+        self.assertEqual(
+            compare_readers(FrameListReader(samples, 44100, 2, 16),
+                            FrameListReader(samples, 44100, 2, 16),
+                            statistics=True),
+            (None, 0, 0))
+
+        # mismatched samples
+        self.assertEqual(
+            compare_readers(FrameListReader(samples, 44100, 2, 16),
+                            FrameListReader(changed, 44100, 2, 16)),
+            4500)
+        self.assertEqual(
+            compare_readers(FrameListReader(samples, 44100, 2, 16),
+                            FrameListReader(changed, 44100, 2, 16),
+                            statistics=True),
+            (4500, 2, 300))
+
+        # one stream shorter than the other
+        self.assertEqual(
+            compare_readers(FrameListReader(samples, 44100, 2, 16),
+                            FrameListReader(samples[:-200], 44100, 2, 16)),
+            9900)
+        self.assertEqual(
+            compare_readers(FrameListReader(changed[:-200], 44100, 2, 16),
+                            FrameListReader(samples, 44100, 2, 16),
+                            statistics=True),
+            (4500, 102, 300))
+
+        # streams that can't be compared sample-by-sample
+        self.assertRaises(ValueError,
+                          compare_readers,
+                          FrameListReader(samples, 44100, 2, 16),
+                          FrameListReader(samples, 44100, 1, 16))
+        self.assertRaises(ValueError,
+                          compare_readers,
+                          FrameListReader(samples, 44100, 2, 16),
+                          FrameListReader(samples, 44100, 2, 24))
+
+        # read errors are propagated
+        from test_formats import ERROR_PCM_Reader
+        self.assertRaises(ValueError,
+                          compare_readers,
+                          ERROR_PCM_Reader(ValueError("error"),
+                                           failure_chance=1.0),
+                          BLANK_PCM_Reader(1))
+
+
+class Test_md5sums(unittest.TestCase):
+    def random_stream(self, channels, bits_per_sample):
+        peak = 1 << (bits_per_sample - 1)
+        return [random.randint(-peak, peak - 1) for i in
+                range(random.choice([0, 1, 63, 1001, 9999]) * channels)]
+
+    def expected_md5(self, samples, channels, bits_per_sample,
+                     is_signed, is_big_endian):
+        return md5(audiotools.pcm.from_list(
+            samples, channels, bits_per_sample, True).to_bytes(
+                is_big_endian, is_signed)).digest()
+
+    @LIB_CORE
+    def test_md5sums(self):
+        from audiotools.pcm import md5sums
+        from test_streams import FrameListReader
+
+        # Variable_Reader returns odd-sized FrameLists
+        # so samples straddle MD5 block boundaries
+        # and streams run out at different times
+        for bits_per_sample in [8, 16, 24]:
+            for is_signed in [False, True]:
+                for is_big_endian in [False, True]:
+                    for count in [1, 2, 5, 9]:
+                        channels = [random.randint(1, 3)
+                                    for i in range(count)]
+                        streams = [self.random_stream(c, bits_per_sample)
+                                   for c in channels]
+                        self.assertEqual(
+                            md5sums([Variable_Reader(
+                                FrameListReader(samples, 44100, c,
+                                                bits_per_sample, 0))
+                                     for (samples, c) in zip(streams,
+                                                             channels)],
+                                    signed=is_signed,
+                                    big_endian=is_big_endian),
+                            [self.expected_md5(samples, c, bits_per_sample,
+                                               is_signed, is_big_endian)
+                             for (samples, c) in zip(streams, channels)])
+
+        self.assertEqual(md5sums([]), [])
+
+        # read errors are propagated
+        from test_formats import ERROR_PCM_Reader
+        self.assertRaises(ValueError,
+                          md5sums,
+                          [BLANK_PCM_Reader(1),
+                           ERROR_PCM_Reader(ValueError("error"),
+                                            failure_chance=1.0)])
+
+
+class Test_stats(unittest.TestCase):
+    def tearDown(self):
+        audiotools.enable_stats(False)
+        audiotools.reset_stats()
+
+    @LIB_CORE
+    def test_stats(self):
+        import re
+        from test_formats import BLANK_PCM_Reader
+
+        enabled = audiotools.enable_stats()
+        audiotools.reset_stats()
+        self.assertEqual(audiotools.stats(), {})
+
+        with tempfile.NamedTemporaryFile(suffix=".flac") as temp_file:
+            track = audiotools.FlacAudio.from_pcm(temp_file.name,
+                                                  BLANK_PCM_Reader(1))
+            audiotools.transfer_data(track.to_pcm().read, lambda f: None)
+
+        stats = audiotools.stats()
+        if enabled:
+            # one second of 44100Hz stereo through each stage
+            for stage in [u"flac.encode.frame", u"flac.decode.frame"]:
+                self.assertIn(stage, stats)
+                self.assertGreater(stats[stage]["calls"], 0)
+                self.assertEqual(stats[stage]["samples"], 44100 * 2)
+                self.assertGreaterEqual(stats[stage]["seconds"], 0.0)
+        else:
+            # module built without stats
+            self.assertEqual(stats, {})
+
+        prometheus = re.compile(r'^audiotools_stage_[a-z]+_total' +
+                                r'{component="[a-z]+",stage="[a-z0-9._]+"} ' +
+                                r'[0-9.e+-]+$')
+        lines = audiotools.stats_prometheus().splitlines()
+        for line in lines:
+            if not line.startswith(u"#"):
+                self.assertIsNotNone(prometheus.match(line), line)
+        self.assertEqual(len([l for l in lines if not l.startswith(u"#")]),
+                         len(stats) * 3)
+
+        audiotools.reset_stats()
+        self.assertEqual(audiotools.stats(), {})
+
+
+class Test_cpu_features(unittest.TestCase):
+    # encodes, resamples and converts some signals with whichever kernels
+    # the CPU supports and prints a digest of the results
+    KERNEL_SCRIPT = u"""
+import math
+import random
+import tempfile
+from hashlib import md5
+import audiotools
+import audiotools.pcm
+from audiotools.pcmconverter import Resampler
+from test_streams import FrameListReader
+
+rng = random.Random(0)
+digest = md5()
+for (channels, bits_per_sample) in [(1, 16), (2, 16), (2, 24),
+                                    (4, 16), (6, 24)]:
+    peak = (1 << (bits_per_sample - 1)) - 1
+    noise = [rng.randint(-peak, peak) for i in range(4000 * channels)]
+    sine = [int(math.sin(i / 37.0 + c) * peak * 0.9)
+            for i in range(4000) for c in range(channels)]
+    for samples in [noise, sine]:
+        with tempfile.NamedTemporaryFile(suffix=".flac") as temp_file:
+            for quality in ["0", "8"]:
+                track = audiotools.FlacAudio.from_pcm(
+                    temp_file.name,
+                    FrameListReader(samples, 44100,
+                                    channels, bits_per_sample, 0),
+                    quality)
+                with open(temp_file.name, "rb") as f:
+                    digest.update(f.read())
+                track.verify()
+        resampler = Resampler(
+            FrameListReader(samples, 44100, channels, bits_per_sample, 0),
+            48000)
+        frame = resampler.read(4096)
+        while len(frame) > 0:
+            digest.update(repr(list(frame)).encode("ascii"))
+            frame = resampler.read(4096)
+for bits_per_sample in [16, 24]:
+    peak = 1 << (bits_per_sample - 1)
+    for length in [0, 1, 7, 8, 9, 15, 16, 17, 33, 1001]:
+        data = bytes(bytearray([rng.randint(0, 255) for i in
+                                range(length * bits_per_sample // 8)]))
+        samples = audiotools.pcm.from_list(
+            [rng.randint(-peak * 2, peak * 2) for i in range(length)],
+            1, bits_per_sample, True)
+        for is_big_endian in [False, True]:
+            for is_signed in [False, True]:
+                frame = audiotools.pcm.FrameList(data, 1, bits_per_sample,
+                                                 is_big_endian, is_signed)
+                digest.update(repr(list(frame)).encode("ascii"))
+                digest.update(frame.to_bytes(is_big_endian, is_signed))
+                digest.update(samples.to_bytes(is_big_endian, is_signed))
+print(digest.hexdigest())
+"""
+
+    def run_kernels(self, scalar):
+        import subprocess
+
+        env = os.environ.copy()
+        env["PYTHONPATH"] = os.pathsep.join(sys.path)
+        if scalar:
+            env["AUDIOTOOLS_SCALAR"] = "1"
+        else:
+            env.pop("AUDIOTOOLS_SCALAR", None)
+        sub = subprocess.Popen([sys.executable, "-c", self.KERNEL_SCRIPT],
+                               stdout=subprocess.PIPE,
+                               env=env)
+        output = sub.stdout.read()
+        sub.stdout.close()
+        self.assertEqual(sub.wait(), 0)
+        return output
+
+    @LIB_CORE
+    def test_cpu_features(self):
+        import audiotools.pcm
+
+        for feature in audiotools.pcm.cpu_features():
+            self.assertIn(feature, [u"sse2", u"ssse3", u"sse4.1",
+                                    u"avx", u"avx2", u"neon"])
+
+    @LIB_CORE
+    def test_scalar_kernels(self):
+        # the SIMD kernels must be bit-exact with the scalar ones
+        self.assertEqual(self.run_kernels(scalar=False),
+                         self.run_kernels(scalar=True))
+
 
 class TestFrameList(unittest.TestCase):
     if sys.version_info[0] >= 3:
@@ -4547,6 +4981,51 @@ class TestReplayGain(unittest.TestCase):
             dummy1.close()
             dummy2.close()
 
+    @LIB_REPLAYGAIN
+    def test_album_state(self):
+        import audiotools.replaygain
+
+        streams = [(44100 * 3, 441.0, 0.50, 4410.0, 0.49),
+                   (44100 * 2, 220.5, 0.25, 2205.0, 0.30),
+                   (44100 * 4, 882.0, 0.10, 8820.0, 0.15)]
+
+        # analyze all the tracks as a single album
+        album = audiotools.replaygain.ReplayGain(44100)
+        title_gains = []
+        for (frames, f1, a1, f2, a2) in streams:
+            audiotools.transfer_data(
+                test_streams.Sine16_Stereo(frames, 44100,
+                                           f1, a1, f2, a2, 1.0).read,
+                album.update)
+            title_gains.append((album.title_gain(), album.title_peak()))
+            album.next_title()
+
+        # then each track on its own, combining their album states
+        calculator = audiotools.ReplayGainCalculator(44100)
+        for ((frames, f1, a1, f2, a2),
+             (title_gain, title_peak)) in zip(streams, title_gains):
+            track_calculator = audiotools.ReplayGainCalculator(44100)
+            with track_calculator.to_pcm(
+                    test_streams.Sine16_Stereo(frames, 44100,
+                                               f1, a1, f2, a2,
+                                               1.0)) as pcmreader:
+                audiotools.transfer_data(pcmreader.read, lambda f: None)
+            self.assertEqual(pcmreader.title_gain(), title_gain)
+            self.assertEqual(pcmreader.title_peak(), title_peak)
+            calculator.add_album_state(track_calculator.album_state())
+
+        self.assertEqual(calculator.album_gain(), album.album_gain())
+        self.assertEqual(calculator.album_peak(), album.album_peak())
+
+        # states only combine at the same sample rate
+        self.assertRaises(
+            ValueError,
+            audiotools.ReplayGainCalculator(48000).add_album_state,
+            calculator.album_state())
+        self.assertRaises(ValueError,
+                          calculator.add_album_state,
+                          b"invalid")
+
 
 class testsheet(unittest.TestCase):
     @LIB_CORE
@@ -7067,6 +7546,34 @@ class Test_ExecProgressQueue(unittest.TestCase):
             for i in range(max_processes):
                 self.assertEqual(results[i], sum(range(i, i + 10)))
 
+    @LIB_CORE
+    def test_workers(self):
+        def square(i, progress):
+            return i * i
+
+        def fail(i, progress):
+            if i == 50:
+                raise ValueError(i)
+            return i
+
+        # many more jobs than workers
+        # still return their results in the order they were queued
+        for max_processes in [2, 3, 8]:
+            queue = audiotools.ExecProgressQueue(audiotools.SilentMessenger())
+            for i in range(200):
+                queue.execute(function=square,
+                              progress_text=u"Square {:d}".format(i),
+                              completion_output=u"{:d}".format,
+                              i=i)
+            self.assertEqual(queue.run(max_processes),
+                             [i * i for i in range(200)])
+
+        # an exception from any job is raised by run()
+        queue = audiotools.ExecProgressQueue(audiotools.SilentMessenger())
+        for i in range(100):
+            queue.execute(function=fail, i=i)
+        self.assertRaises(ValueError, queue.run, 4)
+
 
 class Test_Output_Text(unittest.TestCase):
     @LIB_CORE
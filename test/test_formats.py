@@ -1395,6 +1395,63 @@ class LosslessFileTest(AudioFileTest):
                                           audio_class,
                                           compression)
 
+    @FORMAT_LOSSLESS
+    def test_convert_many(self):
+        if self.audio_class is audiotools.AudioFile:
+            return
+
+        with tempfile.NamedTemporaryFile(
+            suffix="." + self.audio_class.SUFFIX) as temp_input:
+            track = self.audio_class.from_pcm(
+                temp_input.name,
+                test_streams.Sine16_Stereo(441000, 44100,
+                                           8820.0, 0.70, 4410.0, 0.29, 1.0))
+            audio_classes = [audiotools.WaveAudio,
+                             audiotools.AiffAudio,
+                             audiotools.FlacAudio]
+            temp_outputs = [tempfile.NamedTemporaryFile(
+                                suffix="." + audio_class.SUFFIX)
+                            for audio_class in audio_classes]
+            try:
+                # no targets encodes nothing
+                self.assertEqual(track.convert_many([]), [])
+
+                tracks = track.convert_many(
+                    [(temp_output.name, audio_class, None)
+                     for (temp_output, audio_class) in
+                     zip(temp_outputs, audio_classes)])
+                self.assertEqual(len(tracks), len(audio_classes))
+                for (track2, audio_class) in zip(tracks, audio_classes):
+                    self.assertIsInstance(track2, audio_class)
+                    self.assertTrue(
+                        audiotools.pcm_cmp(track.to_pcm(),
+                                           track2.to_pcm()),
+                        "error round-tripping {} to {}".format(
+                            self.audio_class.NAME,
+                            audio_class.NAME))
+
+                # a failed target raises EncodingError
+                # but doesn't stop the others
+                for temp_output in temp_outputs:
+                    os.unlink(temp_output.name)
+                self.assertRaises(
+                    audiotools.EncodingError,
+                    track.convert_many,
+                    [(temp_outputs[0].name, audio_classes[0], None),
+                     ("/dev/null/foo." + audio_classes[0].SUFFIX,
+                      audio_classes[0],
+                      None)])
+                self.assertTrue(
+                    audiotools.pcm_cmp(
+                        track.to_pcm(),
+                        audiotools.open(temp_outputs[0].name).to_pcm()))
+            finally:
+                for temp_output in temp_outputs:
+                    try:
+                        temp_output.close()
+                    except OSError:
+                        pass
+
 
 class LossyFileTest(AudioFileTest):
     @FORMAT_LOSSY
@@ -2559,6 +2616,59 @@ class ALACFileTest(LosslessFileTest):
             self.assertEqual(u"{}".format(metadata[b'ilst'][b'\xa9too']),
                              encoder)
 
+    @FORMAT_ALAC
+    def test_unseekable_output(self):
+        def encode(pcm_frames, total_pcm_frames, unseekable):
+            pcmreader = test_streams.Sine16_Stereo(
+                pcm_frames, 44100, 441.0, 0.50, 441.0, 0.49, 1.0)
+            with tempfile.TemporaryFile() as f:
+                if unseekable:
+                    cat = subprocess.Popen(["cat"],
+                                           stdin=subprocess.PIPE,
+                                           stdout=f)
+                    output = cat.stdin
+                else:
+                    output = f
+                try:
+                    self.encode(output,
+                                pcmreader,
+                                total_pcm_frames=total_pcm_frames,
+                                block_size=4096,
+                                initial_history=10,
+                                history_multiplier=40,
+                                maximum_k=14,
+                                version="Python Audio Tools")
+                finally:
+                    if unseekable:
+                        cat.stdin.close()
+                        cat.wait()
+                f.seek(0, 0)
+                return (f.read(), pcmreader.digest())
+
+        for pcm_frames in [1, 4096, 44100 * 3 + 5]:
+            for total_pcm_frames in [0, pcm_frames]:
+                for unseekable in [False, True]:
+                    (data, digest) = encode(pcm_frames,
+                                            total_pcm_frames,
+                                            unseekable)
+                    with tempfile.NamedTemporaryFile(
+                            suffix=self.suffix) as temp:
+                        temp.write(data)
+                        temp.flush()
+                        alac = audiotools.open(temp.name)
+                        self.assertEqual(alac.total_frames(), pcm_frames)
+                        self.assertEqual(alac.verify(), True)
+                        md5sum = md5()
+                        audiotools.transfer_framelist_data(alac.to_pcm(),
+                                                           md5sum.update)
+                        self.assertEqual(md5sum.digest(), digest)
+
+            # ensure a length mismatch is caught
+            # on unseekable output also
+            self.assertRaises(IOError,
+                              encode,
+                              pcm_frames, pcm_frames + 1, True)
+
     def __test_reader__(self, pcmreader, total_pcm_frames, block_size=4096):
         if not audiotools.BIN.can_execute(audiotools.BIN["alac"]):
             self.assertTrue(
@@ -3783,6 +3893,104 @@ class FlacFileTest(TestForeignAiffChunks,
                                                          44100, 1, 16)),
                         **args)
 
+    @FORMAT_FLAC
+    def test_escaped_partitions(self):
+        from audiotools.bitstream import BitstreamReader
+
+        # full-scale samples with random signs can't be predicted
+        # and make Rice coding larger than the escaped residuals,
+        # so with VERBATIM subframes disabled
+        # the encoder must write escaped residual partitions
+        samples = [32767 if (b & 1) else -32767
+                   for b in bytearray(os.urandom(4096 * 8))]
+
+        def escaped_partitions(reader):
+            """returns the number of escaped residual partitions
+            in 8 FLAC frames of 4096 PCM frames, 1 channel and 16 bps
+            without VERBATIM or wasted bits subframes"""
+
+            escaped = 0
+            for frame in range(8):
+                (sync, block_size) = reader.parse("14u 2p 4u 12p")
+                self.assertEqual(sync, 0x3FFE)
+                self.assertEqual(block_size, 12)
+                reader.skip(8)  # frame numbers are less than 128
+                reader.skip(8)  # CRC-8
+
+                (subframe_type, wasted_bps) = reader.parse("1p 6u 1u")
+                self.assertEqual(wasted_bps, 0)
+                if subframe_type & 0x20:
+                    # LPC
+                    order = (subframe_type & 0x1F) + 1
+                    reader.skip(order * 16)
+                    precision = reader.read(4) + 1
+                    reader.skip(5 + (order * precision))
+                else:
+                    # FIXED
+                    self.assertEqual(subframe_type & 0x38, 0x08)
+                    order = subframe_type & 0x07
+                    reader.skip(order * 16)
+
+                (coding_method, partition_order) = reader.parse("2u 4u")
+                partitions = 2 ** partition_order
+                for p in range(partitions):
+                    partition_size = (4096 // partitions -
+                                      (order if (p == 0) else 0))
+                    parameter = reader.read(5 if coding_method else 4)
+                    if parameter == (31 if coding_method else 15):
+                        reader.skip(reader.read(5) * partition_size)
+                        escaped += 1
+                    else:
+                        for i in range(partition_size):
+                            reader.skip_unary(1)
+                            reader.skip(parameter)
+
+                reader.byte_align()
+                reader.skip(16)  # CRC-16
+
+            # the whole stream should be consumed
+            self.assertRaises(IOError, reader.read, 8)
+            return escaped
+
+        for max_lpc_order in [0, 8]:
+            with tempfile.NamedTemporaryFile(suffix=".flac") as temp:
+                source = test_streams.MD5Reader(
+                    test_streams.FrameListReader(samples, 44100, 1, 16))
+                self.encode(temp.name,
+                            source,
+                            version="Python Audio Tools",
+                            block_size=4096,
+                            max_lpc_order=max_lpc_order,
+                            min_residual_partition_order=0,
+                            max_residual_partition_order=4,
+                            disable_verbatim_subframes=True,
+                            disable_constant_subframes=True)
+
+                # skip to the first FLAC frame
+                reader = BitstreamReader(open(temp.name, "rb"), False)
+                self.assertEqual(reader.read_bytes(4), b"fLaC")
+                last = 0
+                while not last:
+                    (last, length) = reader.parse("1u 7p 24u")
+                    reader.skip_bytes(length)
+
+                self.assertGreater(escaped_partitions(reader), 0)
+                reader.close()
+
+                # ensure escaped partitions decode to their source
+                md5sum = md5()
+                with self.decoder(open(temp.name, "rb")) as decoder:
+                    frame = decoder.read(4096)
+                    while len(frame) > 0:
+                        md5sum.update(frame.to_bytes(False, True))
+                        frame = decoder.read(4096)
+                self.assertEqual(md5sum.digest(), source.digest())
+
+                if audiotools.BIN.can_execute(audiotools.BIN["flac"]):
+                    self.assertEqual(
+                        subprocess.call([audiotools.BIN["flac"], "-ts",
+                                         temp.name]), 0)
+
     @FORMAT_FLAC
     def test_frame_header_variations(self):
         max_lpc_order = 16
@@ -4135,6 +4343,358 @@ class FlacFileTest(TestForeignAiffChunks,
         # verifies without errors
         self.assertEqual(flac.verify(), True)
 
+    @FORMAT_FLAC
+    def test_unseekable_output(self):
+        temp_dir = tempfile.mkdtemp()
+        fifo_name = os.path.join(temp_dir, "output.flac")
+        os.mkfifo(fifo_name)
+
+        def encode(pcm_frames, total_pcm_frames, unseekable):
+            pcmreader = test_streams.Sine16_Stereo(
+                pcm_frames, 44100, 441.0, 0.50, 441.0, 0.49, 1.0)
+            with tempfile.TemporaryFile() as f:
+                if unseekable:
+                    cat = subprocess.Popen(["cat", fifo_name], stdout=f)
+                    try:
+                        self.encode(fifo_name,
+                                    pcmreader,
+                                    version="Python Audio Tools",
+                                    total_pcm_frames=total_pcm_frames)
+                    finally:
+                        cat.wait()
+                else:
+                    with tempfile.NamedTemporaryFile(
+                            suffix=self.suffix) as temp:
+                        self.encode(temp.name,
+                                    pcmreader,
+                                    version="Python Audio Tools",
+                                    total_pcm_frames=total_pcm_frames)
+                        f.write(open(temp.name, "rb").read())
+                f.seek(0, 0)
+                return (f.read(), pcmreader.digest())
+
+        try:
+            for pcm_frames in [1, 4096, 44100 * 3 + 5]:
+                # when the length is known, frames buffered in
+                # temporary space should yield the same file as
+                # frames written directly to the output
+                (seekable, digest) = encode(pcm_frames, pcm_frames, False)
+                (unseekable, digest) = encode(pcm_frames, pcm_frames, True)
+                self.assertEqual(seekable, unseekable)
+
+                # when the length isn't known, the two layouts differ
+                # but both should be valid and decode identically
+                for unseekable in [False, True]:
+                    (data, digest) = encode(pcm_frames, 0, unseekable)
+                    with tempfile.NamedTemporaryFile(
+                            suffix=self.suffix) as temp:
+                        temp.write(data)
+                        temp.flush()
+                        flac = audiotools.open(temp.name)
+                        self.assertEqual(flac.total_frames(), pcm_frames)
+                        self.assertEqual(flac.verify(), True)
+                        self.assertEqual(flac.clean(), [])
+                        md5sum = md5()
+                        audiotools.transfer_framelist_data(flac.to_pcm(),
+                                                           md5sum.update)
+                        self.assertEqual(md5sum.digest(), digest)
+
+                        # blocks should be in the same order
+                        # as when the length is known
+                        # and end with the default 4096 bytes of PADDING
+                        blocks = flac.get_metadata().block_list
+                        if not unseekable:
+                            # seekpoints reserved but not used
+                            # are left as PADDING after the SEEKTABLE
+                            self.assertEqual(
+                                blocks[2].BLOCK_ID,
+                                audiotools.flac.Flac_PADDING.BLOCK_ID)
+                            del(blocks[2])
+                        self.assertEqual(
+                            [b.BLOCK_ID for b in blocks],
+                            [audiotools.flac.Flac_STREAMINFO.BLOCK_ID,
+                             audiotools.flac.Flac_SEEKTABLE.BLOCK_ID,
+                             audiotools.flac.Flac_VORBISCOMMENT.BLOCK_ID,
+                             audiotools.flac.Flac_PADDING.BLOCK_ID])
+                        self.assertEqual(blocks[-1].length, 4096)
+
+                # ensure a length mismatch is caught
+                # on unseekable output also
+                self.assertRaises(ValueError,
+                                  encode,
+                                  pcm_frames, pcm_frames + 1, True)
+        finally:
+            os.unlink(fifo_name)
+            os.rmdir(temp_dir)
+
+    @FORMAT_FLAC
+    def test_variable_block_size(self):
+        # a burst of noise between stretches of silence
+        # should be cheaper to encode with smaller blocks at its edges
+        # while the trailing silence is long enough for several seekpoints
+        def pcmreader():
+            return test_streams.MD5Reader(
+                audiotools.PCMCat(
+                    [EXACT_SILENCE_PCM_Reader(10000),
+                     EXACT_RANDOM_PCM_Reader(30000),
+                     EXACT_SILENCE_PCM_Reader(44100 * 25)]))
+
+        pcm_frames = 10000 + 30000 + 44100 * 25
+
+        for total_pcm_frames in [0, pcm_frames]:
+            with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+                source = pcmreader()
+                self.encode(temp.name,
+                            source,
+                            version="Python Audio Tools",
+                            total_pcm_frames=total_pcm_frames,
+                            block_size=4608,
+                            max_lpc_order=8,
+                            mid_side=True,
+                            variable_block_size=True)
+
+                flac = audiotools.open(temp.name)
+                streaminfo = flac.get_metadata().get_block(
+                    audiotools.flac.Flac_STREAMINFO.BLOCK_ID)
+                self.assertLess(streaminfo.minimum_block_size,
+                                streaminfo.maximum_block_size)
+                self.assertLessEqual(streaminfo.maximum_block_size, 4608)
+                self.assertEqual(flac.total_frames(), pcm_frames)
+                self.assertEqual(flac.verify(), True)
+                self.assertEqual(flac.clean(), [])
+
+                # ensure the stream decodes to its source
+                decoded = audiotools.pcm.empty_framelist(2, 16)
+                with flac.to_pcm() as decoder:
+                    frame = decoder.read(4096)
+                    while len(frame) > 0:
+                        decoded += frame
+                        frame = decoder.read(4096)
+                self.assertEqual(md5(decoded.to_bytes(False, True)).digest(),
+                                 source.digest())
+
+                # ensure seeking lands on a frame boundary
+                # from the SEEKTABLE and resumes from there
+                for offset in [0, 25000, 44100 * 10 + 1, 44100 * 20 + 1,
+                               pcm_frames - 1]:
+                    with flac.to_pcm() as decoder:
+                        position = decoder.seek(offset)
+                        self.assertLessEqual(position, offset)
+                        self.assertGreater(position + 44100 * 10, offset)
+                        frame = decoder.read(4096)
+                        self.assertEqual(
+                            frame.to_bytes(False, True),
+                            decoded.split(position)[1].split(
+                                frame.frames)[0].to_bytes(False, True))
+
+    @FORMAT_FLAC
+    def test_index(self):
+        # index() should locate the same frames as frame_size()
+        # without decoding them, and leave the stream rewound
+        for (pcm_frames, encode_opts) in [
+                (1, {}),
+                (44100 * 12 + 5, {}),
+                (44100 * 12 + 5, {"block_size": 1152}),
+                (44100 * 12 + 5, {"block_size": 4608,
+                                  "variable_block_size": True})]:
+            with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+                pcmreader = audiotools.PCMCat(
+                    [EXACT_SILENCE_PCM_Reader(10000),
+                     EXACT_RANDOM_PCM_Reader(pcm_frames // 2),
+                     EXACT_SILENCE_PCM_Reader(
+                         pcm_frames - 10000 - (pcm_frames // 2))]
+                    if (pcm_frames > 10000) else
+                    [EXACT_RANDOM_PCM_Reader(pcm_frames)])
+                self.encode(temp.name,
+                            pcmreader,
+                            version="Python Audio Tools",
+                            **encode_opts)
+
+                expected = []
+                byte_offset = 0
+                sample_number = 0
+                with self.decoder(open(temp.name, "rb")) as decoder:
+                    pair = decoder.frame_size()
+                    while pair is not None:
+                        (frame_size, block_size) = pair
+                        expected.append((byte_offset,
+                                         sample_number,
+                                         block_size))
+                        byte_offset += frame_size
+                        sample_number += block_size
+                        pair = decoder.frame_size()
+                self.assertEqual(sample_number, pcm_frames)
+
+                with self.decoder(open(temp.name, "rb")) as decoder:
+                    self.assertEqual(decoder.index(), expected)
+
+                    # decoding afterward starts from the first frame
+                    md5sum = md5()
+                    audiotools.transfer_framelist_data(decoder,
+                                                       md5sum.update)
+
+                flac = audiotools.open(temp.name)
+                self.assertEqual(flac.verify(), True)
+                md5sum2 = md5()
+                audiotools.transfer_framelist_data(flac.to_pcm(),
+                                                   md5sum2.update)
+                self.assertEqual(md5sum.digest(), md5sum2.digest())
+
+                # the rebuilt SEEKTABLE should match the encoder's
+                self.assertEqual(
+                    flac.seektable(),
+                    flac.get_metadata().get_block(
+                        audiotools.flac.Flac_SEEKTABLE.BLOCK_ID))
+
+        # fixed-blocksize frame numbers count in the first frame's
+        # block size, even if STREAMINFO's minimum block size differs
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+            self.encode(temp.name,
+                        EXACT_RANDOM_PCM_Reader(4096 * 3 + 100),
+                        version="Python Audio Tools",
+                        block_size=4096)
+            with open(temp.name, "r+b") as f:
+                # the minimum block size is STREAMINFO's first field
+                f.seek(8)
+                f.write(b"\x00\x64")
+
+            with self.decoder(open(temp.name, "rb")) as decoder:
+                self.assertEqual([(sample_number, block_size)
+                                  for (byte_offset,
+                                       sample_number,
+                                       block_size) in decoder.index()],
+                                 [(0, 4096),
+                                  (4096, 4096),
+                                  (8192, 4096),
+                                  (12288, 100)])
+
+    @FORMAT_FLAC
+    def test_exact_seek(self):
+        pcm_frames = 44100 * 25
+        for (encode_opts, keep_seektable) in [
+                ({}, True),
+                ({"block_size": 4608, "variable_block_size": True}, True),
+                ({}, False)]:
+            with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+                self.encode(temp.name,
+                            EXACT_RANDOM_PCM_Reader(pcm_frames),
+                            version="Python Audio Tools",
+                            **encode_opts)
+                flac = audiotools.open(temp.name)
+                if not keep_seektable:
+                    metadata = flac.get_metadata()
+                    metadata.replace_blocks(
+                        audiotools.flac.Flac_SEEKTABLE.BLOCK_ID, [])
+                    flac.update_metadata(metadata)
+                    self.assertFalse(flac.seekable())
+
+                decoded = audiotools.pcm.empty_framelist(2, 16)
+                with flac.to_pcm() as decoder:
+                    frame = decoder.read(4096)
+                    while len(frame) > 0:
+                        decoded += frame
+                        frame = decoder.read(4096)
+
+                for offset in [0, 1, 4095, 4096, 4097, 44100 * 10 + 1,
+                               44100 * 17 + 11, pcm_frames - 1]:
+                    # an inexact seek lands on the frame containing offset
+                    with self.decoder(open(temp.name, "rb")) as decoder:
+                        position = decoder.seek(offset)
+                        self.assertLessEqual(position, offset)
+                        frame = decoder.read(4096)
+                        self.assertGreater(position + frame.frames, offset)
+                        self.assertEqual(
+                            frame.to_bytes(False, True),
+                            decoded.split(position)[1].split(
+                                frame.frames)[0].to_bytes(False, True))
+
+                    # an exact seek lands on offset itself
+                    with self.decoder(open(temp.name, "rb")) as decoder:
+                        self.assertEqual(decoder.seek(offset, exact=True),
+                                         offset)
+                        remainder = audiotools.pcm.empty_framelist(2, 16)
+                        frame = decoder.read(4096)
+                        while len(frame) > 0:
+                            remainder += frame
+                            frame = decoder.read(4096)
+                        self.assertEqual(
+                            remainder.to_bytes(False, True),
+                            decoded.split(offset)[1].to_bytes(False, True))
+
+        # if the scan can't find the frame containing an exact seek's
+        # target, the samples before it are dropped over several reads
+        def crc8(data):
+            crc = 0
+            for byte in data:
+                crc ^= byte
+                for i in range(8):
+                    crc = (((crc << 1) ^ 0x07) if (crc & 0x80)
+                           else (crc << 1)) & 0xFF
+            return crc
+
+        def crc16(data):
+            crc = 0
+            for byte in data:
+                crc ^= byte << 8
+                for i in range(8):
+                    crc = (((crc << 1) ^ 0x8005) if (crc & 0x8000)
+                           else (crc << 1)) & 0xFFFF
+            return crc
+
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+            self.encode(temp.name,
+                        EXACT_RANDOM_PCM_Reader(4096 * 20),
+                        version="Python Audio Tools",
+                        block_size=4096)
+            with self.decoder(open(temp.name, "rb")) as decoder:
+                index = decoder.index()
+                decoded = audiotools.pcm.empty_framelist(2, 16)
+                frame = decoder.read(4096)
+                while len(frame) > 0:
+                    decoded += frame
+                    frame = decoder.read(4096)
+
+            with open(temp.name, "rb") as f:
+                data = bytearray(f.read())
+
+            # find the first frame past the metadata blocks
+            first_frame = 4
+            last_block = 0
+            while not last_block:
+                last_block = data[first_frame] & 0x80
+                first_frame += 4 + ((data[first_frame + 1] << 16) |
+                                    (data[first_frame + 2] << 8) |
+                                    data[first_frame + 3])
+
+            # renumber every fixed-blocksize frame as frame 0
+            # which decodes normally but defeats the scan
+            ends = [offset for (offset, s, b) in index[1:]] + \
+                [len(data) - first_frame]
+            for ((offset, s, b), end) in zip(index, ends):
+                start = first_frame + offset
+                end += first_frame
+                data[start + 4] = 0
+                data[start + 5] = crc8(data[start:start + 5])
+                crc = crc16(data[start:end - 2])
+                data[end - 2] = crc >> 8
+                data[end - 1] = crc & 0xFF
+
+            with open(temp.name, "wb") as f:
+                f.write(data)
+
+            for offset in [4097, 4096 * 3 + 11, 4096 * 20 - 1]:
+                with self.decoder(open(temp.name, "rb")) as decoder:
+                    self.assertEqual(decoder.seek(offset, exact=True),
+                                     offset)
+                    remainder = audiotools.pcm.empty_framelist(2, 16)
+                    frame = decoder.read(4096)
+                    while len(frame) > 0:
+                        remainder += frame
+                        frame = decoder.read(4096)
+                    self.assertEqual(
+                        remainder.to_bytes(False, True),
+                        decoded.split(offset)[1].to_bytes(False, True))
+
 
 class M4AFileTest(LossyFileTest):
     def setUp(self):
@@ -5298,6 +5858,61 @@ class WavPackFileTest(TestForeignWaveChunks,
             for g in self.__stream_variations__():
                 self.__test_reader__(g, 200000, **opts)
 
+    @FORMAT_WAVPACK
+    def test_read_into(self):
+        with tempfile.NamedTemporaryFile(suffix=".wv") as f:
+            self.encode(f.name,
+                        test_streams.Sine16_Stereo(
+                            200000, 44100, 441.0, 0.50, 441.0, 0.49, 1.0))
+
+            # reads are no longer clamped to 48000 PCM frames
+            with self.decoder(f.name) as wavpack:
+                framelist = wavpack.read(200000)
+                self.assertEqual(framelist.frames, 200000)
+                self.assertEqual(wavpack.read(4096).frames, 0)
+            expected = framelist.to_bytes(False, True)
+
+            with self.decoder(f.name) as wavpack:
+                self.assertRaises(TypeError,
+                                  wavpack.read_into,
+                                  None, 4096)
+                self.assertRaises(ValueError,
+                                  wavpack.read_into,
+                                  audiotools.pcm.empty_framelist(1, 16),
+                                  4096)
+                self.assertRaises(ValueError,
+                                  wavpack.read_into,
+                                  audiotools.pcm.empty_framelist(2, 24),
+                                  4096)
+
+            # a single FrameList can be reused for the whole stream
+            with self.decoder(f.name) as wavpack:
+                framelist = audiotools.pcm.empty_framelist(2, 16)
+                data = []
+                while wavpack.read_into(framelist, 4096) > 0:
+                    self.assertLessEqual(framelist.frames, 4096)
+                    data.append(framelist.to_bytes(False, True))
+                self.assertEqual(framelist.frames, 0)
+            self.assertEqual(b"".join(data), expected)
+
+    @FORMAT_WAVPACK
+    def test_threads(self):
+        with tempfile.NamedTemporaryFile(suffix=".wv") as f:
+            for threads in [-1, 0, 65, 2 ** 31 - 1]:
+                self.assertRaises(ValueError,
+                                  self.encode,
+                                  f.name,
+                                  EXACT_BLANK_PCM_Reader(100),
+                                  threads=threads)
+
+        for threads in [2, 3]:
+            for pcm_frames in [1, 22050, 22051, 22050 * 5 + 17]:
+                self.__test_reader__(
+                    test_streams.Sine16_Stereo(
+                        pcm_frames, 44100, 441.0, 0.50, 441.0, 0.49, 1.0),
+                    pcm_frames,
+                    threads=threads)
+
 
 class TTAFileTest(LosslessFileTest):
     def setUp(self):
@@ -5777,6 +6392,58 @@ class TTAFileTest(LosslessFileTest):
                         bits_per_sample=16)),
                 pcm_frames)
 
+    @FORMAT_TTA
+    def test_threads(self):
+        from audiotools.encoders import encode_tta
+
+        for threads in [-1, 0, 65, 2 ** 31 - 1]:
+            self.assertRaises(ValueError,
+                              encode_tta,
+                              file=tempfile.TemporaryFile(),
+                              pcmreader=EXACT_BLANK_PCM_Reader(100),
+                              threads=threads)
+            self.assertRaises(ValueError,
+                              self.decoder,
+                              open("trueaudio.tta", "rb"),
+                              threads=threads)
+
+        for pcm_frames in [1, 46080, 46081, 46080 * 5 + 17]:
+            for total_pcm_frames in [0, pcm_frames]:
+                encoded = []
+                for threads in [1, 2, 3]:
+                    with tempfile.TemporaryFile() as f:
+                        encode_tta(file=f,
+                                   pcmreader=test_streams.Sine16_Stereo(
+                                       pcm_frames, 44100,
+                                       441.0, 0.50, 441.0, 0.49, 1.0),
+                                   total_pcm_frames=total_pcm_frames,
+                                   threads=threads)
+                        f.seek(0, 0)
+                        encoded.append(f.read())
+
+                # concurrent encoding should be byte-for-byte identical
+                self.assertEqual(encoded[0], encoded[1])
+                self.assertEqual(encoded[0], encoded[2])
+
+            with tempfile.NamedTemporaryFile(suffix=".tta") as f:
+                f.write(encoded[0])
+                f.flush()
+
+                decoded = []
+                for threads in [1, 2, 4]:
+                    md5sum = md5()
+                    with self.decoder(open(f.name, "rb"),
+                                      threads=threads) as tta:
+                        frame = tta.read(audiotools.FRAMELIST_SIZE)
+                        while len(frame) > 0:
+                            md5sum.update(frame.to_bytes(False, True))
+                            frame = tta.read(audiotools.FRAMELIST_SIZE)
+                    decoded.append(md5sum.digest())
+
+                # concurrent decoding should be sample-for-sample identical
+                self.assertEqual(decoded[0], decoded[1])
+                self.assertEqual(decoded[0], decoded[2])
+
 
 class SineStreamTest(unittest.TestCase):
     @FORMAT_SINES
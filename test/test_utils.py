@@ -1598,10 +1598,13 @@ class track2track(UtilTest):
                 break
 
         self.input_dir = tempfile.mkdtemp()
+        # a known length keeps ALAC's moov atom ahead of mdat
+        # so truncating the file below only damages the audio data
         self.track1 = self.input_format.from_pcm(
             os.path.join(self.input_dir,
                          "01.{}".format(self.input_format.SUFFIX)),
-            BLANK_PCM_Reader(1))
+            BLANK_PCM_Reader(1),
+            total_pcm_frames=44100)
         self.track_metadata = audiotools.MetaData(track_name=u"Track 1",
                                                   track_number=1,
                                                   album_name=u"Album",
@@ -1619,10 +1622,6 @@ class track2track(UtilTest):
         self.type = self.output_format.NAME
         self.quality = self.output_format.COMPRESSION_MODES[0]
 
-        self.cwd_dir = tempfile.mkdtemp()
-        self.original_dir = os.getcwd()
-        os.chdir(self.cwd_dir)
-
         self.unwritable_dir = tempfile.mkdtemp()
         os.chmod(self.unwritable_dir, 0)
         self.unwritable_file = \
@@ -1636,6 +1635,12 @@ class track2track(UtilTest):
             os.path.join(self.input_dir,
                          "broken.{}".format(self.input_format.SUFFIX)))
 
+        # change directory last, since tearDown won't restore it
+        # if anything above fails
+        self.cwd_dir = tempfile.mkdtemp()
+        self.original_dir = os.getcwd()
+        os.chdir(self.cwd_dir)
+
         # Why a static set of input/output arguments for each set of options?
         # Since track2track uses the standard interface for everything,
         # we're only testing that the options work.
@@ -5189,6 +5194,40 @@ class tracksplit(UtilTest):
 
         return populated
 
+    @UTIL_TRACKSPLIT
+    def test_unindexed_flac(self):
+        # a FLAC image without a SEEKTABLE isn't seekable()
+        # but can still be split by seeking to each track
+        self.stream.reset()
+        track = self.type.from_pcm(self.unsplit_file.name, self.stream)
+        metadata = track.get_metadata()
+        metadata.replace_blocks(audiotools.flac.Flac_SEEKTABLE.BLOCK_ID, [])
+        track.update_metadata(metadata)
+        track = audiotools.open(self.unsplit_file.name)
+        self.assertFalse(track.seekable())
+        self.assertTrue(track.can_seek())
+
+        self.assertEqual(
+            self.__run_app__(["tracksplit", "-j", "2",
+                              "-d", self.output_dir,
+                              "--cue", self.cuesheet.name,
+                              "--no-musicbrainz", "--no-freedb",
+                              "-t", "wav",
+                              "--format=%(track_number)2.2d.wav",
+                              track.filename]), 0)
+
+        # ensure each track has its length from the cuesheet
+        # and together they match the image
+        split_tracks = [audiotools.open(
+            os.path.join(self.output_dir, "{:02d}.wav".format(i)))
+            for i in range(1, 4)]
+        self.assertEqual([t.total_frames() for t in split_tracks],
+                         [44100 * 5, 44100 * 6, 44100 * 7])
+        self.assertTrue(
+            audiotools.pcm_cmp(
+                audiotools.PCMCat([t.to_pcm() for t in split_tracks]),
+                track.to_pcm()))
+
     @UTIL_TRACKSPLIT
     def test_errors(self):
         from audiotools.text import (ERR_OUTPUT_IS_INPUT,